@@ -0,0 +1,141 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	args.c
+
+	Command line parsing
+
+	Arguments are split and unquoted following the CommandLineToArgvW rules:
+	- Arguments are separated by spaces and tabs, outside quotes.
+	- 2n backslashes followed by a quote produce n backslashes, and the quote
+	  begins or ends a quoted part.
+	- 2n+1 backslashes followed by a quote produce n backslashes and a quote.
+	- Backslashes not followed by a quote are kept as is.
+	- Three consecutive quotes produce a quote; a closing quote directly
+	  followed by an opening quote produces nothing.
+
+*/
+
+#include "args.h"
+
+#include <string.h>
+#include <windows.h>
+
+// Value of the last quoted argument (or string returned by getArgumentString)
+static wchar_t awcValue[ ARGUMENT_MAX_LENGTH + 1 ];
+
+
+void initArgumentParser( ArgumentParser* pParser, wchar_t* pwszCommandLine )
+{
+	wchar_t* p = pwszCommandLine ? pwszCommandLine : GetCommandLine();
+
+	// Skip the program name: up to the next quote if it begins with a quote
+	// (no escape sequences), otherwise up to the first space or tab.
+	if (*p == L'"') {
+		p++;
+		while (*p && *p++ != L'"');
+	}
+	else {
+		while (*p && *p != L' ' && *p != L'\t') p++;
+	}
+
+	pParser->p = p;
+}
+
+
+BOOL getArgument( ArgumentParser* pParser, Argument* pArgument )
+{
+	wchar_t* p = pParser->p;
+
+	// Skip spaces
+	while (*p == L' ' || *p == L'\t') p++;
+
+	if (! *p) {
+		// Argument not found
+		pParser->p = p;
+		return FALSE;
+	}
+
+	wchar_t* pBegin = p;
+
+	// Search the end of the argument. Without quotes, the value is the
+	// argument itself.
+	while (*p && *p != L' ' && *p != L'\t' && *p != L'"') p++;
+
+	if (*p != L'"') {
+		pArgument->pValue = pBegin;
+		pArgument->nLength = p - pBegin;
+	}
+	else {
+		// Quoted argument: unquote it from its beginning.
+		// The value cannot be longer than the command line; it is truncated if
+		// the line is longer than a process command line.
+		wchar_t* q = awcValue;
+		wchar_t* const qEnd = awcValue + ARGUMENT_MAX_LENGTH;
+		size_t nBackslashes = 0;
+		int nQuotes = 0;  // 1 in a quoted part
+
+		p = pBegin;
+		while (*p) {
+			if (*p == L'\\') {
+				nBackslashes++;
+				p++;
+				continue;
+			}
+
+			if (*p == L'"') {
+				for (size_t i = nBackslashes / 2; i && q < qEnd; i--) *q++ = L'\\';
+				if (nBackslashes & 1) {
+					if (q < qEnd) *q++ = L'"';
+				}
+				else nQuotes++;
+				nBackslashes = 0;
+				p++;
+
+				// Consecutive quotes
+				while (*p == L'"') {
+					if (++nQuotes == 3) {
+						if (q < qEnd) *q++ = L'"';
+						nQuotes = 0;
+					}
+					p++;
+				}
+				if (nQuotes == 2) nQuotes = 0;
+				continue;
+			}
+
+			for (; nBackslashes && q < qEnd; nBackslashes--) *q++ = L'\\';
+			nBackslashes = 0;
+			if (! nQuotes && (*p == L' ' || *p == L'\t')) break;
+			if (q < qEnd) *q++ = *p;
+			p++;
+		}
+		for (; nBackslashes && q < qEnd; nBackslashes--) *q++ = L'\\';
+		*q = 0;
+
+		pArgument->pValue = awcValue;
+		pArgument->nLength = q - awcValue;
+	}
+
+	pArgument->pwszRaw = pBegin;
+	pArgument->nRawLength = p - pBegin;
+	pParser->p = p;
+	return TRUE;
+}
+
+
+const wchar_t* getArgumentString( const Argument* pArgument, size_t iStart )
+{
+	if (iStart > pArgument->nLength) iStart = pArgument->nLength;
+
+	// The value of a quoted argument is already a string
+	if (pArgument->pValue == awcValue) return awcValue + iStart;
+
+	size_t nLength = pArgument->nLength - iStart;
+	if (nLength > ARGUMENT_MAX_LENGTH) nLength = ARGUMENT_MAX_LENGTH;
+	memcpy( awcValue, pArgument->pValue + iStart, nLength * sizeof( wchar_t ) );
+	awcValue[ nLength ] = 0;
+	return awcValue;
+}
@@ -0,0 +1,44 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	args.h
+
+	Command line parsing
+
+*/
+
+#include <windows.h>
+
+// Maximum length of a process command line (characters)
+#define ARGUMENT_MAX_LENGTH 32767
+
+// Command line argument.
+// Nothing is allocated: the argument is a view into the command line.
+typedef struct {
+	wchar_t* pwszRaw;       // Argument in the command line, followed by the rest of the line
+	size_t nRawLength;      // Length of the argument in the command line (with its quotes)
+	const wchar_t* pValue;  // Argument value, not NUL-terminated: in place if the argument
+	                        // has no quotes, otherwise unquoted in a static buffer
+	size_t nLength;         // Length of the value
+} Argument;
+
+// Command line parser state
+typedef struct {
+	wchar_t* p;  // Remainder of the command line to be parsed
+} ArgumentParser;
+
+// Start parsing a command line (NULL: the process command line).
+// The program name is skipped.
+void initArgumentParser( ArgumentParser* pParser, wchar_t* pwszCommandLine );
+
+// Get the next argument of the command line, split and unquoted following the
+// CommandLineToArgvW rules. The value of a quoted argument is valid until the
+// next call. Returns FALSE if there are no more arguments.
+BOOL getArgument( ArgumentParser* pParser, Argument* pArgument );
+
+// Get the value of an argument from its character iStart, as a string valid
+// until the next call to getArgument or getArgumentString.
+const wchar_t* getArgumentString( const Argument* pArgument, size_t iStart );
@@ -0,0 +1,164 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	backend.c
+
+	Win32 backend of the launch pipeline
+
+*/
+
+#include "backend.h"
+
+#include <string.h>
+#include <windows.h>
+#include <wtsapi32.h>
+
+//
+// NtQuerySystemInformation, resolved on the first call (not in the import
+// libraries of all toolchains).
+//
+static LONG NTAPI callNtQuerySystemInformation( ULONG SystemInformationClass,
+	PVOID SystemInformation, ULONG SystemInformationLength, PULONG ReturnLength )
+{
+	typedef LONG (NTAPI* NtQuerySystemInformationFunc)( ULONG, PVOID, ULONG, PULONG );
+	static NtQuerySystemInformationFunc fnNtQuerySystemInformation = NULL;
+
+	if (! fnNtQuerySystemInformation) {
+		fnNtQuerySystemInformation = (NtQuerySystemInformationFunc) GetProcAddress(
+			GetModuleHandle( L"ntdll.dll" ), "NtQuerySystemInformation" );
+		if (! fnNtQuerySystemInformation) return STATUS_NOT_IMPLEMENTED;
+	}
+	return fnNtQuerySystemInformation( SystemInformationClass, SystemInformation,
+		SystemInformationLength, ReturnLength );
+}
+
+
+//
+// Load a DLL from the system directory.
+//
+static HMODULE loadSystemLibrary( const wchar_t* pwszName )
+{
+	wchar_t wszPath[ MAX_PATH ];
+	size_t nNameLength = wcslen( pwszName );
+	UINT nLength = GetSystemDirectory( wszPath, MAX_PATH );
+	if (! nLength || nLength + 1 + nNameLength >= MAX_PATH) return NULL;
+
+	wszPath[ nLength++ ] = L'\\';
+	memcpy( wszPath + nLength, pwszName, (nNameLength + 1) * sizeof( wchar_t ) );
+	return LoadLibrary( wszPath );
+}
+
+
+// WTS functions, bound on the first call: only the WTS enumeration strategy
+// of the locator (a fallback) and the session fan-out (/S) use them, so
+// wtsapi32.dll is not imported and is loaded only when needed.
+typedef BOOL (WINAPI* WTSEnumerateProcessesFunc)( HANDLE, DWORD, DWORD, PWTS_PROCESS_INFOW*,
+	DWORD* );
+typedef BOOL (WINAPI* WTSEnumerateSessionsFunc)( HANDLE, DWORD, DWORD, PWTS_SESSION_INFOW*,
+	DWORD* );
+typedef void (WINAPI* WTSFreeMemoryFunc)( PVOID );
+
+static WTSEnumerateProcessesFunc fnWTSEnumerateProcesses = NULL;
+static WTSEnumerateSessionsFunc fnWTSEnumerateSessions = NULL;
+static WTSFreeMemoryFunc fnWTSFreeMemory = NULL;
+
+
+//
+// Bind the WTS functions. Returns FALSE if an error occurs (the last error
+// is set).
+//
+static BOOL bindWtsFunctions( void )
+{
+	if (fnWTSFreeMemory) return TRUE;
+
+	HMODULE hModule = loadSystemLibrary( L"wtsapi32.dll" );
+	if (! hModule) return FALSE;
+	fnWTSEnumerateProcesses = (WTSEnumerateProcessesFunc) GetProcAddress( hModule,
+		"WTSEnumerateProcessesW" );
+	fnWTSEnumerateSessions = (WTSEnumerateSessionsFunc) GetProcAddress( hModule,
+		"WTSEnumerateSessionsW" );
+	WTSFreeMemoryFunc fnFree = (WTSFreeMemoryFunc) GetProcAddress( hModule, "WTSFreeMemory" );
+	if (! fnWTSEnumerateProcesses || ! fnWTSEnumerateSessions || ! fnFree) {
+		SetLastError( ERROR_PROC_NOT_FOUND );
+		return FALSE;
+	}
+	fnWTSFreeMemory = fnFree;
+	return TRUE;
+}
+
+
+static BOOL WINAPI callWTSEnumerateProcesses( HANDLE hServer, DWORD Reserved, DWORD Version,
+	PWTS_PROCESS_INFOW* ppProcessInfo, DWORD* pCount )
+{
+	if (! bindWtsFunctions()) return FALSE;
+	return fnWTSEnumerateProcesses( hServer, Reserved, Version, ppProcessInfo, pCount );
+}
+
+
+static BOOL WINAPI callWTSEnumerateSessions( HANDLE hServer, DWORD Reserved, DWORD Version,
+	PWTS_SESSION_INFOW* ppSessionInfo, DWORD* pCount )
+{
+	if (! bindWtsFunctions()) return FALSE;
+	return fnWTSEnumerateSessions( hServer, Reserved, Version, ppSessionInfo, pCount );
+}
+
+
+static void WINAPI callWTSFreeMemory( PVOID pMemory )
+{
+	// Only memory returned by the WTS enumeration functions is freed
+	if (fnWTSFreeMemory) fnWTSFreeMemory( pMemory );
+}
+
+
+const Win32Backend win32Backend = {
+	.pwszName = L"Win32",
+
+	.fnOpenProcess = OpenProcess,
+	.fnGetProcessId = GetProcessId,
+	.fnGetProcessTimes = GetProcessTimes,
+	.fnGetExitCodeProcess = GetExitCodeProcess,
+	.fnQueryFullProcessImageName = QueryFullProcessImageNameW,
+	.fnProcessIdToSessionId = ProcessIdToSessionId,
+	.fnNtQuerySystemInformation = callNtQuerySystemInformation,
+	.fnWTSEnumerateProcesses = callWTSEnumerateProcesses,
+	.fnWTSEnumerateSessions = callWTSEnumerateSessions,
+	.fnWTSFreeMemory = callWTSFreeMemory,
+
+	.fnCloseHandle = CloseHandle,
+	.fnCreateFile = CreateFileW,
+	.fnGetNamedPipeServerProcessId = GetNamedPipeServerProcessId,
+
+	.fnOpenProcessToken = OpenProcessToken,
+	.fnDuplicateTokenEx = DuplicateTokenEx,
+	.fnAdjustTokenPrivileges = AdjustTokenPrivileges,
+	.fnGetTokenInformation = GetTokenInformation,
+	.fnSetTokenInformation = SetTokenInformation,
+	.fnSetThreadToken = SetThreadToken,
+
+	.fnOpenSCManager = OpenSCManagerW,
+	.fnOpenService = OpenServiceW,
+	.fnQueryServiceStatusEx = QueryServiceStatusEx,
+	.fnStartService = StartServiceW,
+	.fnNotifyServiceStatusChange = NotifyServiceStatusChangeW,
+	.fnCloseServiceHandle = CloseServiceHandle,
+
+	.fnRegOpenKeyEx = RegOpenKeyExW,
+	.fnRegCreateKeyEx = RegCreateKeyExW,
+	.fnRegQueryValueEx = RegQueryValueExW,
+	.fnRegSetValueEx = RegSetValueExW,
+	.fnRegCloseKey = RegCloseKey,
+
+	.fnGetTickCount64 = GetTickCount64,
+	.fnSleep = Sleep,
+	.fnSleepEx = SleepEx
+};
+
+const Win32Backend* pBackend = &win32Backend;
+
+
+void setBackend( const Win32Backend* pNewBackend )
+{
+	pBackend = pNewBackend ? pNewBackend : &win32Backend;
+}
@@ -0,0 +1,129 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	backend.h
+
+	Win32 backend of the launch pipeline
+
+	The system calls of tokens.c, locator.c and sessions.c (processes, tokens,
+	services, registry, WTS) go through a function table, so that they can be replaced
+	by a simulation (see bench/backend_fake.c).
+
+*/
+
+#include <windows.h>
+#include <wtsapi32.h>
+
+// NtQuerySystemInformation definitions (not in all SDK headers)
+
+#define SystemProcessInformation 5
+#define STATUS_NOT_IMPLEMENTED ((LONG) 0xC0000002)
+#define STATUS_INFO_LENGTH_MISMATCH ((LONG) 0xC0000004)
+
+// Beginning of the SYSTEM_PROCESS_INFORMATION structure
+typedef struct {
+	ULONG NextEntryOffset;
+	ULONG NumberOfThreads;
+	BYTE Reserved1[ 48 ];
+	struct {
+		USHORT Length;
+		USHORT MaximumLength;
+		PWSTR Buffer;
+	} ImageName;
+	LONG BasePriority;
+	HANDLE UniqueProcessId;
+	PVOID Reserved2;
+	ULONG HandleCount;
+	ULONG SessionId;
+} SystemProcessEntry;
+
+// Function table
+typedef struct {
+	const wchar_t* pwszName;
+
+	// Processes
+	HANDLE (WINAPI* fnOpenProcess)( DWORD dwDesiredAccess, BOOL bInheritHandle,
+		DWORD dwProcessId );
+	DWORD (WINAPI* fnGetProcessId)( HANDLE hProcess );
+	BOOL (WINAPI* fnGetProcessTimes)( HANDLE hProcess, LPFILETIME lpCreationTime,
+		LPFILETIME lpExitTime, LPFILETIME lpKernelTime, LPFILETIME lpUserTime );
+	BOOL (WINAPI* fnGetExitCodeProcess)( HANDLE hProcess, LPDWORD lpExitCode );
+	BOOL (WINAPI* fnQueryFullProcessImageName)( HANDLE hProcess, DWORD dwFlags,
+		LPWSTR lpExeName, PDWORD lpdwSize );
+	BOOL (WINAPI* fnProcessIdToSessionId)( DWORD dwProcessId, DWORD* pSessionId );
+	LONG (NTAPI* fnNtQuerySystemInformation)( ULONG SystemInformationClass,
+		PVOID SystemInformation, ULONG SystemInformationLength, PULONG ReturnLength );
+	BOOL (WINAPI* fnWTSEnumerateProcesses)( HANDLE hServer, DWORD Reserved,
+		DWORD Version, PWTS_PROCESS_INFOW* ppProcessInfo, DWORD* pCount );
+	BOOL (WINAPI* fnWTSEnumerateSessions)( HANDLE hServer, DWORD Reserved,
+		DWORD Version, PWTS_SESSION_INFOW* ppSessionInfo, DWORD* pCount );
+	void (WINAPI* fnWTSFreeMemory)( PVOID pMemory );
+
+	// Handles and named pipes
+	BOOL (WINAPI* fnCloseHandle)( HANDLE hObject );
+	HANDLE (WINAPI* fnCreateFile)( LPCWSTR lpFileName, DWORD dwDesiredAccess,
+		DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+		DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile );
+	BOOL (WINAPI* fnGetNamedPipeServerProcessId)( HANDLE hPipe, PULONG ServerProcessId );
+
+	// Tokens
+	BOOL (WINAPI* fnOpenProcessToken)( HANDLE hProcess, DWORD dwDesiredAccess,
+		PHANDLE phToken );
+	BOOL (WINAPI* fnDuplicateTokenEx)( HANDLE hExistingToken, DWORD dwDesiredAccess,
+		LPSECURITY_ATTRIBUTES lpTokenAttributes,
+		SECURITY_IMPERSONATION_LEVEL ImpersonationLevel, TOKEN_TYPE TokenType,
+		PHANDLE phNewToken );
+	BOOL (WINAPI* fnAdjustTokenPrivileges)( HANDLE hToken, BOOL bDisableAllPrivileges,
+		PTOKEN_PRIVILEGES NewState, DWORD BufferLength, PTOKEN_PRIVILEGES PreviousState,
+		PDWORD ReturnLength );
+	BOOL (WINAPI* fnGetTokenInformation)( HANDLE hToken,
+		TOKEN_INFORMATION_CLASS TokenInformationClass, LPVOID TokenInformation,
+		DWORD TokenInformationLength, PDWORD ReturnLength );
+	BOOL (WINAPI* fnSetTokenInformation)( HANDLE hToken,
+		TOKEN_INFORMATION_CLASS TokenInformationClass, LPVOID TokenInformation,
+		DWORD TokenInformationLength );
+	BOOL (WINAPI* fnSetThreadToken)( PHANDLE phThread, HANDLE hToken );
+
+	// Services
+	SC_HANDLE (WINAPI* fnOpenSCManager)( LPCWSTR lpMachineName, LPCWSTR lpDatabaseName,
+		DWORD dwDesiredAccess );
+	SC_HANDLE (WINAPI* fnOpenService)( SC_HANDLE hSCManager, LPCWSTR lpServiceName,
+		DWORD dwDesiredAccess );
+	BOOL (WINAPI* fnQueryServiceStatusEx)( SC_HANDLE hService, SC_STATUS_TYPE InfoLevel,
+		LPBYTE lpBuffer, DWORD cbBufSize, LPDWORD pcbBytesNeeded );
+	BOOL (WINAPI* fnStartService)( SC_HANDLE hService, DWORD dwNumServiceArgs,
+		LPCWSTR* lpServiceArgVectors );
+	DWORD (WINAPI* fnNotifyServiceStatusChange)( SC_HANDLE hService, DWORD dwNotifyMask,
+		PSERVICE_NOTIFYW pNotifyBuffer );
+	BOOL (WINAPI* fnCloseServiceHandle)( SC_HANDLE hSCObject );
+
+	// Registry
+	LSTATUS (WINAPI* fnRegOpenKeyEx)( HKEY hKey, LPCWSTR lpSubKey, DWORD ulOptions,
+		REGSAM samDesired, PHKEY phkResult );
+	LSTATUS (WINAPI* fnRegCreateKeyEx)( HKEY hKey, LPCWSTR lpSubKey, DWORD Reserved,
+		LPWSTR lpClass, DWORD dwOptions, REGSAM samDesired,
+		const LPSECURITY_ATTRIBUTES lpSecurityAttributes, PHKEY phkResult,
+		LPDWORD lpdwDisposition );
+	LSTATUS (WINAPI* fnRegQueryValueEx)( HKEY hKey, LPCWSTR lpValueName,
+		LPDWORD lpReserved, LPDWORD lpType, LPBYTE lpData, LPDWORD lpcbData );
+	LSTATUS (WINAPI* fnRegSetValueEx)( HKEY hKey, LPCWSTR lpValueName, DWORD Reserved,
+		DWORD dwType, const BYTE* lpData, DWORD cbData );
+	LSTATUS (WINAPI* fnRegCloseKey)( HKEY hKey );
+
+	// Time
+	ULONGLONG (WINAPI* fnGetTickCount64)( void );
+	void (WINAPI* fnSleep)( DWORD dwMilliseconds );
+	DWORD (WINAPI* fnSleepEx)( DWORD dwMilliseconds, BOOL bAlertable );
+} Win32Backend;
+
+// Backend in use (the real Win32 functions by default)
+extern const Win32Backend* pBackend;
+
+// The real Win32 functions
+extern const Win32Backend win32Backend;
+
+// Replace the backend in use (NULL: restore the real Win32 functions).
+void setBackend( const Win32Backend* pNewBackend );
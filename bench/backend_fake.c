@@ -0,0 +1,940 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/backend_fake.c
+
+	Fake Win32 backend: an in-memory simulation of the services, processes,
+	tokens and privileges used by the launch pipeline
+
+	The simulated system has three processes: the caller (session 1),
+	services.exe and, while its service is not stopped, TrustedInstaller.exe
+	(both System processes in session 0). The service state changes with
+	the real time, so that the waits of the pipeline can be measured.
+
+	Handles are heap objects; the statistics count those not closed.
+
+	The calls may come from two threads (the TrustedInstaller worker and the
+	system context): the counters are atomic, and the service state changes
+	under a lock.
+
+*/
+
+#include "backend_fake.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <windows.h>
+#include <wtsapi32.h>
+
+#define FAKE_PID_CALLER 1000
+#define FAKE_PID_SERVICES 680
+#define FAKE_PID_TI_FIRST 4000
+
+#define FAKE_SCM_PIPE_NAME L"\\\\.\\pipe\\ntsvcs"
+#define FAKE_CACHE_SIZE 64
+
+typedef enum {
+	OBJECT_PROCESS,
+	OBJECT_TOKEN,
+	OBJECT_PIPE,
+	OBJECT_SC_MANAGER,
+	OBJECT_SERVICE,
+	OBJECT_KEY
+} FakeObjectType;
+
+typedef struct {
+	FakeObjectType type;
+	DWORD dwProcessId;        // Process, or owner of a token
+	BOOL bSystem;             // Token of a System process
+	DWORD dwSessionId;        // Token
+	PrivilegeMask held;       // Token
+	PrivilegeMask enabled;    // Token (unless it is the caller token)
+	PrivilegeMask* pEnabled;  // Enabled privileges of the token
+} FakeObject;
+
+typedef struct {
+	DWORD dwProcessId;
+	DWORD dwSessionId;
+	BOOL bSystem;
+	ULONGLONG ullCreationTime;
+	const wchar_t* pwszImagePath;
+	const wchar_t* pwszImageName;
+} FakeProcess;
+
+// SIDs returned in TokenUser (LocalSystem and a user)
+static const BYTE abSystemSid[] = { 1, 1, 0, 0, 0, 0, 0, 5, 18, 0, 0, 0 };
+static const BYTE abUserSid[] = { 1, 1, 0, 0, 0, 0, 0, 5, 21, 0, 0, 0 };
+
+static struct {
+	FakeConfig config;
+	FakeStats stats;
+
+	// Enabled privileges of the caller process token
+	PrivilegeMask callerEnabled;
+
+	// TrustedInstaller service
+	DWORD dwState;
+	ULONGLONG ullTransition;    // Time of the next state change (0: none)
+	DWORD dwExitCode;
+	DWORD dwCheckPoint;
+	DWORD dwProcessId;          // TrustedInstaller process (0 if stopped)
+	ULONGLONG ullCreationTime;  // Of the TrustedInstaller process
+	int nCrashesLeft;
+	int nNoPidQueriesLeft;
+	PSERVICE_NOTIFYW pNotify;   // Pending status change notification
+	DWORD dwNotifyMask;
+
+	// Process ids and creation times are never reused
+	DWORD dwNextProcessId;
+	ULONGLONG ullNextCreationTime;
+
+	// Registry: TrustedInstaller process cache
+	BOOL bCacheKey;
+	BYTE abCacheValue[ FAKE_CACHE_SIZE ];
+	DWORD dwCacheSize;          // 0 if there is no value
+} fake = {0};
+
+// Lock of the service state
+static pthread_mutex_t serviceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+//
+// Simulated system
+//
+
+void getDefaultFakeConfig( FakeConfig* pConfig )
+{
+	memset( pConfig, 0, sizeof( FakeConfig ) );
+	pConfig->dwServiceState = SERVICE_STOPPED;
+	pConfig->dwStartTime = 20;
+	pConfig->dwStopTime = 20;
+	pConfig->dwWaitHint = 2000;
+	pConfig->nSessions = 1;
+	pConfig->callerPrivileges = PRIVILEGE_BIT( PRIVILEGE_DEBUG ) |
+		PRIVILEGE_BIT( PRIVILEGE_BACKUP ) | PRIVILEGE_BIT( PRIVILEGE_RESTORE ) |
+		PRIVILEGE_BIT( PRIVILEGE_SECURITY ) | PRIVILEGE_BIT( PRIVILEGE_TAKE_OWNERSHIP ) |
+		PRIVILEGE_BIT( PRIVILEGE_CHANGE_NOTIFY );
+	pConfig->systemPrivileges = PRIVILEGE_MASK_ALL;
+}
+
+
+static void startTIProcess( void )
+{
+	fake.dwProcessId = fake.dwNextProcessId++;
+	fake.ullCreationTime = fake.ullNextCreationTime++;
+}
+
+
+void resetFakeBackend( const FakeConfig* pConfig, BOOL bKeepCache )
+{
+	fake.config = *pConfig;
+	memset( &fake.stats, 0, sizeof( fake.stats ) );
+	fake.callerEnabled = pConfig->callerPrivileges & PRIVILEGE_BIT( PRIVILEGE_CHANGE_NOTIFY );
+
+	if (! fake.dwNextProcessId) {
+		fake.dwNextProcessId = FAKE_PID_TI_FIRST;
+		fake.ullNextCreationTime = 132000000000000000ULL;
+	}
+
+	fake.dwState = pConfig->dwServiceState;
+	fake.ullTransition = 0;
+	fake.dwExitCode = 0;
+	fake.dwCheckPoint = 0;
+	fake.dwProcessId = 0;
+	fake.nCrashesLeft = pConfig->nStartCrashes;
+	fake.nNoPidQueriesLeft = pConfig->nNoPidQueries;
+	fake.pNotify = NULL;
+	if (fake.dwState != SERVICE_STOPPED) {
+		// A new process, unless the cache must remain valid
+		if (! bKeepCache || ! fake.ullCreationTime) startTIProcess();
+		else fake.dwProcessId = fake.dwNextProcessId - 1;
+	}
+	if (fake.dwState == SERVICE_STOP_PENDING)
+		fake.ullTransition = GetTickCount64() + pConfig->dwStopTime;
+
+	if (! bKeepCache) {
+		fake.bCacheKey = FALSE;
+		fake.dwCacheSize = 0;
+	}
+}
+
+
+const FakeStats* getFakeStats( void )
+{
+	return &fake.stats;
+}
+
+
+//
+// Count a call, apply its latency and the injected failures.
+// Returns FALSE if the call must fail (the last error is set).
+//
+static BOOL enterCall( FakeCall call )
+{
+	unsigned nCall = __sync_add_and_fetch( &fake.stats.anCalls[ call ], 1 );
+
+	DWORD dwLatency = fake.config.adwLatency[ call ];
+	if (dwLatency) {
+		struct timespec ts = {
+			.tv_sec = dwLatency / 1000000,
+			.tv_nsec = (dwLatency % 1000000) * 1000L
+		};
+		nanosleep( &ts, NULL );
+	}
+
+	for (int i = 0; i < fake.config.nFailures; i++) {
+		const FakeFailure* pFailure = &fake.config.aFailures[ i ];
+		if (pFailure->call == call && (! pFailure->nCall || pFailure->nCall == nCall)) {
+			SetLastError( pFailure->dwError );
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+static FakeObject* newObject( FakeObjectType type )
+{
+	FakeObject* pObject = calloc( 1, sizeof( FakeObject ) );
+	pObject->type = type;
+	pObject->pEnabled = &pObject->enabled;
+	__sync_add_and_fetch( &fake.stats.nOpenHandles, 1 );
+	return pObject;
+}
+
+
+static BOOL closeObject( HANDLE hObject, FakeObjectType type )
+{
+	FakeObject* pObject = hObject;
+	if (! pObject || pObject->type != type) {
+		SetLastError( ERROR_INVALID_HANDLE );
+		return FALSE;
+	}
+	free( pObject );
+	__sync_sub_and_fetch( &fake.stats.nOpenHandles, 1 );
+	return TRUE;
+}
+
+
+// Apply the state changes of the service that occurred until now
+static void updateService( void )
+{
+	pthread_mutex_lock( &serviceMutex );
+	if (fake.ullTransition && GetTickCount64() >= fake.ullTransition) {
+		fake.ullTransition = 0;
+		fake.dwCheckPoint = 0;
+
+		if (fake.dwState == SERVICE_START_PENDING && fake.nCrashesLeft == 0)
+			fake.dwState = SERVICE_RUNNING;
+		else {
+			if (fake.dwState == SERVICE_START_PENDING) {
+				fake.nCrashesLeft--;
+				fake.dwExitCode = ERROR_PROCESS_ABORTED;
+			}
+			fake.dwState = SERVICE_STOPPED;
+			fake.dwProcessId = 0;
+		}
+	}
+	pthread_mutex_unlock( &serviceMutex );
+}
+
+
+static void getServiceStatus( SERVICE_STATUS_PROCESS* pStatus )
+{
+	updateService();
+	BOOL bPending = (fake.dwState == SERVICE_START_PENDING ||
+		fake.dwState == SERVICE_STOP_PENDING);
+	memset( pStatus, 0, sizeof( SERVICE_STATUS_PROCESS ) );
+	pStatus->dwServiceType = 0x10;  // SERVICE_WIN32_OWN_PROCESS
+	pStatus->dwCurrentState = fake.dwState;
+	pStatus->dwWin32ExitCode = fake.dwExitCode;
+	pStatus->dwCheckPoint = bPending ? ++fake.dwCheckPoint : 0;
+	pStatus->dwWaitHint = bPending ? fake.config.dwWaitHint : 0;
+	pStatus->dwProcessId = fake.dwProcessId;
+	// The process id may be reported after the running state
+	if (fake.dwState == SERVICE_RUNNING && fake.nNoPidQueriesLeft > 0) {
+		fake.nNoPidQueriesLeft--;
+		pStatus->dwProcessId = 0;
+	}
+}
+
+
+static BOOL getProcess( DWORD dwProcessId, FakeProcess* pProcess )
+{
+	updateService();
+
+	if (dwProcessId == FAKE_PID_CALLER) {
+		*pProcess = (FakeProcess) { FAKE_PID_CALLER, 1, FALSE, 131000000000000000ULL,
+			L"C:\\Tools\\superUser64.exe", L"superUser64.exe" };
+		return TRUE;
+	}
+	if (dwProcessId == FAKE_PID_SERVICES) {
+		*pProcess = (FakeProcess) { FAKE_PID_SERVICES, 0, TRUE, 130000000000000000ULL,
+			L"C:\\Windows\\System32\\services.exe", L"services.exe" };
+		return TRUE;
+	}
+	if (fake.dwProcessId && dwProcessId == fake.dwProcessId) {
+		*pProcess = (FakeProcess) { fake.dwProcessId, 0, TRUE, fake.ullCreationTime,
+			L"C:\\Windows\\servicing\\TrustedInstaller.exe", L"TrustedInstaller.exe" };
+		return TRUE;
+	}
+	return FALSE;
+}
+
+
+// Get the running processes. Returns their number.
+static int getProcesses( FakeProcess aProcesses[ 3 ] )
+{
+	int nProcesses = 0;
+	const DWORD adwProcessIds[] = { FAKE_PID_SERVICES, FAKE_PID_CALLER, fake.dwProcessId };
+	for (int i = 0; i < 3; i++)
+		if (getProcess( adwProcessIds[ i ], &aProcesses[ nProcesses ] )) nProcesses++;
+	return nProcesses;
+}
+
+
+static void toFileTime( ULONGLONG ullTime, LPFILETIME pFileTime )
+{
+	pFileTime->dwLowDateTime = (DWORD) (ullTime & 0xFFFFFFFF);
+	pFileTime->dwHighDateTime = (DWORD) (ullTime >> 32);
+}
+
+
+//
+// Processes
+//
+
+static HANDLE WINAPI fakeOpenProcess( DWORD dwDesiredAccess, BOOL bInheritHandle,
+	DWORD dwProcessId )
+{
+	if (! enterCall( FAKE_OPEN_PROCESS )) return NULL;
+
+	FakeProcess process;
+	if (! getProcess( dwProcessId, &process )) {
+		SetLastError( ERROR_INVALID_PARAMETER );
+		return NULL;
+	}
+
+	// Full access to a System process requires SeDebugPrivilege
+	if (process.bSystem && (dwDesiredAccess & ~PROCESS_QUERY_LIMITED_INFORMATION) &&
+		! (fake.callerEnabled & PRIVILEGE_BIT( PRIVILEGE_DEBUG ))) {
+		SetLastError( ERROR_ACCESS_DENIED );
+		return NULL;
+	}
+
+	FakeObject* pObject = newObject( OBJECT_PROCESS );
+	pObject->dwProcessId = dwProcessId;
+	return pObject;
+}
+
+
+static DWORD WINAPI fakeGetProcessId( HANDLE hProcess )
+{
+	if (! enterCall( FAKE_GET_PROCESS_ID )) return 0;
+	if (hProcess == GetCurrentProcess()) return FAKE_PID_CALLER;
+	return ((FakeObject*) hProcess)->dwProcessId;
+}
+
+
+static BOOL WINAPI fakeGetProcessTimes( HANDLE hProcess, LPFILETIME lpCreationTime,
+	LPFILETIME lpExitTime, LPFILETIME lpKernelTime, LPFILETIME lpUserTime )
+{
+	if (! enterCall( FAKE_GET_PROCESS_TIMES )) return FALSE;
+
+	// A process that has exited keeps its creation time
+	FakeProcess process;
+	DWORD dwProcessId = ((FakeObject*) hProcess)->dwProcessId;
+	ULONGLONG ullCreationTime = getProcess( dwProcessId, &process ) ?
+		process.ullCreationTime : 0;
+	toFileTime( ullCreationTime, lpCreationTime );
+	toFileTime( 0, lpExitTime );
+	toFileTime( 0, lpKernelTime );
+	toFileTime( 0, lpUserTime );
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeGetExitCodeProcess( HANDLE hProcess, LPDWORD lpExitCode )
+{
+	if (! enterCall( FAKE_GET_EXIT_CODE_PROCESS )) return FALSE;
+
+	FakeProcess process;
+	*lpExitCode = getProcess( ((FakeObject*) hProcess)->dwProcessId, &process ) ?
+		STILL_ACTIVE : 0;
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeQueryFullProcessImageName( HANDLE hProcess, DWORD dwFlags,
+	LPWSTR lpExeName, PDWORD lpdwSize )
+{
+	if (! enterCall( FAKE_QUERY_FULL_PROCESS_IMAGE_NAME )) return FALSE;
+
+	FakeProcess process;
+	if (! getProcess( ((FakeObject*) hProcess)->dwProcessId, &process )) {
+		SetLastError( ERROR_INVALID_HANDLE );
+		return FALSE;
+	}
+	DWORD cchPath = (DWORD) wcslen( process.pwszImagePath );
+	if (cchPath >= *lpdwSize) {
+		SetLastError( ERROR_INSUFFICIENT_BUFFER );
+		return FALSE;
+	}
+	memcpy( lpExeName, process.pwszImagePath, (cchPath + 1) * sizeof( wchar_t ) );
+	*lpdwSize = cchPath;
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeProcessIdToSessionId( DWORD dwProcessId, DWORD* pSessionId )
+{
+	if (! enterCall( FAKE_PROCESS_ID_TO_SESSION_ID )) return FALSE;
+
+	FakeProcess process;
+	if (! getProcess( dwProcessId, &process )) {
+		SetLastError( ERROR_INVALID_PARAMETER );
+		return FALSE;
+	}
+	*pSessionId = process.dwSessionId;
+	return TRUE;
+}
+
+
+static LONG NTAPI fakeNtQuerySystemInformation( ULONG SystemInformationClass,
+	PVOID SystemInformation, ULONG SystemInformationLength, PULONG ReturnLength )
+{
+	if (! enterCall( FAKE_NT_QUERY_SYSTEM_INFORMATION ) || fake.config.bNoProcessScan ||
+		SystemInformationClass != SystemProcessInformation)
+		return STATUS_NOT_IMPLEMENTED;
+
+	// The entries, followed by the image names
+	FakeProcess aProcesses[ 3 ];
+	int nProcesses = getProcesses( aProcesses );
+	ULONG ulSize = nProcesses * sizeof( SystemProcessEntry );
+	for (int i = 0; i < nProcesses; i++)
+		ulSize += (ULONG) (wcslen( aProcesses[ i ].pwszImageName ) + 1) * sizeof( wchar_t );
+	if (ReturnLength) *ReturnLength = ulSize;
+	if (ulSize > SystemInformationLength) return STATUS_INFO_LENGTH_MISMATCH;
+
+	memset( SystemInformation, 0, ulSize );
+	SystemProcessEntry* pEntries = SystemInformation;
+	wchar_t* pNames = (wchar_t*) (pEntries + nProcesses);
+	for (int i = 0; i < nProcesses; i++) {
+		size_t cchName = wcslen( aProcesses[ i ].pwszImageName );
+		memcpy( pNames, aProcesses[ i ].pwszImageName, (cchName + 1) * sizeof( wchar_t ) );
+		pEntries[ i ].NextEntryOffset = (i + 1 < nProcesses) ? sizeof( SystemProcessEntry ) : 0;
+		pEntries[ i ].ImageName.Length = (USHORT) (cchName * sizeof( wchar_t ));
+		pEntries[ i ].ImageName.MaximumLength = (USHORT) ((cchName + 1) * sizeof( wchar_t ));
+		pEntries[ i ].ImageName.Buffer = pNames;
+		pEntries[ i ].UniqueProcessId = (HANDLE) (ULONG_PTR) aProcesses[ i ].dwProcessId;
+		pEntries[ i ].SessionId = aProcesses[ i ].dwSessionId;
+		pNames += cchName + 1;
+	}
+	return 0;
+}
+
+
+static BOOL WINAPI fakeWTSEnumerateProcesses( HANDLE hServer, DWORD Reserved,
+	DWORD Version, PWTS_PROCESS_INFOW* ppProcessInfo, DWORD* pCount )
+{
+	if (! enterCall( FAKE_WTS_ENUMERATE_PROCESSES )) return FALSE;
+
+	// A single block: the entries, the SIDs and the image names
+	FakeProcess aProcesses[ 3 ];
+	int nProcesses = getProcesses( aProcesses );
+	size_t nSize = nProcesses * (sizeof( WTS_PROCESS_INFOW ) + sizeof( abSystemSid ) +
+		MAX_PATH * sizeof( wchar_t ));
+	PWTS_PROCESS_INFOW pInfo = malloc( nSize );
+	BYTE* pSids = (BYTE*) (pInfo + nProcesses);
+	wchar_t* pNames = (wchar_t*) (pSids + nProcesses * sizeof( abSystemSid ));
+	for (int i = 0; i < nProcesses; i++) {
+		memcpy( pSids, aProcesses[ i ].bSystem ? abSystemSid : abUserSid,
+			sizeof( abSystemSid ) );
+		wcscpy( pNames, aProcesses[ i ].pwszImageName );
+		pInfo[ i ].SessionId = aProcesses[ i ].dwSessionId;
+		pInfo[ i ].ProcessId = aProcesses[ i ].dwProcessId;
+		pInfo[ i ].pProcessName = pNames;
+		pInfo[ i ].pUserSid = pSids;
+		pSids += sizeof( abSystemSid );
+		pNames += MAX_PATH;
+	}
+	fake.stats.nOpenHandles++;
+	*ppProcessInfo = pInfo;
+	*pCount = nProcesses;
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeWTSEnumerateSessions( HANDLE hServer, DWORD Reserved,
+	DWORD Version, PWTS_SESSION_INFOW* ppSessionInfo, DWORD* pCount )
+{
+	if (! enterCall( FAKE_WTS_ENUMERATE_SESSIONS )) return FALSE;
+
+	// A single block: the entries and the station names
+	DWORD nSessions = fake.config.nSessions + 2;
+	PWTS_SESSION_INFOW pInfo = malloc( nSessions * (sizeof( WTS_SESSION_INFOW ) +
+		16 * sizeof( wchar_t )) );
+	wchar_t* pNames = (wchar_t*) (pInfo + nSessions);
+	for (DWORD i = 0; i < nSessions; i++) {
+		if (i == 0) {
+			wcscpy( pNames, L"Services" );
+			pInfo[ i ].State = WTSDisconnected;
+		}
+		else if (i == nSessions - 1) {
+			wcscpy( pNames, L"RDP-Tcp" );
+			pInfo[ i ].State = WTSListen;
+		}
+		else {
+			swprintf( pNames, 16, L"RDP-Tcp#%lu", (unsigned long) i );
+			pInfo[ i ].State = WTSActive;
+		}
+		pInfo[ i ].SessionId = i == nSessions - 1 ? 65536 : i;
+		pInfo[ i ].pWinStationName = pNames;
+		pNames += 16;
+	}
+	fake.stats.nOpenHandles++;
+	*ppSessionInfo = pInfo;
+	*pCount = nSessions;
+	return TRUE;
+}
+
+
+static void WINAPI fakeWTSFreeMemory( PVOID pMemory )
+{
+	free( pMemory );
+	fake.stats.nOpenHandles--;
+}
+
+
+//
+// Handles and named pipes
+//
+
+static BOOL WINAPI fakeCloseHandle( HANDLE hObject )
+{
+	FakeObject* pObject = hObject;
+	if (! pObject || pObject->type == OBJECT_SC_MANAGER || pObject->type == OBJECT_SERVICE ||
+		pObject->type == OBJECT_KEY) {
+		SetLastError( ERROR_INVALID_HANDLE );
+		return FALSE;
+	}
+	return closeObject( hObject, pObject->type );
+}
+
+
+static HANDLE WINAPI fakeCreateFile( LPCWSTR lpFileName, DWORD dwDesiredAccess,
+	DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+	DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile )
+{
+	if (! enterCall( FAKE_CREATE_FILE )) return INVALID_HANDLE_VALUE;
+
+	// Only the SCM named pipe exists
+	if (fake.config.bNoScmPipe || wcscmp( lpFileName, FAKE_SCM_PIPE_NAME )) {
+		SetLastError( ERROR_FILE_NOT_FOUND );
+		return INVALID_HANDLE_VALUE;
+	}
+	return newObject( OBJECT_PIPE );
+}
+
+
+static BOOL WINAPI fakeGetNamedPipeServerProcessId( HANDLE hPipe, PULONG ServerProcessId )
+{
+	if (! enterCall( FAKE_GET_NAMED_PIPE_SERVER_PROCESS_ID )) return FALSE;
+	*ServerProcessId = FAKE_PID_SERVICES;
+	return TRUE;
+}
+
+
+//
+// Tokens
+//
+
+static BOOL WINAPI fakeOpenProcessToken( HANDLE hProcess, DWORD dwDesiredAccess,
+	PHANDLE phToken )
+{
+	if (! enterCall( FAKE_OPEN_PROCESS_TOKEN )) return FALSE;
+
+	FakeObject* pToken = newObject( OBJECT_TOKEN );
+	if (hProcess == GetCurrentProcess()) {
+		// The caller token is shared by all its handles
+		pToken->dwProcessId = FAKE_PID_CALLER;
+		pToken->dwSessionId = 1;
+		pToken->held = fake.config.callerPrivileges;
+		pToken->pEnabled = &fake.callerEnabled;
+	}
+	else {
+		FakeProcess process = {0};
+		getProcess( ((FakeObject*) hProcess)->dwProcessId, &process );
+		pToken->dwProcessId = process.dwProcessId;
+		pToken->bSystem = process.bSystem;
+		pToken->dwSessionId = process.dwSessionId;
+		pToken->held = process.bSystem ? fake.config.systemPrivileges :
+			fake.config.callerPrivileges;
+		pToken->enabled = pToken->held;
+	}
+	*phToken = pToken;
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeDuplicateTokenEx( HANDLE hExistingToken, DWORD dwDesiredAccess,
+	LPSECURITY_ATTRIBUTES lpTokenAttributes, SECURITY_IMPERSONATION_LEVEL ImpersonationLevel,
+	TOKEN_TYPE TokenType, PHANDLE phNewToken )
+{
+	if (! enterCall( FAKE_DUPLICATE_TOKEN_EX )) return FALSE;
+
+	const FakeObject* pExisting = hExistingToken;
+	FakeObject* pToken = newObject( OBJECT_TOKEN );
+	pToken->dwProcessId = pExisting->dwProcessId;
+	pToken->bSystem = pExisting->bSystem;
+	pToken->dwSessionId = pExisting->dwSessionId;
+	pToken->held = pExisting->held;
+	pToken->enabled = *pExisting->pEnabled;
+	*phNewToken = pToken;
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeAdjustTokenPrivileges( HANDLE hToken, BOOL bDisableAllPrivileges,
+	PTOKEN_PRIVILEGES NewState, DWORD BufferLength, PTOKEN_PRIVILEGES PreviousState,
+	PDWORD ReturnLength )
+{
+	if (! enterCall( FAKE_ADJUST_TOKEN_PRIVILEGES )) return FALSE;
+
+	FakeObject* pToken = hToken;
+	BOOL bAllAssigned = TRUE;
+	for (DWORD i = 0; i < NewState->PrivilegeCount; i++) {
+		int iIndex = findPrivilegeByValue( NewState->Privileges[ i ].Luid.LowPart );
+		if (iIndex < 0 || ! (pToken->held & PRIVILEGE_BIT( iIndex ))) {
+			bAllAssigned = FALSE;
+			continue;
+		}
+		if (NewState->Privileges[ i ].Attributes & SE_PRIVILEGE_ENABLED)
+			*pToken->pEnabled |= PRIVILEGE_BIT( iIndex );
+		else *pToken->pEnabled &= ~PRIVILEGE_BIT( iIndex );
+	}
+
+	SetLastError( bAllAssigned ? ERROR_SUCCESS : ERROR_NOT_ALL_ASSIGNED );
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeGetTokenInformation( HANDLE hToken,
+	TOKEN_INFORMATION_CLASS TokenInformationClass, LPVOID TokenInformation,
+	DWORD TokenInformationLength, PDWORD ReturnLength )
+{
+	if (! enterCall( FAKE_GET_TOKEN_INFORMATION )) return FALSE;
+
+	const FakeObject* pToken = hToken;
+	DWORD dwSize;
+	switch (TokenInformationClass) {
+	case TokenUser:
+		dwSize = sizeof( TOKEN_USER ) + sizeof( abSystemSid );
+		break;
+	case TokenPrivileges:
+		dwSize = offsetof( TOKEN_PRIVILEGES, Privileges );
+		for (int i = 0; i < PRIVILEGE_COUNT; i++)
+			if (pToken->held & PRIVILEGE_BIT( i )) dwSize += sizeof( LUID_AND_ATTRIBUTES );
+		break;
+	case TokenSessionId:
+		dwSize = sizeof( DWORD );
+		break;
+	default:
+		SetLastError( ERROR_INVALID_PARAMETER );
+		return FALSE;
+	}
+
+	*ReturnLength = dwSize;
+	if (TokenInformationLength < dwSize) {
+		SetLastError( ERROR_INSUFFICIENT_BUFFER );
+		return FALSE;
+	}
+
+	if (TokenInformationClass == TokenUser) {
+		TOKEN_USER* pUser = TokenInformation;
+		pUser->User.Sid = pUser + 1;
+		pUser->User.Attributes = 0;
+		memcpy( pUser + 1, pToken->bSystem ? abSystemSid : abUserSid, sizeof( abSystemSid ) );
+	}
+	else if (TokenInformationClass == TokenPrivileges) {
+		TOKEN_PRIVILEGES* pPrivileges = TokenInformation;
+		pPrivileges->PrivilegeCount = 0;
+		for (int i = 0; i < PRIVILEGE_COUNT; i++) {
+			if (! (pToken->held & PRIVILEGE_BIT( i ))) continue;
+			LUID_AND_ATTRIBUTES* pEntry = &pPrivileges->Privileges[ pPrivileges->PrivilegeCount++ ];
+			pEntry->Luid = getPrivilegeLuid( i );
+			pEntry->Attributes = (*pToken->pEnabled & PRIVILEGE_BIT( i )) ?
+				SE_PRIVILEGE_ENABLED : 0;
+		}
+	}
+	else *(DWORD*) TokenInformation = pToken->dwSessionId;
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeSetTokenInformation( HANDLE hToken,
+	TOKEN_INFORMATION_CLASS TokenInformationClass, LPVOID TokenInformation,
+	DWORD TokenInformationLength )
+{
+	if (! enterCall( FAKE_SET_TOKEN_INFORMATION )) return FALSE;
+
+	if (TokenInformationClass != TokenSessionId ||
+		TokenInformationLength != sizeof( DWORD )) {
+		SetLastError( ERROR_INVALID_PARAMETER );
+		return FALSE;
+	}
+	((FakeObject*) hToken)->dwSessionId = *(DWORD*) TokenInformation;
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeSetThreadToken( PHANDLE phThread, HANDLE hToken )
+{
+	return enterCall( FAKE_SET_THREAD_TOKEN );
+}
+
+
+//
+// Services
+//
+
+static SC_HANDLE WINAPI fakeOpenSCManager( LPCWSTR lpMachineName, LPCWSTR lpDatabaseName,
+	DWORD dwDesiredAccess )
+{
+	if (! enterCall( FAKE_OPEN_SC_MANAGER )) return NULL;
+	return newObject( OBJECT_SC_MANAGER );
+}
+
+
+static SC_HANDLE WINAPI fakeOpenService( SC_HANDLE hSCManager, LPCWSTR lpServiceName,
+	DWORD dwDesiredAccess )
+{
+	if (! enterCall( FAKE_OPEN_SERVICE )) return NULL;
+
+	if (! hSCManager) {
+		SetLastError( ERROR_INVALID_HANDLE );
+		return NULL;
+	}
+	if (wcscmp( lpServiceName, L"TrustedInstaller" )) {
+		SetLastError( ERROR_SERVICE_DOES_NOT_EXIST );
+		return NULL;
+	}
+	return newObject( OBJECT_SERVICE );
+}
+
+
+static BOOL WINAPI fakeQueryServiceStatusEx( SC_HANDLE hService, SC_STATUS_TYPE InfoLevel,
+	LPBYTE lpBuffer, DWORD cbBufSize, LPDWORD pcbBytesNeeded )
+{
+	if (! enterCall( FAKE_QUERY_SERVICE_STATUS_EX )) return FALSE;
+
+	*pcbBytesNeeded = sizeof( SERVICE_STATUS_PROCESS );
+	if (cbBufSize < sizeof( SERVICE_STATUS_PROCESS )) {
+		SetLastError( ERROR_INSUFFICIENT_BUFFER );
+		return FALSE;
+	}
+
+	getServiceStatus( (SERVICE_STATUS_PROCESS*) lpBuffer );
+	return TRUE;
+}
+
+
+static BOOL WINAPI fakeStartService( SC_HANDLE hService, DWORD dwNumServiceArgs,
+	LPCWSTR* lpServiceArgVectors )
+{
+	if (! enterCall( FAKE_START_SERVICE )) return FALSE;
+
+	updateService();
+	if (fake.dwState == SERVICE_STOP_PENDING) {
+		SetLastError( ERROR_SERVICE_CANNOT_ACCEPT_CTRL );
+		return FALSE;
+	}
+	if (fake.dwState != SERVICE_STOPPED) {
+		SetLastError( ERROR_SERVICE_ALREADY_RUNNING );
+		return FALSE;
+	}
+
+	pthread_mutex_lock( &serviceMutex );
+	startTIProcess();
+	fake.dwState = SERVICE_START_PENDING;
+	fake.dwExitCode = 0;
+	fake.dwCheckPoint = 0;
+	fake.ullTransition = GetTickCount64() + fake.config.dwStartTime;
+	pthread_mutex_unlock( &serviceMutex );
+	return TRUE;
+}
+
+
+static DWORD WINAPI fakeNotifyServiceStatusChange( SC_HANDLE hService, DWORD dwNotifyMask,
+	PSERVICE_NOTIFYW pNotifyBuffer )
+{
+	if (! enterCall( FAKE_NOTIFY_SERVICE_STATUS_CHANGE )) return GetLastError();
+	if (fake.config.bNoNotify) return ERROR_CALL_NOT_IMPLEMENTED;
+
+	// Delivered by the next alertable wait after the state change
+	fake.pNotify = pNotifyBuffer;
+	fake.dwNotifyMask = dwNotifyMask;
+	return ERROR_SUCCESS;
+}
+
+
+static BOOL WINAPI fakeCloseServiceHandle( SC_HANDLE hSCObject )
+{
+	FakeObject* pObject = hSCObject;
+	if (! pObject || (pObject->type != OBJECT_SC_MANAGER &&
+		pObject->type != OBJECT_SERVICE)) {
+		SetLastError( ERROR_INVALID_HANDLE );
+		return FALSE;
+	}
+	// Closing the service handle cancels the pending notification
+	if (pObject->type == OBJECT_SERVICE) fake.pNotify = NULL;
+	return closeObject( hSCObject, pObject->type );
+}
+
+
+//
+// Registry
+//
+
+static LSTATUS WINAPI fakeRegOpenKeyEx( HKEY hKey, LPCWSTR lpSubKey, DWORD ulOptions,
+	REGSAM samDesired, PHKEY phkResult )
+{
+	if (! enterCall( FAKE_REG_OPEN_KEY_EX )) return GetLastError();
+	if (! fake.bCacheKey) return ERROR_FILE_NOT_FOUND;
+	*phkResult = newObject( OBJECT_KEY );
+	return ERROR_SUCCESS;
+}
+
+
+static LSTATUS WINAPI fakeRegCreateKeyEx( HKEY hKey, LPCWSTR lpSubKey, DWORD Reserved,
+	LPWSTR lpClass, DWORD dwOptions, REGSAM samDesired,
+	const LPSECURITY_ATTRIBUTES lpSecurityAttributes, PHKEY phkResult,
+	LPDWORD lpdwDisposition )
+{
+	if (! enterCall( FAKE_REG_CREATE_KEY_EX )) return GetLastError();
+	fake.bCacheKey = TRUE;
+	*phkResult = newObject( OBJECT_KEY );
+	return ERROR_SUCCESS;
+}
+
+
+static LSTATUS WINAPI fakeRegQueryValueEx( HKEY hKey, LPCWSTR lpValueName,
+	LPDWORD lpReserved, LPDWORD lpType, LPBYTE lpData, LPDWORD lpcbData )
+{
+	if (! enterCall( FAKE_REG_QUERY_VALUE_EX )) return GetLastError();
+	if (! fake.dwCacheSize) return ERROR_FILE_NOT_FOUND;
+
+	if (lpType) *lpType = REG_BINARY;
+	DWORD dwBufferSize = *lpcbData;
+	*lpcbData = fake.dwCacheSize;
+	if (dwBufferSize < fake.dwCacheSize) return ERROR_MORE_DATA;
+	memcpy( lpData, fake.abCacheValue, fake.dwCacheSize );
+	return ERROR_SUCCESS;
+}
+
+
+static LSTATUS WINAPI fakeRegSetValueEx( HKEY hKey, LPCWSTR lpValueName, DWORD Reserved,
+	DWORD dwType, const BYTE* lpData, DWORD cbData )
+{
+	if (! enterCall( FAKE_REG_SET_VALUE_EX )) return GetLastError();
+	if (cbData > FAKE_CACHE_SIZE) return ERROR_INVALID_PARAMETER;
+	memcpy( fake.abCacheValue, lpData, cbData );
+	fake.dwCacheSize = cbData;
+	return ERROR_SUCCESS;
+}
+
+
+static LSTATUS WINAPI fakeRegCloseKey( HKEY hKey )
+{
+	return closeObject( hKey, OBJECT_KEY ) ? ERROR_SUCCESS : ERROR_INVALID_HANDLE;
+}
+
+
+//
+// Time
+//
+// The alertable wait delivers the pending service notification as soon as
+// the service enters one of the requested states.
+//
+
+static DWORD WINAPI fakeSleepEx( DWORD dwMilliseconds, BOOL bAlertable )
+{
+	ULONGLONG ullEnd = GetTickCount64() + dwMilliseconds;
+
+	for (;;) {
+		updateService();
+		if (bAlertable && fake.pNotify &&
+			(fake.dwNotifyMask & (1 << (fake.dwState - 1)))) {
+			PSERVICE_NOTIFYW pNotify = fake.pNotify;
+			fake.pNotify = NULL;
+			pNotify->dwNotificationStatus = ERROR_SUCCESS;
+			getServiceStatus( &pNotify->ServiceStatus );
+			pNotify->dwNotificationTriggered = fake.dwNotifyMask & (1 << (fake.dwState - 1));
+			pNotify->pfnNotifyCallback( pNotify );
+			return WAIT_IO_COMPLETION;
+		}
+
+		ULONGLONG ullNow = GetTickCount64();
+		if (ullNow >= ullEnd) return 0;
+
+		// Sleep until the end, or until the next state change
+		ULONGLONG ullWake = ullEnd;
+		if (bAlertable && fake.pNotify && fake.ullTransition && fake.ullTransition < ullWake)
+			ullWake = fake.ullTransition;
+		Sleep( (DWORD) (ullWake > ullNow ? ullWake - ullNow : 0) );
+	}
+}
+
+
+static void WINAPI fakeSleep( DWORD dwMilliseconds )
+{
+	fakeSleepEx( dwMilliseconds, FALSE );
+}
+
+
+const Win32Backend fakeBackend = {
+	.pwszName = L"fake",
+
+	.fnOpenProcess = fakeOpenProcess,
+	.fnGetProcessId = fakeGetProcessId,
+	.fnGetProcessTimes = fakeGetProcessTimes,
+	.fnGetExitCodeProcess = fakeGetExitCodeProcess,
+	.fnQueryFullProcessImageName = fakeQueryFullProcessImageName,
+	.fnProcessIdToSessionId = fakeProcessIdToSessionId,
+	.fnNtQuerySystemInformation = fakeNtQuerySystemInformation,
+	.fnWTSEnumerateProcesses = fakeWTSEnumerateProcesses,
+	.fnWTSEnumerateSessions = fakeWTSEnumerateSessions,
+	.fnWTSFreeMemory = fakeWTSFreeMemory,
+
+	.fnCloseHandle = fakeCloseHandle,
+	.fnCreateFile = fakeCreateFile,
+	.fnGetNamedPipeServerProcessId = fakeGetNamedPipeServerProcessId,
+
+	.fnOpenProcessToken = fakeOpenProcessToken,
+	.fnDuplicateTokenEx = fakeDuplicateTokenEx,
+	.fnAdjustTokenPrivileges = fakeAdjustTokenPrivileges,
+	.fnGetTokenInformation = fakeGetTokenInformation,
+	.fnSetTokenInformation = fakeSetTokenInformation,
+	.fnSetThreadToken = fakeSetThreadToken,
+
+	.fnOpenSCManager = fakeOpenSCManager,
+	.fnOpenService = fakeOpenService,
+	.fnQueryServiceStatusEx = fakeQueryServiceStatusEx,
+	.fnStartService = fakeStartService,
+	.fnNotifyServiceStatusChange = fakeNotifyServiceStatusChange,
+	.fnCloseServiceHandle = fakeCloseServiceHandle,
+
+	.fnRegOpenKeyEx = fakeRegOpenKeyEx,
+	.fnRegCreateKeyEx = fakeRegCreateKeyEx,
+	.fnRegQueryValueEx = fakeRegQueryValueEx,
+	.fnRegSetValueEx = fakeRegSetValueEx,
+	.fnRegCloseKey = fakeRegCloseKey,
+
+	.fnGetTickCount64 = GetTickCount64,
+	.fnSleep = fakeSleep,
+	.fnSleepEx = fakeSleepEx
+};
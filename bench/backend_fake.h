@@ -0,0 +1,107 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/backend_fake.h
+
+	Fake Win32 backend: an in-memory simulation of the services, processes,
+	tokens and privileges used by the launch pipeline
+
+*/
+
+#include <windows.h>
+
+#include "backend.h"    // Win32 backend
+#include "privileges.h" // Privilege table and privilege sets
+
+// Simulated calls, with an injectable latency and failures
+typedef enum {
+	FAKE_OPEN_PROCESS,
+	FAKE_GET_PROCESS_ID,
+	FAKE_GET_PROCESS_TIMES,
+	FAKE_GET_EXIT_CODE_PROCESS,
+	FAKE_QUERY_FULL_PROCESS_IMAGE_NAME,
+	FAKE_PROCESS_ID_TO_SESSION_ID,
+	FAKE_NT_QUERY_SYSTEM_INFORMATION,
+	FAKE_WTS_ENUMERATE_PROCESSES,
+	FAKE_WTS_ENUMERATE_SESSIONS,
+	FAKE_CREATE_FILE,
+	FAKE_GET_NAMED_PIPE_SERVER_PROCESS_ID,
+	FAKE_OPEN_PROCESS_TOKEN,
+	FAKE_DUPLICATE_TOKEN_EX,
+	FAKE_ADJUST_TOKEN_PRIVILEGES,
+	FAKE_GET_TOKEN_INFORMATION,
+	FAKE_SET_TOKEN_INFORMATION,
+	FAKE_SET_THREAD_TOKEN,
+	FAKE_OPEN_SC_MANAGER,
+	FAKE_OPEN_SERVICE,
+	FAKE_QUERY_SERVICE_STATUS_EX,
+	FAKE_START_SERVICE,
+	FAKE_NOTIFY_SERVICE_STATUS_CHANGE,
+	FAKE_REG_OPEN_KEY_EX,
+	FAKE_REG_CREATE_KEY_EX,
+	FAKE_REG_QUERY_VALUE_EX,
+	FAKE_REG_SET_VALUE_EX,
+	FAKE_CALL_COUNT
+} FakeCall;
+
+#define FAKE_MAX_FAILURES 8
+
+// Injected failure
+typedef struct {
+	FakeCall call;
+	unsigned nCall;  // Number of the failing call (1: the first one), 0: every call
+	DWORD dwError;   // Error code returned by the call
+} FakeFailure;
+
+// Simulated system
+typedef struct {
+	// Latency added to each call (microseconds)
+	DWORD adwLatency[ FAKE_CALL_COUNT ];
+
+	// Injected failures
+	FakeFailure aFailures[ FAKE_MAX_FAILURES ];
+	int nFailures;
+
+	// TrustedInstaller service
+	DWORD dwServiceState;   // Initial state: stopped, running or stop pending
+	DWORD dwStartTime;      // Time from StartService to the running state (ms)
+	DWORD dwStopTime;       // Time from the stop pending to the stopped state (ms)
+	DWORD dwWaitHint;       // Wait hint reported in the pending states (ms)
+	int nStartCrashes;      // Number of starts that end in the stopped state
+	int nNoPidQueries;      // Number of queries of the running state without process id
+	BOOL bNoNotify;         // NotifyServiceStatusChange is not supported
+
+	// System process locator
+	BOOL bNoScmPipe;        // The SCM named pipe cannot be opened
+	BOOL bNoProcessScan;    // NtQuerySystemInformation is not available
+
+	// Sessions: 0 (services), then 1 to nSessions (logged on), and a listener
+	DWORD nSessions;
+
+	// Privileges held by the tokens
+	PrivilegeMask callerPrivileges;  // Token of the calling process
+	PrivilegeMask systemPrivileges;  // Tokens of services.exe and TrustedInstaller
+} FakeConfig;
+
+// Statistics since the last reset
+typedef struct {
+	unsigned anCalls[ FAKE_CALL_COUNT ];
+	int nOpenHandles;  // Handles not closed
+} FakeStats;
+
+// The fake backend
+extern const Win32Backend fakeBackend;
+
+// Get the default configuration: a stopped service that starts in 20 ms,
+// one logged-on session, no latency and no failure.
+void getDefaultFakeConfig( FakeConfig* pConfig );
+
+// Reset the simulated system with a configuration, and the statistics.
+// The TrustedInstaller process cache (registry) is kept if bKeepCache is TRUE.
+void resetFakeBackend( const FakeConfig* pConfig, BOOL bKeepCache );
+
+// Get the statistics since the last reset.
+const FakeStats* getFakeStats( void );
@@ -0,0 +1,296 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/bench.c
+
+	Host-native microbenchmarks
+
+	Runs the pure-logic parts of the programs (command line parsing, string
+	formatting, error display, privilege sets) on the build host, with the
+	shim <windows.h>. Each benchmark is run several times with a fixed number
+	of iterations; the best run is reported, in nanoseconds and heap
+	allocations per operation.
+
+	Usage: bench [filter]
+	Only the benchmarks whose name contains the filter are run.
+
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <windows.h>
+
+#include "args.h"
+#include "bench.h"
+#include "output.h"
+#include "privileges.h"
+#include "utils.h"
+
+#define BENCH_ROUNDS 5
+
+typedef struct {
+	const char* pszName;
+	void (*fnRun)( void );
+	unsigned long nIterations;
+} Benchmark;
+
+// Results are accumulated here so that the compiler cannot drop the work
+static volatile size_t nSink = 0;
+
+static wchar_t* pwszShortLine = NULL;  // Typical command line
+static wchar_t* pwszLongLine = NULL;   // Command line near the 32K limit
+static wchar_t* pwszQuotedLine = NULL; // Same with quoted arguments
+static wchar_t* pwszLongText = NULL;   // Long string argument
+
+
+//
+// Build a command line of nArgs arguments following a typical prefix.
+//
+static wchar_t* buildCommandLine( const wchar_t* pwszArgument, int nArgs )
+{
+	static const wchar_t wszPrefix[] =
+		L"\"C:\\Program Files\\superUser\\superUser64.exe\" /v /w /p backup-restore "
+		L"/t:json=C:\\Temp\\timing.json cmd.exe /c";
+
+	size_t nArgLength = wcslen( pwszArgument );
+	size_t nLength = wcslen( wszPrefix ) + nArgs * nArgLength;
+	wchar_t* pwszLine = allocHeap( 0, (nLength + 1) * sizeof( wchar_t ) );
+	wchar_t* p = pwszLine;
+	memcpy( p, wszPrefix, sizeof( wszPrefix ) - sizeof( wchar_t ) );
+	p += wcslen( wszPrefix );
+	for (int i = 0; i < nArgs; i++) {
+		memcpy( p, pwszArgument, nArgLength * sizeof( wchar_t ) );
+		p += nArgLength;
+	}
+	*p = L'\0';
+	return pwszLine;
+}
+
+
+//
+// Benchmarks
+//
+
+static void parseCommandLine( wchar_t* pwszLine )
+{
+	ArgumentParser parser;
+	Argument arg;
+	initArgumentParser( &parser, pwszLine );
+	while (getArgument( &parser, &arg ))
+		nSink += arg.nLength;
+}
+
+
+// Parse the options as the programs do: the value of /p and /t as strings
+static void benchOptions( void )
+{
+	ArgumentParser parser;
+	Argument arg;
+	initArgumentParser( &parser, pwszShortLine );
+	while (getArgument( &parser, &arg ) && *arg.pValue == L'/') {
+		if (arg.pValue[ 1 ] == L'p' && getArgument( &parser, &arg ))
+			nSink += getArgumentString( &arg, 0 )[ 0 ];
+		else if (arg.pValue[ 1 ] == L't')
+			nSink += getArgumentString( &arg, 3 )[ 0 ];
+	}
+}
+
+
+static void benchArgumentsShort( void )
+{
+	parseCommandLine( pwszShortLine );
+}
+
+
+static void benchArgumentsLong( void )
+{
+	parseCommandLine( pwszLongLine );
+}
+
+
+static void benchArgumentsQuoted( void )
+{
+	parseCommandLine( pwszQuotedLine );
+}
+
+
+static void benchFormatString( void )
+{
+	wchar_t* pwszString = printFmtString( L"Process %lu created in session %lu (%ls)",
+		1234UL, 1UL, L"cmd.exe" );
+	nSink += pwszString[ 0 ];
+	freeHeap( pwszString );
+}
+
+
+// Strings of a launch: formatted, then freed at the end
+static void formatLaunchStrings( void )
+{
+	wchar_t* apwszStrings[ 8 ];
+	for (int i = 0; i < 8; i++) {
+		apwszStrings[ i ] = printFmtString( L"Process %lu created in session %lu (%ls)",
+			1234UL + i, 1UL, L"cmd.exe" );
+		nSink += apwszStrings[ i ][ 0 ];
+	}
+	for (int i = 0; i < 8; i++) freeHeap( apwszStrings[ i ] );
+}
+
+
+static void benchLaunchHeap( void )
+{
+	formatLaunchStrings();
+}
+
+
+static void benchLaunchArena( void )
+{
+	Arena arena;
+	openArena( &arena, LAUNCH_ARENA_SIZE );
+	formatLaunchStrings();
+	closeArena( &arena );
+}
+
+
+static void benchVerboseShort( void )
+{
+	showFmtVerbose( L"Found services.exe (PID %lu) by %ls in %lu us", 680UL, L"SCM", 12UL );
+}
+
+
+static void benchVerboseHeavy( void )
+{
+	showFmtVerbose( L"Created process %lu with command line '%ls', token 0x%p, "
+		L"privileges 0x%016llX, in %lu.%03lu ms", 4321UL, pwszLongText, &nSink,
+		PRIVILEGE_MASK_ALL, 12UL, 345UL );
+}
+
+
+static void benchShowError( void )
+{
+	showError( L"Failed to create process", 0x00000005, 3 );
+}
+
+
+static void benchShowFmtError( void )
+{
+	showFmtError( 0x00000005, 0, L"Failed to read manifest '%ls'", pwszLongText );
+}
+
+
+static void benchProfileAll( void )
+{
+	PrivilegeMask mask = 0;
+	parsePrivilegeProfile( L"all", &mask );
+	nSink += (size_t) mask;
+}
+
+
+static void benchProfileNames( void )
+{
+	PrivilegeMask mask = 0;
+	parsePrivilegeProfile( L"backup-restore,SeDebugPrivilege,impersonate,"
+		L"SeTcbPrivilege,take-ownership,security,SeUndockPrivilege,timezone", &mask );
+	nSink += (size_t) mask;
+}
+
+
+static void benchPrivilegeArray( void )
+{
+	LUID_AND_ATTRIBUTES aPrivileges[ PRIVILEGE_COUNT ];
+	nSink += buildPrivilegeArray( PRIVILEGE_MASK_ALL, aPrivileges );
+}
+
+
+static const Benchmark aBenchmarks[] = {
+	{ "getArgument/short-line", benchArgumentsShort, 200000 },
+	{ "getArgument/32K-line", benchArgumentsLong, 500 },
+	{ "getArgument/32K-quoted-line", benchArgumentsQuoted, 500 },
+	{ "getArgument/options", benchOptions, 500000 },
+	{ "printFmtString/short", benchFormatString, 500000 },
+	{ "printFmtString/8-heap", benchLaunchHeap, 100000 },
+	{ "printFmtString/8-arena", benchLaunchArena, 100000 },
+	{ "showFmtVerbose/short", benchVerboseShort, 500000 },
+	{ "showFmtVerbose/heavy", benchVerboseHeavy, 100000 },
+	{ "showError/code+pos", benchShowError, 500000 },
+	{ "showFmtError/code", benchShowFmtError, 100000 },
+	{ "parsePrivilegeProfile/all", benchProfileAll, 2000000 },
+	{ "parsePrivilegeProfile/names", benchProfileNames, 200000 },
+	{ "buildPrivilegeArray/all", benchPrivilegeArray, 2000000 }
+};
+
+
+//
+// Harness
+//
+
+static double getTimeNs( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void runBenchmark( FILE* pReport, const Benchmark* pBenchmark )
+{
+	// Warm up caches and the formatting scratch buffers
+	for (unsigned long i = 0; i < pBenchmark->nIterations / 10 + 1; i++)
+		pBenchmark->fnRun();
+
+	double bestNs = 0;
+	BenchCounters counters = {0};
+	for (int iRound = 0; iRound < BENCH_ROUNDS; iRound++) {
+		BenchCounters start = benchCounters;
+		double t0 = getTimeNs();
+		for (unsigned long i = 0; i < pBenchmark->nIterations; i++)
+			pBenchmark->fnRun();
+		double elapsedNs = getTimeNs() - t0;
+		if (iRound == 0 || elapsedNs < bestNs) bestNs = elapsedNs;
+		counters.nAllocs = benchCounters.nAllocs - start.nAllocs;
+		counters.nBytes = benchCounters.nBytes - start.nBytes;
+	}
+
+	double n = (double) pBenchmark->nIterations;
+	fprintf( pReport, "%-30s %12.1f ns/op %8.2f allocs/op %10.1f B/op\n",
+		pBenchmark->pszName, bestNs / n, counters.nAllocs / n, counters.nBytes / n );
+	fflush( pReport );
+}
+
+
+int main( int argc, char* argv[] )
+{
+	const char* pszFilter = (argc > 1) ? argv[ 1 ] : NULL;
+
+	// The formatting benchmarks write to stdout and stderr: keep the report
+	// on the original stdout and discard the rest.
+	FILE* pReport = fdopen( dup( fileno( stdout ) ), "w" );
+	if (! pReport || ! freopen( "/dev/null", "w", stdout ) ||
+		! freopen( "/dev/null", "w", stderr )) {
+		perror( "bench" );
+		return 1;
+	}
+
+	pwszShortLine = buildCommandLine( L" C:\\Windows\\System32\\drivers\\etc\\hosts", 4 );
+	pwszLongLine = buildCommandLine( L" C:\\Windows\\System32\\drivers\\etc\\hosts", 780 );
+	pwszQuotedLine = buildCommandLine( L" \"C:\\Program Files\\Common Files\\a.txt\"", 740 );
+	pwszLongText = buildCommandLine( L" C:\\Windows\\System32\\drivers\\etc\\hosts", 8 );
+	setVerboseOutput( TRUE );
+
+	for (int i = 0; i < sizeof( aBenchmarks ) / sizeof( *aBenchmarks ); i++) {
+		if (! pszFilter || strstr( aBenchmarks[ i ].pszName, pszFilter ))
+			runBenchmark( pReport, &aBenchmarks[ i ] );
+	}
+
+	freeHeap( pwszShortLine );
+	freeHeap( pwszLongLine );
+	freeHeap( pwszQuotedLine );
+	freeHeap( pwszLongText );
+	fclose( pReport );
+	return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/bench.h
+
+	Host-native microbenchmarks
+
+*/
+
+#include <stddef.h>
+
+// Heap usage since the start of the program
+typedef struct {
+	size_t nAllocs;  // Number of HeapAlloc calls
+	size_t nBytes;   // Total size requested
+} BenchCounters;
+
+extern BenchCounters benchCounters;
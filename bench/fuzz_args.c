@@ -0,0 +1,256 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/fuzz_args.c
+
+	Differential fuzzer of the command line parser
+
+	Random command lines (made of spaces, tabs, quotes, backslashes and a few
+	letters) are parsed with getArgument and with a reference implementation
+	of the CommandLineToArgvW rules, and the arguments are compared. The views
+	returned by getArgument are checked too: an argument without quotes must
+	be its own value, and parsing again from an argument must give the same
+	arguments.
+
+	Usage: fuzz_args [iterations] [seed]
+	The exit code is 1 if a difference is found.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include "args.h"
+
+#define MAX_LINE_LENGTH 2048
+#define MAX_ARGS (MAX_LINE_LENGTH / 2 + 1)
+
+// Reference arguments, in one buffer
+typedef struct {
+	int nArgs;
+	wchar_t* apwszArgs[ MAX_ARGS ];
+	wchar_t awcBuffer[ MAX_LINE_LENGTH + MAX_ARGS ];
+} ReferenceArgs;
+
+static unsigned long long nState = 0;
+
+
+static unsigned getRandom( unsigned nMax )
+{
+	// xorshift64*
+	nState ^= nState >> 12;
+	nState ^= nState << 25;
+	nState ^= nState >> 27;
+	return (unsigned) ((nState * 0x2545F4914F6CDD1DULL) >> 33) % nMax;
+}
+
+
+//
+// Reference: the CommandLineToArgvW algorithm, writing backslashes as they
+// come and removing them when a quote follows.
+//
+static void parseReference( const wchar_t* pwszLine, ReferenceArgs* pArgs )
+{
+	const wchar_t* s = pwszLine;
+	wchar_t* d = pArgs->awcBuffer;
+	pArgs->nArgs = 0;
+
+	// Program name
+	if (*s == L'"') {
+		s++;
+		while (*s) if (*s++ == L'"') break;
+	}
+	else {
+		while (*s && *s != L' ' && *s != L'\t') s++;
+	}
+	while (*s == L' ' || *s == L'\t') s++;
+	if (! *s) return;
+
+	int nQuotes = 0, nBackslashes = 0;
+	pArgs->apwszArgs[ pArgs->nArgs++ ] = d;
+	while (*s) {
+		if ((*s == L' ' || *s == L'\t') && nQuotes == 0) {
+			*d++ = 0;
+			nBackslashes = 0;
+			do s++; while (*s == L' ' || *s == L'\t');
+			if (*s) pArgs->apwszArgs[ pArgs->nArgs++ ] = d;
+		}
+		else if (*s == L'\\') {
+			*d++ = *s++;
+			nBackslashes++;
+		}
+		else if (*s == L'"') {
+			if ((nBackslashes & 1) == 0) {
+				d -= nBackslashes / 2;
+				nQuotes++;
+			}
+			else {
+				d = d - nBackslashes / 2 - 1;
+				*d++ = L'"';
+			}
+			s++;
+			nBackslashes = 0;
+			while (*s == L'"') {
+				if (++nQuotes == 3) {
+					*d++ = L'"';
+					nQuotes = 0;
+				}
+				s++;
+			}
+			if (nQuotes == 2) nQuotes = 0;
+		}
+		else {
+			*d++ = *s++;
+			nBackslashes = 0;
+		}
+	}
+	*d = 0;
+}
+
+
+static void showLine( const wchar_t* pwszLine )
+{
+	fprintf( stderr, "  line: [%ls]\n", pwszLine );
+}
+
+
+//
+// Parse a line with getArgument and compare with the reference.
+// Returns FALSE if there is a difference.
+//
+static BOOL checkLine( wchar_t* pwszLine, const ReferenceArgs* pExpected )
+{
+	ArgumentParser parser;
+	Argument arg;
+	wchar_t* pPrevEnd = pwszLine;
+	int i = 0;
+
+	initArgumentParser( &parser, pwszLine );
+	while (getArgument( &parser, &arg )) {
+		if (i >= pExpected->nArgs) {
+			fprintf( stderr, "extra argument %d [%.*ls]\n", i, (int) arg.nLength, arg.pValue );
+			return FALSE;
+		}
+		const wchar_t* pwszExpected = pExpected->apwszArgs[ i ];
+		if (arg.nLength != wcslen( pwszExpected ) ||
+			wmemcmp( arg.pValue, pwszExpected, arg.nLength )) {
+			fprintf( stderr, "argument %d: [%.*ls], expected [%ls]\n", i, (int) arg.nLength,
+				arg.pValue, pwszExpected );
+			return FALSE;
+		}
+
+		// The raw argument is in the line, after the previous one
+		if (arg.pwszRaw < pPrevEnd || arg.pwszRaw + arg.nRawLength > pwszLine + wcslen( pwszLine ) ||
+			! arg.nRawLength) {
+			fprintf( stderr, "argument %d: invalid view\n", i );
+			return FALSE;
+		}
+		pPrevEnd = arg.pwszRaw + arg.nRawLength;
+
+		// Without quotes, the value is the argument itself (not copied)
+		if (! wmemchr( arg.pwszRaw, L'"', arg.nRawLength ) &&
+			(arg.pValue != arg.pwszRaw || arg.nLength != arg.nRawLength)) {
+			fprintf( stderr, "argument %d: copied without quotes\n", i );
+			return FALSE;
+		}
+
+		// The string value is the same
+		if (wcscmp( getArgumentString( &arg, 0 ), pwszExpected )) {
+			fprintf( stderr, "argument %d: invalid string value\n", i );
+			return FALSE;
+		}
+		i++;
+	}
+
+	if (i != pExpected->nArgs) {
+		fprintf( stderr, "%d arguments, expected %d\n", i, pExpected->nArgs );
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+//
+// Check a line against the expected arguments.
+//
+static BOOL checkVector( const wchar_t* pwszLine, int nArgs, const wchar_t* const* apwszArgs )
+{
+	wchar_t awcLine[ 256 ];
+	ReferenceArgs expected;
+
+	wcscpy( awcLine, pwszLine );
+	expected.nArgs = nArgs;
+	for (int i = 0; i < nArgs; i++) expected.apwszArgs[ i ] = (wchar_t*) apwszArgs[ i ];
+
+	ReferenceArgs reference;
+	parseReference( awcLine, &reference );
+	if (! checkLine( awcLine, &expected ) || ! checkLine( awcLine, &reference )) {
+		showLine( pwszLine );
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	unsigned long nIterations = (argc > 1) ? strtoul( argv[ 1 ], NULL, 10 ) : 1000000;
+	nState = (argc > 2) ? strtoull( argv[ 2 ], NULL, 10 ) : 1;
+	if (! nState) nState = 1;
+
+	// Examples of the CommandLineToArgvW documentation
+	static const wchar_t* const apwszVector1[] = { L"abc", L"d", L"e" };
+	static const wchar_t* const apwszVector2[] = { L"a\\\\\\b", L"de fg", L"h" };
+	static const wchar_t* const apwszVector3[] = { L"a\\\"b", L"c", L"d" };
+	static const wchar_t* const apwszVector4[] = { L"a\\\\b c", L"d", L"e" };
+	static const wchar_t* const apwszVector5[] = { L"/p", L"C:\\Program Files\\x", L"cmd" };
+	if (! checkVector( L"prog \"abc\" d e", 3, apwszVector1 ) ||
+		! checkVector( L"prog a\\\\\\b d\"e f\"g h", 3, apwszVector2 ) ||
+		! checkVector( L"prog a\\\\\\\"b c d", 3, apwszVector3 ) ||
+		! checkVector( L"prog a\\\\\\\\\"b c\" d e", 3, apwszVector4 ) ||
+		! checkVector( L"\"C:\\a b\\prog.exe\"\t/p \"C:\\Program Files\\x\" cmd", 3,
+			apwszVector5 ) ||
+		! checkVector( L"prog", 0, NULL ) || ! checkVector( L"\"prog \t ", 0, NULL ))
+		return 1;
+
+	static const wchar_t awcAlphabet[] = L"  \t\"\"\"\\\\\\ab/-:";
+	static wchar_t awcLine[ MAX_LINE_LENGTH + 1 ];
+	static ReferenceArgs reference;
+
+	for (unsigned long n = 0; n < nIterations; n++) {
+		unsigned nLength = getRandom( (n % 100) ? 40 : MAX_LINE_LENGTH );
+		for (unsigned i = 0; i < nLength; i++)
+			awcLine[ i ] = awcAlphabet[ getRandom( sizeof( awcAlphabet ) / sizeof( wchar_t ) - 1 ) ];
+		awcLine[ nLength ] = 0;
+
+		parseReference( awcLine, &reference );
+		if (! checkLine( awcLine, &reference )) {
+			showLine( awcLine );
+			return 1;
+		}
+
+		// Parsing again from each argument gives the same arguments
+		ArgumentParser parser;
+		Argument arg;
+		initArgumentParser( &parser, awcLine );
+		for (int i = 0; getArgument( &parser, &arg ); i++) {
+			ReferenceArgs rest;
+			wchar_t wcSaved = arg.pwszRaw[ -1 ];
+			arg.pwszRaw[ -1 ] = L' ';  // Empty program name
+			parseReference( arg.pwszRaw - 1, &rest );
+			arg.pwszRaw[ -1 ] = wcSaved;
+			if (rest.nArgs != reference.nArgs - i) {
+				fprintf( stderr, "argument %d: invalid rest of the line\n", i );
+				showLine( awcLine );
+				return 1;
+			}
+		}
+	}
+
+	printf( "%lu command lines checked\n", nIterations );
+	return 0;
+}
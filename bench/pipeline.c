@@ -0,0 +1,644 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/pipeline.c
+
+	Launch pipeline scenarios on the fake Win32 backend
+
+	Runs the token part of a superUser launch (SeDebugPrivilege, system
+	context, TrustedInstaller start, child process token and privileges)
+	against simulated systems: slow or crashing service starts, a stopping
+	service, missing privileges, injected failures... For each scenario,
+	the time and the number of system calls per launch are reported, and
+	the result is checked (error code, missing privileges, handle leaks).
+
+	Each launch runs in its own arena, as in superUser: the allocations per
+	launch (allocHeap calls, and heap blocks among them) are reported, and
+	the heap bytes still in use once the arena is closed are leaks.
+
+	The option parsers are then checked against tables of vectors: the
+	settings are compared with the expected ones, and the parsing must not
+	leak memory.
+
+	As in superUser, the TrustedInstaller service is started on a worker
+	thread while the system context is created.
+
+	Usage: pipeline [-s] [-v] [-t] [filter]
+	-s  Run the setup sequentially (without the worker thread), to compare.
+	-v  Show the verbose and error messages of the pipeline.
+	-t  Show the duration and the memory usage of each phase, for all the
+	    scenarios run.
+	Only the scenarios and the parsers whose name contains the filter are run.
+	The exit code is 1 if a scenario does not give the expected result.
+
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <windows.h>
+
+#include "backend_fake.h" // Fake Win32 backend
+#include "output.h"       // Display functions
+#include "placement.h"    // Placement settings
+#include "scheduling.h"   // Scheduling settings
+#include "sessions.h"     // Session fan-out
+#include "timing.h"       // Launch phase timing
+#include "tokens.h"       // Tokens and privileges management functions
+#include "utils.h"        // Utility functions
+
+typedef struct {
+	const char* pszName;
+	void (*fnSetup)( FakeConfig* pConfig );
+	int nIterations;
+	BOOL bKeepCache;         // Keep the TrustedInstaller process cache between launches
+	DWORD dwStartTimeout;    // Service start timeout (ms), 0 for the default
+	int expectedResult;      // Error code of the pipeline
+	int nExpectedMissing;    // Number of privileges that cannot be set
+	BOOL bFanOut;            // Derive a token for each session, as /S does
+} Scenario;
+
+// SeUnsolicitedInputPrivilege is obsolete: never set
+#define MISSING_OBSOLETE 1
+
+static int nMissingPrivileges = 0;
+static BOOL bSequential = FALSE;
+
+
+static void countMissingPrivilege( const wchar_t* pwszPrivilege )
+{
+	nMissingPrivileges++;
+}
+
+
+//
+// Scenario setups
+//
+
+static void setupDefault( FakeConfig* pConfig )
+{
+}
+
+
+static void setupRunning( FakeConfig* pConfig )
+{
+	pConfig->dwServiceState = SERVICE_RUNNING;
+}
+
+
+static void setupSlowStart( FakeConfig* pConfig )
+{
+	pConfig->dwStartTime = 300;
+}
+
+
+static void setupSlowStartPolling( FakeConfig* pConfig )
+{
+	pConfig->dwStartTime = 300;
+	pConfig->bNoNotify = TRUE;
+}
+
+
+static void setupRunningNoPid( FakeConfig* pConfig )
+{
+	// No notification comes while the service stays running
+	pConfig->dwServiceState = SERVICE_RUNNING;
+	pConfig->nNoPidQueries = 3;
+}
+
+
+static void setupStopping( FakeConfig* pConfig )
+{
+	pConfig->dwServiceState = SERVICE_STOP_PENDING;
+	pConfig->dwStopTime = 50;
+}
+
+
+static void setupCrashOnce( FakeConfig* pConfig )
+{
+	pConfig->nStartCrashes = 1;
+}
+
+
+static void setupCrashAlways( FakeConfig* pConfig )
+{
+	pConfig->nStartCrashes = 3;
+}
+
+
+static void setupHungStart( FakeConfig* pConfig )
+{
+	pConfig->dwStartTime = 60000;
+}
+
+
+static void setupMissingPrivileges( FakeConfig* pConfig )
+{
+	pConfig->systemPrivileges &= ~(PRIVILEGE_BIT( PRIVILEGE_BACKUP ) |
+		PRIVILEGE_BIT( PRIVILEGE_RESTORE ) | PRIVILEGE_BIT( PRIVILEGE_SECURITY ));
+}
+
+
+static void setupNoSeDebug( FakeConfig* pConfig )
+{
+	pConfig->callerPrivileges &= ~PRIVILEGE_BIT( PRIVILEGE_DEBUG );
+}
+
+
+static void setupNoScmPipe( FakeConfig* pConfig )
+{
+	pConfig->bNoScmPipe = TRUE;
+}
+
+
+static void setupWtsOnly( FakeConfig* pConfig )
+{
+	pConfig->bNoScmPipe = TRUE;
+	pConfig->bNoProcessScan = TRUE;
+}
+
+
+static void setupOpenServiceDenied( FakeConfig* pConfig )
+{
+	pConfig->aFailures[ pConfig->nFailures++ ] =
+		(FakeFailure) { FAKE_OPEN_SERVICE, 0, ERROR_ACCESS_DENIED };
+}
+
+
+static void setupTokenFailure( FakeConfig* pConfig )
+{
+	// The second DuplicateTokenEx call: the child process token
+	pConfig->aFailures[ pConfig->nFailures++ ] =
+		(FakeFailure) { FAKE_DUPLICATE_TOKEN_EX, 2, ERROR_NOT_ENOUGH_MEMORY };
+}
+
+
+static void setupContextFailure( FakeConfig* pConfig )
+{
+	// The first DuplicateTokenEx call: the system context. The TrustedInstaller
+	// worker must still be joined, and its process handle closed.
+	pConfig->aFailures[ pConfig->nFailures++ ] =
+		(FakeFailure) { FAKE_DUPLICATE_TOKEN_EX, 1, ERROR_ACCESS_DENIED };
+}
+
+
+static void setupSlowCalls( FakeConfig* pConfig )
+{
+	for (int i = 0; i < FAKE_CALL_COUNT; i++) pConfig->adwLatency[ i ] = 50;
+	pConfig->adwLatency[ FAKE_OPEN_SC_MANAGER ] = 2000;
+	pConfig->adwLatency[ FAKE_START_SERVICE ] = 5000;
+}
+
+
+static void setupSessions( FakeConfig* pConfig )
+{
+	pConfig->nSessions = 200;
+}
+
+
+static void setupSlowContext( FakeConfig* pConfig )
+{
+	// 200 ms to find services.exe, 300 ms to start the service
+	pConfig->dwStartTime = 300;
+	pConfig->adwLatency[ FAKE_CREATE_FILE ] = 200000;
+}
+
+
+static const Scenario aScenarios[] = {
+	{ "cold-start", setupDefault, 20, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "warm-cache", setupRunning, 200, TRUE, 0, 0, MISSING_OBSOLETE },
+	{ "running-no-cache", setupRunning, 200, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "slow-start", setupSlowStart, 3, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "slow-start-polling", setupSlowStartPolling, 3, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "running-no-pid", setupRunningNoPid, 10, FALSE, 2000, 0, MISSING_OBSOLETE },
+	{ "stopping-service", setupStopping, 10, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "start-crash-retry", setupCrashOnce, 10, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "start-crash-always", setupCrashAlways, 5, FALSE, 0, 3, 0 },
+	{ "start-timeout", setupHungStart, 2, FALSE, 200, 3, 0 },
+	{ "missing-privileges", setupMissingPrivileges, 20, FALSE, 0, 0, MISSING_OBSOLETE + 3 },
+	{ "no-sedebug", setupNoSeDebug, 200, FALSE, 0, 2, 0 },
+	{ "locator-no-scm-pipe", setupNoScmPipe, 20, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "locator-wts-only", setupWtsOnly, 20, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "open-service-denied", setupOpenServiceDenied, 200, FALSE, 0, 3, 0 },
+	{ "child-token-failure", setupTokenFailure, 20, FALSE, 0, 5, 0 },
+	{ "system-context-failure", setupContextFailure, 20, FALSE, 0, 5, 0 },
+	{ "slow-calls", setupSlowCalls, 10, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "slow-system-context", setupSlowContext, 3, FALSE, 0, 0, MISSING_OBSOLETE },
+	{ "session-fanout-200", setupSessions, 20, FALSE, 0, 0, MISSING_OBSOLETE, TRUE }
+};
+
+
+//
+// Derive the token of each logged-on session from the base token, as
+// superUser /S does: the missing privileges are reported once.
+//
+static int duplicateSessionTokens( HANDLE hBaseToken )
+{
+	PWTS_SESSION_INFOW pSessions = NULL;
+	DWORD nSessions = 0;
+	if (! pBackend->fnWTSEnumerateSessions( WTS_CURRENT_SERVER_HANDLE, 0, 1, &pSessions,
+		&nSessions ))
+		return 5;
+
+	int errCode = 0, nTokens = 0;
+	for (DWORD i = 0; i < nSessions && ! errCode; i++) {
+		if (! pSessions[ i ].SessionId || (pSessions[ i ].State != WTSActive &&
+			pSessions[ i ].State != WTSDisconnected))
+			continue;
+		HANDLE hChildToken = NULL;
+		errCode = duplicateChildProcessToken( hBaseToken, pSessions[ i ].SessionId,
+			PRIVILEGE_MASK_ALL, nTokens++ ? NULL : countMissingPrivilege, &hChildToken );
+		if (! errCode) pBackend->fnCloseHandle( hChildToken );
+	}
+	pBackend->fnWTSFreeMemory( pSessions );
+	return errCode;
+}
+
+
+//
+// Run the pipeline once, as superUser /s does before creating the child
+// process. Returns the error code of the first failing step.
+//
+static int runPipeline( BOOL bFanOut )
+{
+	HANDLE hBaseProcess = NULL, hBaseToken = NULL, hChildToken = NULL;
+	int errCode;
+	if (bSequential) {
+		errCode = acquireSeDebugPrivilege();
+		if (! errCode) errCode = createSystemContext();
+	}
+	// The worker is joined on failure, so that the next launch starts from a
+	// clean state
+	else errCode = prepareSystemLaunch();
+	if (! errCode) errCode = getTrustedInstallerProcess( &hBaseProcess );
+	if (errCode) {
+		if (hBaseProcess) pBackend->fnCloseHandle( hBaseProcess );
+		return errCode;
+	}
+
+	errCode = createChildProcessToken( hBaseProcess, &hBaseToken );
+	if (! errCode) {
+		if (bFanOut) errCode = duplicateSessionTokens( hBaseToken );
+		else {
+			errCode = duplicateChildProcessToken( hBaseToken, 1, PRIVILEGE_MASK_ALL,
+				countMissingPrivilege, &hChildToken );
+			if (! errCode) pBackend->fnCloseHandle( hChildToken );
+		}
+		pBackend->fnCloseHandle( hBaseToken );
+	}
+	pBackend->fnCloseHandle( hBaseProcess );
+	return errCode;
+}
+
+
+static double getTimeMs( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+
+static BOOL runScenario( const Scenario* pScenario )
+{
+	FakeConfig config;
+	getDefaultFakeConfig( &config );
+	pScenario->fnSetup( &config );
+	setServiceStartTimeout( pScenario->dwStartTimeout ? pScenario->dwStartTimeout :
+		SERVICE_START_TIMEOUT_DEFAULT );
+
+	BOOL bPassed = TRUE;
+	double dTotalMs = 0;
+	unsigned long nTotalCalls = 0, nAllocations = 0, nHeapAllocations = 0;
+	int result = 0, nLeaks = 0;
+	long nLeakedBytes = 0;
+
+	for (int i = 0; i < pScenario->nIterations; i++) {
+		resetFakeBackend( &config, pScenario->bKeepCache );
+		nMissingPrivileges = 0;
+		MemoryStats before, after;
+		getMemoryStats( &before );
+
+		Arena arena;
+		double dStart = getTimeMs();
+		openArena( &arena, LAUNCH_ARENA_SIZE );
+		result = runPipeline( pScenario->bFanOut );
+		closeArena( &arena );
+		dTotalMs += getTimeMs() - dStart;
+
+		getMemoryStats( &after );
+		nAllocations += after.nAllocations - before.nAllocations;
+		nHeapAllocations += after.nHeapAllocations - before.nHeapAllocations;
+		nLeakedBytes += after.nLiveBytes - before.nLiveBytes;
+
+		const FakeStats* pStats = getFakeStats();
+		for (int j = 0; j < FAKE_CALL_COUNT; j++) nTotalCalls += pStats->anCalls[ j ];
+		nLeaks += pStats->nOpenHandles;
+		if (result != pScenario->expectedResult ||
+			nMissingPrivileges != pScenario->nExpectedMissing || pStats->nOpenHandles ||
+			after.nLiveBytes != before.nLiveBytes)
+			bPassed = FALSE;
+	}
+
+	double n = pScenario->nIterations;
+	printf( "%-22s %6d %10.3f ms/op %8.1f calls/op %6.1f %5.1f %8d %6d %6ld  %s\n",
+		pScenario->pszName, result, dTotalMs / n, nTotalCalls / n, nAllocations / n,
+		nHeapAllocations / n, nMissingPrivileges, nLeaks, nLeakedBytes,
+		bPassed ? "ok" : "FAILED" );
+	fflush( stdout );
+	return bPassed;
+}
+
+
+//
+// Parser vectors
+//
+
+typedef struct {
+	const char* pszName;
+	BOOL (*fnCheck)( int iVector );  // Check a vector, show it if it fails
+	int nVectors;
+} ParserVectors;
+
+// Session list (/S option)
+typedef struct {
+	const wchar_t* pwszValue;
+	BOOL bValid;
+	BOOL bAll;
+	int nIds;
+	DWORD adwIds[ 4 ];
+} SessionListVector;
+
+static const SessionListVector aSessionListVectors[] = {
+	{ L"all", TRUE, TRUE },
+	{ L"ALL", TRUE, TRUE },
+	{ L"1", TRUE, FALSE, 1, { 1 } },
+	{ L"3,1,2", TRUE, FALSE, 3, { 3, 1, 2 } },
+	{ L"2,1,2,2", TRUE, FALSE, 2, { 2, 1 } },      // Duplicates
+	{ L"0", TRUE, FALSE, 1, { 0 } },               // Services session
+	{ L"007", TRUE, FALSE, 1, { 7 } },
+	{ L"4294967294", TRUE, FALSE, 1, { 4294967294UL } },
+	{ L"4294967295", FALSE },                      // Not a session id
+	{ L"4294967296", FALSE },                      // Above DWORD
+	{ L"18446744073709551616", FALSE },
+	{ L"", FALSE },                                // Empty items
+	{ L",", FALSE },
+	{ L"1,,2", FALSE },
+	{ L",1", FALSE },
+	{ L"1,", FALSE },                              // Trailing comma
+	{ L"1,2,", FALSE },
+	{ L"all,1", FALSE },
+	{ L"1,all", FALSE },
+	{ L"-1", FALSE },                              // Non-digits
+	{ L"+1", FALSE },
+	{ L" 1", FALSE },
+	{ L"1 ", FALSE },
+	{ L"1, 2", FALSE },
+	{ L"0x10", FALSE },
+	{ L"1a", FALSE },
+	{ L"one", FALSE }
+};
+
+
+static BOOL checkSessionList( int iVector )
+{
+	const SessionListVector* pVector = &aSessionListVectors[ iVector ];
+	SessionList list = {0};
+	BOOL bValid = parseSessionList( pVector->pwszValue, &list );
+	BOOL bPassed = bValid == pVector->bValid && list.bAll == pVector->bAll &&
+		list.nIds == pVector->nIds;
+	for (int i = 0; i < list.nIds && bPassed; i++)
+		bPassed = list.pdwIds[ i ] == pVector->adwIds[ i ];
+	freeSessionList( &list );
+
+	if (! bPassed) printf( "  \"%ls\": unexpected result\n", pVector->pwszValue );
+	return bPassed;
+}
+
+
+// Scheduling settings (/n option). The settings of an invalid list are
+// left unchanged (all zero).
+typedef struct {
+	const wchar_t* pwszValue;
+	BOOL bValid;
+	SchedulingSettings settings;
+} SchedulingVector;
+
+static const SchedulingVector aSchedulingVectors[] = {
+	{ L"background", TRUE, { IDLE_PRIORITY_CLASS, SCHEDULING_IO_VERY_LOW, 1, TRUE } },
+	{ L"eco", TRUE, { 0, 0, 0, TRUE } },
+	{ L"cpu=idle", TRUE, { IDLE_PRIORITY_CLASS } },
+	{ L"cpu=below", TRUE, { BELOW_NORMAL_PRIORITY_CLASS } },
+	{ L"cpu=normal", TRUE, { NORMAL_PRIORITY_CLASS } },
+	{ L"cpu=above", TRUE, { ABOVE_NORMAL_PRIORITY_CLASS } },
+	{ L"cpu=high", TRUE, { HIGH_PRIORITY_CLASS } },
+	{ L"io=verylow", TRUE, { 0, SCHEDULING_IO_VERY_LOW } },
+	{ L"io=low", TRUE, { 0, SCHEDULING_IO_LOW } },
+	{ L"io=normal", TRUE, { 0, SCHEDULING_IO_NORMAL } },
+	{ L"memory=verylow", TRUE, { 0, 0, 1 } },
+	{ L"memory=low", TRUE, { 0, 0, 2 } },
+	{ L"memory=medium", TRUE, { 0, 0, 3 } },
+	{ L"memory=below", TRUE, { 0, 0, 4 } },
+	{ L"memory=normal", TRUE, { 0, 0, 5 } },
+	{ L"CPU=High,IO=Low", TRUE, { HIGH_PRIORITY_CLASS, SCHEDULING_IO_LOW } },
+	// Repeated or conflicting items: the last one applies
+	{ L"cpu=high,cpu=high", TRUE, { HIGH_PRIORITY_CLASS } },
+	{ L"cpu=idle,cpu=above", TRUE, { ABOVE_NORMAL_PRIORITY_CLASS } },
+	{ L"cpu=high,background", TRUE,
+		{ IDLE_PRIORITY_CLASS, SCHEDULING_IO_VERY_LOW, 1, TRUE } },
+	{ L"background,cpu=normal,memory=normal", TRUE,
+		{ NORMAL_PRIORITY_CLASS, SCHEDULING_IO_VERY_LOW, 5, TRUE } },
+	// The realtime priority class is never set
+	{ L"cpu=realtime", FALSE },
+	{ L"cpu=high,cpu=realtime", FALSE },
+	{ L"cpu=", FALSE },
+	{ L"cpu", FALSE },
+	// Unknown values
+	{ L"io=high", FALSE },
+	{ L"io=critical", FALSE },
+	{ L"io=", FALSE },
+	{ L"memory=high", FALSE },
+	{ L"memory=", FALSE },
+	{ L"cpu=high,io=verylo", FALSE },
+	// Empty and unknown items
+	{ L"", FALSE },
+	{ L",", FALSE },
+	{ L"eco,", FALSE },
+	{ L",eco", FALSE },
+	{ L"eco,,cpu=high", FALSE },
+	{ L"eco=1", FALSE },
+	{ L"backgrounds", FALSE },
+	{ L"cpu =high", FALSE },
+	{ L"turbo", FALSE }
+};
+
+
+static BOOL checkScheduling( int iVector )
+{
+	const SchedulingVector* pVector = &aSchedulingVectors[ iVector ];
+	SchedulingSettings settings = {0};
+	BOOL bValid = parseSchedulingSettings( pVector->pwszValue, &settings );
+	const SchedulingSettings* pExpected = &pVector->settings;
+	BOOL bPassed = bValid == pVector->bValid &&
+		settings.dwPriorityClass == pExpected->dwPriorityClass &&
+		settings.nIoPriority == pExpected->nIoPriority &&
+		settings.nMemoryPriority == pExpected->nMemoryPriority &&
+		settings.bEcoQoS == pExpected->bEcoQoS;
+
+	if (! bPassed) printf( "  \"%ls\": unexpected result\n", pVector->pwszValue );
+	return bPassed;
+}
+
+
+// Placement settings (/a option). The settings of an invalid list are left
+// unchanged (all zero).
+typedef struct {
+	const wchar_t* pwszValue;
+	BOOL bValid;
+	PlacementSettings settings;
+} PlacementVector;
+
+static const PlacementVector aPlacementVectors[] = {
+	{ L"group=1,mask=0xFF", TRUE, { TRUE, { 0xFF, 1 } } },
+	{ L"mask=0xF0,group=0", TRUE, { TRUE, { 0xF0, 0 } } },
+	{ L"GROUP=2,MASK=0XaB", TRUE, { TRUE, { 0xAB, 2 } } },
+	{ L"group=65535", TRUE, { TRUE, { 0, 0xFFFF } } },
+	{ L"node=1", TRUE, { FALSE, { 0 }, TRUE, 1 } },
+	{ L"node=65535", TRUE, { FALSE, { 0 }, TRUE, 0xFFFF } },
+	{ L"mask=1,mask=2", TRUE, { TRUE, { 2, 0 } } },
+	// A group without a mask: all its processors (completed when resolved)
+	{ L"group=1", TRUE, { TRUE, { 0, 1 } } },
+	// A mask without the hexadecimal prefix
+	{ L"mask=F0", TRUE, { TRUE, { 0xF0, 0 } } },
+	{ L"mask=00ff", TRUE, { TRUE, { 0xFF, 0 } } },
+	// 64 processors (KAFFINITY of a 64-bit host)
+	{ L"mask=0xFFFFFFFFFFFFFFFF", TRUE, { TRUE, { 0xFFFFFFFFFFFFFFFFULL, 0 } } },
+	{ L"mask=8000000000000000", TRUE, { TRUE, { 0x8000000000000000ULL, 0 } } },
+	// A node with a group: the node is only preferred
+	{ L"node=1,group=0,mask=F0", TRUE, { TRUE, { 0xF0, 0 }, TRUE, 1 } },
+	{ L"group=1,node=0", TRUE, { TRUE, { 0, 1 }, TRUE, 0 } },
+	// No processor
+	{ L"mask=0", FALSE },
+	{ L"mask=0x0", FALSE },
+	{ L"mask=0000", FALSE },
+	{ L"group=1,mask=0", FALSE },
+	// Over 64 bits, and overflows
+	{ L"mask=0x10000000000000000", FALSE },
+	{ L"mask=1FFFFFFFFFFFFFFFF", FALSE },
+	{ L"mask=0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF", FALSE },
+	{ L"group=65536", FALSE },
+	{ L"group=18446744073709551617", FALSE },
+	{ L"node=65536", FALSE },
+	{ L"node=99999999999999999999", FALSE },
+	// Invalid numbers
+	{ L"mask=0x", FALSE },
+	{ L"mask=x1", FALSE },
+	{ L"mask=G", FALSE },
+	{ L"mask=-1", FALSE },
+	{ L"mask= 1", FALSE },
+	{ L"group=0x1", FALSE },
+	{ L"group=A", FALSE },
+	{ L"group=-1", FALSE },
+	{ L"node=1a", FALSE },
+	// Empty and unknown items
+	{ L"", FALSE },
+	{ L",", FALSE },
+	{ L"group=", FALSE },
+	{ L"mask=", FALSE },
+	{ L"node=", FALSE },
+	{ L"group=1,", FALSE },
+	{ L",group=1", FALSE },
+	{ L"group=1,,mask=1", FALSE },
+	{ L"affinity=1", FALSE },
+	{ L"group", FALSE }
+};
+
+
+static BOOL checkPlacement( int iVector )
+{
+	const PlacementVector* pVector = &aPlacementVectors[ iVector ];
+	PlacementSettings settings = {0};
+	BOOL bValid = parsePlacementSettings( pVector->pwszValue, &settings );
+	const PlacementSettings* pExpected = &pVector->settings;
+	BOOL bPassed = bValid == pVector->bValid &&
+		settings.bAffinity == pExpected->bAffinity &&
+		settings.affinity.Mask == pExpected->affinity.Mask &&
+		settings.affinity.Group == pExpected->affinity.Group &&
+		settings.bNode == pExpected->bNode && settings.nNode == pExpected->nNode;
+
+	if (! bPassed) printf( "  \"%ls\": unexpected result\n", pVector->pwszValue );
+	return bPassed;
+}
+
+
+static const ParserVectors aParsers[] = {
+	{ "parse-sessions", checkSessionList,
+		sizeof( aSessionListVectors ) / sizeof( *aSessionListVectors ) },
+	{ "parse-scheduling", checkScheduling,
+		sizeof( aSchedulingVectors ) / sizeof( *aSchedulingVectors ) },
+	{ "parse-placement", checkPlacement,
+		sizeof( aPlacementVectors ) / sizeof( *aPlacementVectors ) }
+};
+
+
+static BOOL runParserVectors( const ParserVectors* pParser )
+{
+	int nFailed = 0;
+	MemoryStats before, after;
+	getMemoryStats( &before );
+	for (int i = 0; i < pParser->nVectors; i++)
+		if (! pParser->fnCheck( i )) nFailed++;
+	getMemoryStats( &after );
+	long nLeakedBytes = after.nLiveBytes - before.nLiveBytes;
+
+	BOOL bPassed = ! nFailed && ! nLeakedBytes;
+	printf( "%-22s %7d %6d %6ld  %s\n", pParser->pszName, pParser->nVectors, nFailed,
+		nLeakedBytes, bPassed ? "ok" : "FAILED" );
+	fflush( stdout );
+	return bPassed;
+}
+
+
+int main( int argc, char* argv[] )
+{
+	BOOL bVerbose = FALSE, bTiming = FALSE;
+	const char* pszFilter = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (! strcmp( argv[ i ], "-s" )) bSequential = TRUE;
+		else if (! strcmp( argv[ i ], "-v" )) bVerbose = TRUE;
+		else if (! strcmp( argv[ i ], "-t" )) bTiming = TRUE;
+		else pszFilter = argv[ i ];
+	}
+
+	// The error messages of the failure scenarios are expected
+	if (! bVerbose) freopen( "/dev/null", "w", stderr );
+	setVerboseOutput( bVerbose );
+	if (bTiming) startTiming();
+
+	setBackend( &fakeBackend );
+
+	printf( "%-22s %6s %16s %17s %6s %5s %8s %6s %6s\n", "scenario", "result", "time",
+		"calls", "allocs", "heap", "missing", "leaks", "bytes" );
+	int nFailed = 0;
+	for (int i = 0; i < sizeof( aScenarios ) / sizeof( *aScenarios ); i++) {
+		if (! pszFilter || strstr( aScenarios[ i ].pszName, pszFilter ))
+			if (! runScenario( &aScenarios[ i ] )) nFailed++;
+	}
+
+	printf( "\n%-22s %7s %6s %6s\n", "parser", "vectors", "failed", "bytes" );
+	for (int i = 0; i < sizeof( aParsers ) / sizeof( *aParsers ); i++) {
+		if (! pszFilter || strstr( aParsers[ i ].pszName, pszFilter ))
+			if (! runParserVectors( &aParsers[ i ] )) nFailed++;
+	}
+
+	if (bTiming) {
+		showTimingReport();
+		showMemoryReport();
+	}
+
+	setBackend( NULL );
+	return nFailed ? 1 : 0;
+}
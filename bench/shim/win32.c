@@ -0,0 +1,715 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/shim/win32.c
+
+	Host implementation of the Win32 functions declared in the shim
+	<windows.h>, on top of the C library
+
+*/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <windows.h>
+
+#include "bench.h"
+
+static wchar_t wszCommandLine[] = L"bench.exe";
+
+static __thread DWORD dwLastError = 0;
+
+// Allocation counters, read by the benchmark harness
+BenchCounters benchCounters = {0};
+
+
+//
+// Memory allocation
+//
+
+HANDLE GetProcessHeap( void )
+{
+	return &benchCounters;
+}
+
+
+LPVOID HeapAlloc( HANDLE hHeap, DWORD dwFlags, SIZE_T dwBytes )
+{
+	benchCounters.nAllocs++;
+	benchCounters.nBytes += dwBytes;
+	// The Windows heap returns a valid block for a zero-size request
+	if (dwBytes == 0) dwBytes = 1;
+	return (dwFlags & HEAP_ZERO_MEMORY) ? calloc( 1, dwBytes ) : malloc( dwBytes );
+}
+
+
+BOOL HeapFree( HANDLE hHeap, DWORD dwFlags, LPVOID lpMem )
+{
+	free( lpMem );
+	return TRUE;
+}
+
+
+//
+// Thread local storage
+//
+
+#define SHIM_TLS_SLOTS 8
+
+static LONG nTlsSlots = 0;
+static __thread LPVOID aTlsValues[ SHIM_TLS_SLOTS ];
+
+
+DWORD TlsAlloc( void )
+{
+	LONG nSlot = __sync_fetch_and_add( &nTlsSlots, 1 );
+	return nSlot < SHIM_TLS_SLOTS ? (DWORD) nSlot : TLS_OUT_OF_INDEXES;
+}
+
+
+// Slots are not reused
+BOOL TlsFree( DWORD dwTlsIndex )
+{
+	return dwTlsIndex < SHIM_TLS_SLOTS;
+}
+
+
+LPVOID TlsGetValue( DWORD dwTlsIndex )
+{
+	if (dwTlsIndex >= SHIM_TLS_SLOTS) {
+		SetLastError( ERROR_INVALID_PARAMETER );
+		return NULL;
+	}
+	SetLastError( ERROR_SUCCESS );
+	return aTlsValues[ dwTlsIndex ];
+}
+
+
+BOOL TlsSetValue( DWORD dwTlsIndex, LPVOID lpTlsValue )
+{
+	if (dwTlsIndex >= SHIM_TLS_SLOTS) {
+		SetLastError( ERROR_INVALID_PARAMETER );
+		return FALSE;
+	}
+	aTlsValues[ dwTlsIndex ] = lpTlsValue;
+	return TRUE;
+}
+
+
+//
+// String formatting
+//
+// The argument list is copied, so that it can be reused by the caller as with
+// the Microsoft CRT, where va_list is a simple pointer.
+//
+
+int _vscwprintf( const wchar_t* format, va_list argptr )
+{
+	// glibc has no way to measure a wide string: grow a scratch buffer until
+	// the result fits.
+	static wchar_t* pScratch = NULL;
+	static size_t nScratchSize = 0;
+
+	if (! pScratch) {
+		nScratchSize = 256;
+		pScratch = malloc( nScratchSize * sizeof( wchar_t ) );
+	}
+
+	for (;;) {
+		va_list args;
+		va_copy( args, argptr );
+		int nLen = vswprintf( pScratch, nScratchSize, format, args );
+		va_end( args );
+		if (nLen >= 0) return nLen;
+		if (nScratchSize >= 0x1000000) return -1;
+		nScratchSize *= 2;
+		pScratch = realloc( pScratch, nScratchSize * sizeof( wchar_t ) );
+	}
+}
+
+
+int _vsnwprintf_s( wchar_t* buffer, size_t sizeOfBuffer, size_t count,
+	const wchar_t* format, va_list argptr )
+{
+	// count is always _TRUNCATE in the sources
+	va_list args;
+	va_copy( args, argptr );
+	int nLen = vswprintf( buffer, sizeOfBuffer, format, args );
+	va_end( args );
+	return nLen;
+}
+
+
+//
+// Standard handles
+//
+// The standard handles are the file descriptors 0 to 2, offset so that they
+// are neither NULL nor INVALID_HANDLE_VALUE.
+//
+
+#define STD_HANDLE_BASE 0x10
+
+static int getHandleFd( HANDLE hFile )
+{
+	uintptr_t n = (uintptr_t) hFile;
+	return (n >= STD_HANDLE_BASE && n <= STD_HANDLE_BASE + 2) ? (int) (n - STD_HANDLE_BASE) : -1;
+}
+
+
+HANDLE GetStdHandle( DWORD nStdHandle )
+{
+	switch (nStdHandle) {
+	case STD_INPUT_HANDLE: return (HANDLE) (uintptr_t) STD_HANDLE_BASE;
+	case STD_OUTPUT_HANDLE: return (HANDLE) (uintptr_t) (STD_HANDLE_BASE + 1);
+	case STD_ERROR_HANDLE: return (HANDLE) (uintptr_t) (STD_HANDLE_BASE + 2);
+	}
+	SetLastError( ERROR_INVALID_HANDLE );
+	return INVALID_HANDLE_VALUE;
+}
+
+
+BOOL GetConsoleMode( HANDLE hConsoleHandle, DWORD* lpMode )
+{
+	int fd = getHandleFd( hConsoleHandle );
+	if (fd < 0 || ! isatty( fd )) {
+		SetLastError( ERROR_INVALID_HANDLE );
+		return FALSE;
+	}
+	*lpMode = 0;
+	return TRUE;
+}
+
+
+BOOL WriteConsoleW( HANDLE hConsoleOutput, const void* lpBuffer, DWORD nNumberOfCharsToWrite,
+	DWORD* lpNumberOfCharsWritten, void* lpReserved )
+{
+	// The terminal is UTF-8
+	char aBuffer[ 4096 ];
+	const wchar_t* pString = lpBuffer;
+	DWORD nLeft = nNumberOfCharsToWrite;
+	while (nLeft) {
+		DWORD nChunk = nLeft < 1024 ? nLeft : 1024;
+		int nBytes = WideCharToMultiByte( CP_UTF8, 0, pString, (int) nChunk, aBuffer,
+			sizeof( aBuffer ), NULL, NULL );
+		if (! WriteFile( hConsoleOutput, aBuffer, (DWORD) nBytes, NULL, NULL )) return FALSE;
+		pString += nChunk;
+		nLeft -= nChunk;
+	}
+	if (lpNumberOfCharsWritten) *lpNumberOfCharsWritten = nNumberOfCharsToWrite;
+	return TRUE;
+}
+
+
+//
+// Character sets
+//
+// Every code page is treated as UTF-8.
+//
+
+UINT GetConsoleOutputCP( void )
+{
+	return CP_UTF8;
+}
+
+
+int MultiByteToWideChar( UINT CodePage, DWORD dwFlags, const char* lpMultiByteStr,
+	int cbMultiByte, wchar_t* lpWideCharStr, int cchWideChar )
+{
+	int nLen = 0;
+	for (int i = 0; i < cbMultiByte; nLen++) {
+		unsigned char c = lpMultiByteStr[ i ];
+		int nExtra = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : 0;
+		wchar_t wc = nExtra ? c & (0x3F >> nExtra) : c;
+		for (i++; nExtra && i < cbMultiByte; nExtra--, i++)
+			wc = (wc << 6) | (lpMultiByteStr[ i ] & 0x3F);
+		if (cchWideChar) {
+			if (nLen >= cchWideChar) return 0;
+			lpWideCharStr[ nLen ] = wc;
+		}
+	}
+	return nLen;
+}
+
+
+int WideCharToMultiByte( UINT CodePage, DWORD dwFlags, const wchar_t* lpWideCharStr,
+	int cchWideChar, char* lpMultiByteStr, int cbMultiByte, const char* lpDefaultChar,
+	BOOL* lpUsedDefaultChar )
+{
+	if (cchWideChar < 0) cchWideChar = (int) wcslen( lpWideCharStr ) + 1;
+
+	int nLen = 0;
+	for (int i = 0; i < cchWideChar; i++) {
+		unsigned long c = (unsigned long) lpWideCharStr[ i ];
+		char aBytes[ 4 ];
+		int nBytes;
+		if (c < 0x80) {
+			aBytes[ 0 ] = (char) c;
+			nBytes = 1;
+		}
+		else if (c < 0x800) {
+			aBytes[ 0 ] = (char) (0xC0 | (c >> 6));
+			aBytes[ 1 ] = (char) (0x80 | (c & 0x3F));
+			nBytes = 2;
+		}
+		else if (c < 0x10000) {
+			aBytes[ 0 ] = (char) (0xE0 | (c >> 12));
+			aBytes[ 1 ] = (char) (0x80 | ((c >> 6) & 0x3F));
+			aBytes[ 2 ] = (char) (0x80 | (c & 0x3F));
+			nBytes = 3;
+		}
+		else {
+			aBytes[ 0 ] = (char) (0xF0 | (c >> 18));
+			aBytes[ 1 ] = (char) (0x80 | ((c >> 12) & 0x3F));
+			aBytes[ 2 ] = (char) (0x80 | ((c >> 6) & 0x3F));
+			aBytes[ 3 ] = (char) (0x80 | (c & 0x3F));
+			nBytes = 4;
+		}
+		if (cbMultiByte) {
+			if (nLen + nBytes > cbMultiByte) return 0;
+			memcpy( lpMultiByteStr + nLen, aBytes, nBytes );
+		}
+		nLen += nBytes;
+	}
+	return nLen;
+}
+
+
+//
+// Process, time and files
+//
+
+wchar_t* GetCommandLine( void )
+{
+	return wszCommandLine;
+}
+
+
+DWORD GetLastError( void )
+{
+	return dwLastError;
+}
+
+
+void SetLastError( DWORD dwErrCode )
+{
+	dwLastError = dwErrCode;
+}
+
+
+HANDLE GetCurrentProcess( void )
+{
+	return (HANDLE) (long) -1;
+}
+
+
+HANDLE GetCurrentThread( void )
+{
+	return (HANDLE) (long) -2;
+}
+
+
+DWORD GetCurrentProcessId( void )
+{
+	return (DWORD) getpid();
+}
+
+
+DWORD GetCurrentThreadId( void )
+{
+	return (DWORD) gettid();
+}
+
+
+LONG InterlockedIncrement( LONG volatile* Addend )
+{
+	return __sync_add_and_fetch( Addend, 1 );
+}
+
+
+LONG InterlockedExchangeAdd( LONG volatile* Addend, LONG Value )
+{
+	return __sync_fetch_and_add( Addend, Value );
+}
+
+
+LONG InterlockedCompareExchange( LONG volatile* Destination, LONG Exchange, LONG Comperand )
+{
+	return __sync_val_compare_and_swap( Destination, Comperand, Exchange );
+}
+
+
+// The performance counter is in nanoseconds
+BOOL QueryPerformanceCounter( LARGE_INTEGER* lpPerformanceCount )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	lpPerformanceCount->QuadPart = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	return TRUE;
+}
+
+
+BOOL QueryPerformanceFrequency( LARGE_INTEGER* lpFrequency )
+{
+	lpFrequency->QuadPart = 1000000000LL;
+	return TRUE;
+}
+
+
+ULONGLONG GetTickCount64( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+
+void Sleep( DWORD dwMilliseconds )
+{
+	struct timespec ts = {
+		.tv_sec = dwMilliseconds / 1000,
+		.tv_nsec = (dwMilliseconds % 1000) * 1000000L
+	};
+	nanosleep( &ts, NULL );
+}
+
+
+// There are no asynchronous procedure calls on the host
+DWORD SleepEx( DWORD dwMilliseconds, BOOL bAlertable )
+{
+	Sleep( dwMilliseconds );
+	return 0;
+}
+
+
+LONG CompareFileTime( const FILETIME* lpFileTime1, const FILETIME* lpFileTime2 )
+{
+	ULONGLONG ull1 = ((ULONGLONG) lpFileTime1->dwHighDateTime << 32) |
+		lpFileTime1->dwLowDateTime;
+	ULONGLONG ull2 = ((ULONGLONG) lpFileTime2->dwHighDateTime << 32) |
+		lpFileTime2->dwLowDateTime;
+	return (ull1 > ull2) - (ull1 < ull2);
+}
+
+
+// Only the LocalSystem SID (S-1-5-18) is known
+BOOL IsWellKnownSid( PSID pSid, WELL_KNOWN_SID_TYPE WellKnownSidType )
+{
+	static const BYTE abLocalSystemSid[] = { 1, 1, 0, 0, 0, 0, 0, 5, 18, 0, 0, 0 };
+	return WellKnownSidType == WinLocalSystemSid &&
+		! memcmp( pSid, abLocalSystemSid, sizeof( abLocalSystemSid ) );
+}
+
+
+HANDLE CreateFileW( LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode,
+	LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition,
+	DWORD dwFlagsAndAttributes, HANDLE hTemplateFile )
+{
+	SetLastError( ERROR_CALL_NOT_IMPLEMENTED );
+	return INVALID_HANDLE_VALUE;
+}
+
+
+DWORD GetFileAttributesW( LPCWSTR lpFileName )
+{
+	SetLastError( ERROR_CALL_NOT_IMPLEMENTED );
+	return INVALID_FILE_ATTRIBUTES;
+}
+
+
+BOOL GetFileSizeEx( HANDLE hFile, LARGE_INTEGER* lpFileSize )
+{
+	SetLastError( ERROR_CALL_NOT_IMPLEMENTED );
+	return FALSE;
+}
+
+
+BOOL ReadFile( HANDLE hFile, void* lpBuffer, DWORD nNumberOfBytesToRead,
+	DWORD* lpNumberOfBytesRead, void* lpOverlapped )
+{
+	SetLastError( ERROR_CALL_NOT_IMPLEMENTED );
+	return FALSE;
+}
+
+
+BOOL WriteFile( HANDLE hFile, const void* lpBuffer, DWORD nNumberOfBytesToWrite,
+	DWORD* lpNumberOfBytesWritten, void* lpOverlapped )
+{
+	int fd = getHandleFd( hFile );
+	if (fd < 0) {
+		SetLastError( ERROR_CALL_NOT_IMPLEMENTED );
+		return FALSE;
+	}
+
+	ssize_t nWritten = write( fd, lpBuffer, nNumberOfBytesToWrite );
+	if (nWritten < 0) {
+		SetLastError( ERROR_INVALID_HANDLE );
+		return FALSE;
+	}
+	if (lpNumberOfBytesWritten) *lpNumberOfBytesWritten = (DWORD) nWritten;
+	return TRUE;
+}
+
+
+//
+// Threads
+//
+// Thread handles are entries of a table, so that CloseHandle can recognize
+// them. Other handles need no closing.
+//
+
+#define SHIM_MAX_THREADS 16
+
+typedef struct {
+	BOOL bUsed;
+	BOOL bJoined;
+	pthread_t thread;
+	LPTHREAD_START_ROUTINE lpStartAddress;
+	LPVOID lpParameter;
+} ShimThread;
+
+static ShimThread aThreads[ SHIM_MAX_THREADS ];
+static pthread_mutex_t threadMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+static ShimThread* getThread( HANDLE hObject )
+{
+	ShimThread* pThread = hObject;
+	if (pThread < aThreads || pThread >= aThreads + SHIM_MAX_THREADS) return NULL;
+	return pThread;
+}
+
+
+static void* runThread( void* pParameter )
+{
+	ShimThread* pThread = pParameter;
+	pThread->lpStartAddress( pThread->lpParameter );
+	return NULL;
+}
+
+
+HANDLE CreateThread( LPSECURITY_ATTRIBUTES lpThreadAttributes, SIZE_T dwStackSize,
+	LPTHREAD_START_ROUTINE lpStartAddress, LPVOID lpParameter, DWORD dwCreationFlags,
+	LPDWORD lpThreadId )
+{
+	ShimThread* pThread = NULL;
+	pthread_mutex_lock( &threadMutex );
+	for (int i = 0; i < SHIM_MAX_THREADS && ! pThread; i++) {
+		if (! aThreads[ i ].bUsed) {
+			pThread = &aThreads[ i ];
+			pThread->bUsed = TRUE;
+		}
+	}
+	pthread_mutex_unlock( &threadMutex );
+	if (! pThread) {
+		SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+		return NULL;
+	}
+
+	pThread->bJoined = FALSE;
+	pThread->lpStartAddress = lpStartAddress;
+	pThread->lpParameter = lpParameter;
+	if (pthread_create( &pThread->thread, NULL, runThread, pThread )) {
+		pThread->bUsed = FALSE;
+		SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+		return NULL;
+	}
+	if (lpThreadId) *lpThreadId = 0;
+	return pThread;
+}
+
+
+DWORD WaitForSingleObject( HANDLE hHandle, DWORD dwMilliseconds )
+{
+	ShimThread* pThread = getThread( hHandle );
+	if (! pThread || dwMilliseconds != INFINITE) {
+		SetLastError( ERROR_CALL_NOT_IMPLEMENTED );
+		return (DWORD) -1;
+	}
+	if (! pThread->bJoined) {
+		pthread_join( pThread->thread, NULL );
+		pThread->bJoined = TRUE;
+	}
+	return WAIT_OBJECT_0;
+}
+
+
+DWORD WaitForMultipleObjects( DWORD nCount, const HANDLE* lpHandles, BOOL bWaitAll,
+	DWORD dwMilliseconds )
+{
+	SetLastError( ERROR_CALL_NOT_IMPLEMENTED );
+	return WAIT_FAILED;
+}
+
+
+BOOL CloseHandle( HANDLE hObject )
+{
+	ShimThread* pThread = getThread( hObject );
+	if (pThread) {
+		if (! pThread->bJoined) pthread_detach( pThread->thread );
+		pThread->bUsed = FALSE;
+	}
+	return TRUE;
+}
+
+
+// Only the thread handles are counted
+BOOL GetProcessHandleCount( HANDLE hProcess, PDWORD pdwHandleCount )
+{
+	DWORD dwCount = 0;
+	pthread_mutex_lock( &threadMutex );
+	for (int i = 0; i < SHIM_MAX_THREADS; i++) dwCount += aThreads[ i ].bUsed;
+	pthread_mutex_unlock( &threadMutex );
+	*pdwHandleCount = dwCount;
+	return TRUE;
+}
+
+
+//
+// System functions of the Win32 backend
+//
+// They all fail: the launch pipeline runs with the fake backend.
+//
+
+#define UNAVAILABLE( result ) \
+	do { \
+		SetLastError( ERROR_CALL_NOT_IMPLEMENTED ); \
+		return result; \
+	} while (0)
+
+HMODULE GetModuleHandleW( LPCWSTR lpModuleName )
+{ UNAVAILABLE( NULL ); }
+
+void* GetProcAddress( HMODULE hModule, const char* lpProcName )
+{ UNAVAILABLE( NULL ); }
+
+HMODULE LoadLibraryW( LPCWSTR lpLibFileName )
+{ UNAVAILABLE( NULL ); }
+
+UINT GetSystemDirectoryW( LPWSTR lpBuffer, UINT uSize )
+{ UNAVAILABLE( 0 ); }
+
+HANDLE OpenProcess( DWORD dwDesiredAccess, BOOL bInheritHandle, DWORD dwProcessId )
+{ UNAVAILABLE( NULL ); }
+
+DWORD GetProcessId( HANDLE hProcess )
+{ UNAVAILABLE( 0 ); }
+
+BOOL GetProcessTimes( HANDLE hProcess, LPFILETIME lpCreationTime, LPFILETIME lpExitTime,
+	LPFILETIME lpKernelTime, LPFILETIME lpUserTime )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL GetExitCodeProcess( HANDLE hProcess, LPDWORD lpExitCode )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL QueryFullProcessImageNameW( HANDLE hProcess, DWORD dwFlags, LPWSTR lpExeName,
+	PDWORD lpdwSize )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL ProcessIdToSessionId( DWORD dwProcessId, DWORD* pSessionId )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL GetNamedPipeServerProcessId( HANDLE hPipe, PULONG ServerProcessId )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL CreateProcessAsUserW( HANDLE hToken, LPCWSTR lpApplicationName, LPWSTR lpCommandLine,
+	LPSECURITY_ATTRIBUTES lpProcessAttributes, LPSECURITY_ATTRIBUTES lpThreadAttributes,
+	BOOL bInheritHandles, DWORD dwCreationFlags, LPVOID lpEnvironment,
+	LPCWSTR lpCurrentDirectory, LPSTARTUPINFOW lpStartupInfo,
+	LPPROCESS_INFORMATION lpProcessInformation )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL UpdateProcThreadAttribute( LPPROC_THREAD_ATTRIBUTE_LIST lpAttributeList, DWORD dwFlags,
+	ULONG_PTR Attribute, PVOID lpValue, SIZE_T cbSize, PVOID lpPreviousValue,
+	SIZE_T* lpReturnSize )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL GetNumaHighestNodeNumber( PULONG HighestNodeNumber )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL OpenProcessToken( HANDLE hProcess, DWORD dwDesiredAccess, PHANDLE phToken )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL DuplicateTokenEx( HANDLE hExistingToken, DWORD dwDesiredAccess,
+	LPSECURITY_ATTRIBUTES lpTokenAttributes, SECURITY_IMPERSONATION_LEVEL ImpersonationLevel,
+	TOKEN_TYPE TokenType, PHANDLE phNewToken )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL AdjustTokenPrivileges( HANDLE hToken, BOOL bDisableAllPrivileges,
+	PTOKEN_PRIVILEGES NewState, DWORD BufferLength, PTOKEN_PRIVILEGES PreviousState,
+	PDWORD ReturnLength )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL GetTokenInformation( HANDLE hToken, TOKEN_INFORMATION_CLASS TokenInformationClass,
+	LPVOID TokenInformation, DWORD TokenInformationLength, PDWORD ReturnLength )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL SetTokenInformation( HANDLE hToken, TOKEN_INFORMATION_CLASS TokenInformationClass,
+	LPVOID TokenInformation, DWORD TokenInformationLength )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL SetThreadToken( PHANDLE phThread, HANDLE hToken )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL OpenThreadToken( HANDLE ThreadHandle, DWORD DesiredAccess, BOOL OpenAsSelf,
+	PHANDLE TokenHandle )
+{ UNAVAILABLE( FALSE ); }
+
+SC_HANDLE OpenSCManagerW( LPCWSTR lpMachineName, LPCWSTR lpDatabaseName,
+	DWORD dwDesiredAccess )
+{ UNAVAILABLE( NULL ); }
+
+SC_HANDLE OpenServiceW( SC_HANDLE hSCManager, LPCWSTR lpServiceName, DWORD dwDesiredAccess )
+{ UNAVAILABLE( NULL ); }
+
+BOOL QueryServiceStatusEx( SC_HANDLE hService, SC_STATUS_TYPE InfoLevel, LPBYTE lpBuffer,
+	DWORD cbBufSize, LPDWORD pcbBytesNeeded )
+{ UNAVAILABLE( FALSE ); }
+
+BOOL StartServiceW( SC_HANDLE hService, DWORD dwNumServiceArgs,
+	LPCWSTR* lpServiceArgVectors )
+{ UNAVAILABLE( FALSE ); }
+
+DWORD NotifyServiceStatusChangeW( SC_HANDLE hService, DWORD dwNotifyMask,
+	PSERVICE_NOTIFYW pNotifyBuffer )
+{
+	return ERROR_CALL_NOT_IMPLEMENTED;
+}
+
+BOOL CloseServiceHandle( SC_HANDLE hSCObject )
+{ UNAVAILABLE( FALSE ); }
+
+LSTATUS RegOpenKeyExW( HKEY hKey, LPCWSTR lpSubKey, DWORD ulOptions, REGSAM samDesired,
+	PHKEY phkResult )
+{
+	return ERROR_CALL_NOT_IMPLEMENTED;
+}
+
+LSTATUS RegCreateKeyExW( HKEY hKey, LPCWSTR lpSubKey, DWORD Reserved, LPWSTR lpClass,
+	DWORD dwOptions, REGSAM samDesired, const LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+	PHKEY phkResult, LPDWORD lpdwDisposition )
+{
+	return ERROR_CALL_NOT_IMPLEMENTED;
+}
+
+LSTATUS RegQueryValueExW( HKEY hKey, LPCWSTR lpValueName, LPDWORD lpReserved,
+	LPDWORD lpType, LPBYTE lpData, LPDWORD lpcbData )
+{
+	return ERROR_CALL_NOT_IMPLEMENTED;
+}
+
+LSTATUS RegSetValueExW( HKEY hKey, LPCWSTR lpValueName, DWORD Reserved, DWORD dwType,
+	const BYTE* lpData, DWORD cbData )
+{
+	return ERROR_CALL_NOT_IMPLEMENTED;
+}
+
+LSTATUS RegCloseKey( HKEY hKey )
+{
+	return ERROR_CALL_NOT_IMPLEMENTED;
+}
@@ -0,0 +1,542 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/shim/windows.h
+
+	Minimal <windows.h> replacement for the host-native benchmarks
+
+	Only declares what the benchmarked modules use. The functions are
+	implemented in win32.c on top of the C library. The system functions
+	(processes, tokens, services, registry) are unavailable: the launch
+	pipeline runs with the fake backend (see backend_fake.c).
+
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>  // Included by the real <windows.h>
+#include <wchar.h>
+
+#define WINAPI
+#define CALLBACK
+#define NTAPI
+
+// Basic types
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned short USHORT;
+typedef unsigned int UINT;
+typedef long LONG;
+typedef unsigned long ULONG;
+typedef unsigned long DWORD;  // Keeps the "%lX" formats of the sources valid
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef size_t SIZE_T;
+typedef size_t ULONG_PTR;
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef void* HANDLE;
+typedef void* HMODULE;
+typedef const wchar_t* LPCWSTR;
+typedef wchar_t* LPWSTR;
+typedef wchar_t* PWSTR;
+typedef BYTE* LPBYTE;
+typedef DWORD* PDWORD;
+typedef DWORD* LPDWORD;
+typedef ULONG* PULONG;
+typedef HANDLE* PHANDLE;
+typedef LONG LSTATUS;
+
+typedef union {
+	struct {
+		DWORD LowPart;
+		LONG HighPart;
+	};
+	long long QuadPart;
+} LARGE_INTEGER;
+
+typedef union {
+	struct {
+		DWORD LowPart;
+		DWORD HighPart;
+	};
+	unsigned long long QuadPart;
+} ULARGE_INTEGER;
+
+typedef struct {
+	DWORD LowPart;
+	LONG HighPart;
+} LUID;
+
+typedef struct {
+	LUID Luid;
+	DWORD Attributes;
+} LUID_AND_ATTRIBUTES;
+
+typedef struct {
+	DWORD dwLowDateTime;
+	DWORD dwHighDateTime;
+} FILETIME, *LPFILETIME;
+
+typedef struct {
+	DWORD nLength;
+	LPVOID lpSecurityDescriptor;
+	BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES, *LPSECURITY_ATTRIBUTES;
+
+// Tokens
+
+typedef void* PSID;
+
+typedef struct {
+	PSID Sid;
+	DWORD Attributes;
+} SID_AND_ATTRIBUTES;
+
+typedef struct {
+	SID_AND_ATTRIBUTES User;
+} TOKEN_USER;
+
+typedef struct {
+	DWORD PrivilegeCount;
+	LUID_AND_ATTRIBUTES Privileges[ 1 ];
+} TOKEN_PRIVILEGES, *PTOKEN_PRIVILEGES;
+
+typedef enum {
+	SecurityAnonymous,
+	SecurityIdentification,
+	SecurityImpersonation,
+	SecurityDelegation
+} SECURITY_IMPERSONATION_LEVEL;
+
+typedef enum {
+	TokenPrimary = 1,
+	TokenImpersonation
+} TOKEN_TYPE;
+
+typedef enum {
+	TokenUser = 1,
+	TokenPrivileges = 3,
+	TokenSessionId = 12
+} TOKEN_INFORMATION_CLASS;
+
+typedef enum {
+	WinLocalSystemSid = 22
+} WELL_KNOWN_SID_TYPE;
+
+#define SECURITY_MAX_SID_SIZE 68
+
+#define TOKEN_ASSIGN_PRIMARY 0x0001
+#define TOKEN_DUPLICATE 0x0002
+#define TOKEN_IMPERSONATE 0x0004
+#define TOKEN_QUERY 0x0008
+#define TOKEN_ADJUST_PRIVILEGES 0x0020
+#define TOKEN_ADJUST_DEFAULT 0x0080
+#define TOKEN_ADJUST_SESSIONID 0x0100
+
+// Processes
+
+#define PROCESS_DUP_HANDLE 0x0040
+#define PROCESS_CREATE_PROCESS 0x0080
+#define PROCESS_QUERY_INFORMATION 0x0400
+#define PROCESS_QUERY_LIMITED_INFORMATION 0x1000
+#define STILL_ACTIVE 259
+#define MAX_PATH 260
+
+typedef struct {
+	DWORD cb;
+	LPWSTR lpReserved;
+	LPWSTR lpDesktop;
+	LPWSTR lpTitle;
+	DWORD dwX;
+	DWORD dwY;
+	DWORD dwXSize;
+	DWORD dwYSize;
+	DWORD dwXCountChars;
+	DWORD dwYCountChars;
+	DWORD dwFillAttribute;
+	DWORD dwFlags;
+	WORD wShowWindow;
+	WORD cbReserved2;
+	LPBYTE lpReserved2;
+	HANDLE hStdInput;
+	HANDLE hStdOutput;
+	HANDLE hStdError;
+} STARTUPINFOW, STARTUPINFO, *LPSTARTUPINFOW;
+
+typedef struct {
+	HANDLE hProcess;
+	HANDLE hThread;
+	DWORD dwProcessId;
+	DWORD dwThreadId;
+} PROCESS_INFORMATION, *LPPROCESS_INFORMATION;
+
+#define CREATE_NEW_CONSOLE 0x00000010
+#define STARTF_USESHOWWINDOW 0x00000001
+#define SW_SHOWNORMAL 1
+#define SW_SHOWMINNOACTIVE 7
+
+// Priority classes
+#define IDLE_PRIORITY_CLASS 0x00000040
+#define BELOW_NORMAL_PRIORITY_CLASS 0x00004000
+#define NORMAL_PRIORITY_CLASS 0x00000020
+#define ABOVE_NORMAL_PRIORITY_CLASS 0x00008000
+#define HIGH_PRIORITY_CLASS 0x00000080
+
+// Processor groups and process attributes
+typedef ULONG_PTR KAFFINITY;
+
+typedef struct {
+	KAFFINITY Mask;
+	WORD Group;
+	WORD Reserved[ 3 ];
+} GROUP_AFFINITY, *PGROUP_AFFINITY;
+
+typedef struct _PROC_THREAD_ATTRIBUTE_LIST* LPPROC_THREAD_ATTRIBUTE_LIST;
+
+// Services
+
+typedef void* SC_HANDLE;
+
+typedef enum {
+	SC_STATUS_PROCESS_INFO = 0
+} SC_STATUS_TYPE;
+
+typedef struct {
+	DWORD dwServiceType;
+	DWORD dwCurrentState;
+	DWORD dwControlsAccepted;
+	DWORD dwWin32ExitCode;
+	DWORD dwServiceSpecificExitCode;
+	DWORD dwCheckPoint;
+	DWORD dwWaitHint;
+	DWORD dwProcessId;
+	DWORD dwServiceFlags;
+} SERVICE_STATUS_PROCESS;
+
+typedef void (CALLBACK* PFN_SC_NOTIFY_CALLBACK)( PVOID pParameter );
+
+typedef struct {
+	DWORD dwVersion;
+	PFN_SC_NOTIFY_CALLBACK pfnNotifyCallback;
+	PVOID pContext;
+	DWORD dwNotificationStatus;
+	SERVICE_STATUS_PROCESS ServiceStatus;
+	DWORD dwNotificationTriggered;
+	LPWSTR pszServiceNames;
+} SERVICE_NOTIFYW, SERVICE_NOTIFY, *PSERVICE_NOTIFYW;
+
+#define SC_MANAGER_CONNECT 0x0001
+#define SERVICE_QUERY_STATUS 0x0004
+#define SERVICE_START 0x0010
+
+#define SERVICE_STOPPED 1
+#define SERVICE_START_PENDING 2
+#define SERVICE_STOP_PENDING 3
+#define SERVICE_RUNNING 4
+#define SERVICE_CONTINUE_PENDING 5
+#define SERVICE_PAUSE_PENDING 6
+#define SERVICE_PAUSED 7
+
+#define SERVICE_NOTIFY_STATUS_CHANGE 2
+#define SERVICE_NOTIFY_STOPPED 0x0001
+#define SERVICE_NOTIFY_START_PENDING 0x0002
+#define SERVICE_NOTIFY_STOP_PENDING 0x0004
+#define SERVICE_NOTIFY_RUNNING 0x0008
+#define SERVICE_NOTIFY_CONTINUE_PENDING 0x0010
+#define SERVICE_NOTIFY_PAUSE_PENDING 0x0020
+#define SERVICE_NOTIFY_PAUSED 0x0040
+
+// Registry
+
+typedef void* HKEY;
+typedef HKEY* PHKEY;
+typedef DWORD REGSAM;
+
+#define HKEY_LOCAL_MACHINE ((HKEY) (ULONG_PTR) 0x80000002)
+#define KEY_QUERY_VALUE 0x0001
+#define KEY_SET_VALUE 0x0002
+#define KEY_WOW64_64KEY 0x0100
+#define REG_OPTION_VOLATILE 1
+#define REG_BINARY 3
+
+#define TRUE 1
+#define FALSE 0
+
+#define TEXT(s) L##s
+
+#define __declspec(x) __attribute__((x))
+
+// Constants
+
+#define CP_UTF8 65001
+#define FILE_APPEND_DATA 0x0004
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define FILE_READ_ATTRIBUTES 0x0080
+#define FILE_SHARE_READ 0x00000001
+#define GENERIC_READ 0x80000000
+#define HEAP_ZERO_MEMORY 0x00000008
+#define INVALID_FILE_ATTRIBUTES ((DWORD) -1)
+#define INVALID_HANDLE_VALUE ((HANDLE) (long) -1)
+#define MEMORY_ALLOCATION_ALIGNMENT 16
+#define OPEN_ALWAYS 4
+#define OPEN_EXISTING 3
+#define SE_PRIVILEGE_ENABLED 0x00000002L
+#define STD_INPUT_HANDLE ((DWORD) -10)
+#define STD_OUTPUT_HANDLE ((DWORD) -11)
+#define STD_ERROR_HANDLE ((DWORD) -12)
+#define WAIT_IO_COMPLETION 0x000000C0L
+#define _TRUNCATE ((size_t) -1)
+
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_ENOUGH_MEMORY 8L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_CALL_NOT_IMPLEMENTED 120L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_PROC_NOT_FOUND 127L
+#define ERROR_MORE_DATA 234L
+#define ERROR_SERVICE_REQUEST_TIMEOUT 1053L
+#define ERROR_SERVICE_ALREADY_RUNNING 1056L
+#define ERROR_SERVICE_DOES_NOT_EXIST 1060L
+#define ERROR_SERVICE_CANNOT_ACCEPT_CTRL 1061L
+#define ERROR_PROCESS_ABORTED 1067L
+#define ERROR_NOT_ALL_ASSIGNED 1300L
+
+#define ZeroMemory( p, n ) memset( (p), 0, (n) )
+
+// Privileges
+
+#define SE_CREATE_TOKEN_NAME TEXT("SeCreateTokenPrivilege")
+#define SE_ASSIGNPRIMARYTOKEN_NAME TEXT("SeAssignPrimaryTokenPrivilege")
+#define SE_LOCK_MEMORY_NAME TEXT("SeLockMemoryPrivilege")
+#define SE_INCREASE_QUOTA_NAME TEXT("SeIncreaseQuotaPrivilege")
+#define SE_MACHINE_ACCOUNT_NAME TEXT("SeMachineAccountPrivilege")
+#define SE_TCB_NAME TEXT("SeTcbPrivilege")
+#define SE_SECURITY_NAME TEXT("SeSecurityPrivilege")
+#define SE_TAKE_OWNERSHIP_NAME TEXT("SeTakeOwnershipPrivilege")
+#define SE_LOAD_DRIVER_NAME TEXT("SeLoadDriverPrivilege")
+#define SE_SYSTEM_PROFILE_NAME TEXT("SeSystemProfilePrivilege")
+#define SE_SYSTEMTIME_NAME TEXT("SeSystemtimePrivilege")
+#define SE_PROF_SINGLE_PROCESS_NAME TEXT("SeProfileSingleProcessPrivilege")
+#define SE_INC_BASE_PRIORITY_NAME TEXT("SeIncreaseBasePriorityPrivilege")
+#define SE_CREATE_PAGEFILE_NAME TEXT("SeCreatePagefilePrivilege")
+#define SE_CREATE_PERMANENT_NAME TEXT("SeCreatePermanentPrivilege")
+#define SE_BACKUP_NAME TEXT("SeBackupPrivilege")
+#define SE_RESTORE_NAME TEXT("SeRestorePrivilege")
+#define SE_SHUTDOWN_NAME TEXT("SeShutdownPrivilege")
+#define SE_DEBUG_NAME TEXT("SeDebugPrivilege")
+#define SE_AUDIT_NAME TEXT("SeAuditPrivilege")
+#define SE_SYSTEM_ENVIRONMENT_NAME TEXT("SeSystemEnvironmentPrivilege")
+#define SE_CHANGE_NOTIFY_NAME TEXT("SeChangeNotifyPrivilege")
+#define SE_REMOTE_SHUTDOWN_NAME TEXT("SeRemoteShutdownPrivilege")
+#define SE_UNDOCK_NAME TEXT("SeUndockPrivilege")
+#define SE_SYNC_AGENT_NAME TEXT("SeSyncAgentPrivilege")
+#define SE_ENABLE_DELEGATION_NAME TEXT("SeEnableDelegationPrivilege")
+#define SE_MANAGE_VOLUME_NAME TEXT("SeManageVolumePrivilege")
+#define SE_IMPERSONATE_NAME TEXT("SeImpersonatePrivilege")
+#define SE_CREATE_GLOBAL_NAME TEXT("SeCreateGlobalPrivilege")
+#define SE_TRUSTED_CREDMAN_ACCESS_NAME TEXT("SeTrustedCredManAccessPrivilege")
+#define SE_RELABEL_NAME TEXT("SeRelabelPrivilege")
+#define SE_INC_WORKING_SET_NAME TEXT("SeIncreaseWorkingSetPrivilege")
+#define SE_TIME_ZONE_NAME TEXT("SeTimeZonePrivilege")
+#define SE_CREATE_SYMBOLIC_LINK_NAME TEXT("SeCreateSymbolicLinkPrivilege")
+#define SE_UNSOLICITED_INPUT_NAME TEXT("SeUnsolicitedInputPrivilege")
+
+#define SE_CREATE_TOKEN_PRIVILEGE (2L)
+#define SE_ASSIGNPRIMARYTOKEN_PRIVILEGE (3L)
+#define SE_LOCK_MEMORY_PRIVILEGE (4L)
+#define SE_INCREASE_QUOTA_PRIVILEGE (5L)
+#define SE_MACHINE_ACCOUNT_PRIVILEGE (6L)
+#define SE_TCB_PRIVILEGE (7L)
+#define SE_SECURITY_PRIVILEGE (8L)
+#define SE_TAKE_OWNERSHIP_PRIVILEGE (9L)
+#define SE_LOAD_DRIVER_PRIVILEGE (10L)
+#define SE_SYSTEM_PROFILE_PRIVILEGE (11L)
+#define SE_SYSTEMTIME_PRIVILEGE (12L)
+#define SE_PROF_SINGLE_PROCESS_PRIVILEGE (13L)
+#define SE_INC_BASE_PRIORITY_PRIVILEGE (14L)
+#define SE_CREATE_PAGEFILE_PRIVILEGE (15L)
+#define SE_CREATE_PERMANENT_PRIVILEGE (16L)
+#define SE_BACKUP_PRIVILEGE (17L)
+#define SE_RESTORE_PRIVILEGE (18L)
+#define SE_SHUTDOWN_PRIVILEGE (19L)
+#define SE_DEBUG_PRIVILEGE (20L)
+#define SE_AUDIT_PRIVILEGE (21L)
+#define SE_SYSTEM_ENVIRONMENT_PRIVILEGE (22L)
+#define SE_CHANGE_NOTIFY_PRIVILEGE (23L)
+#define SE_REMOTE_SHUTDOWN_PRIVILEGE (24L)
+#define SE_UNDOCK_PRIVILEGE (25L)
+#define SE_SYNC_AGENT_PRIVILEGE (26L)
+#define SE_ENABLE_DELEGATION_PRIVILEGE (27L)
+#define SE_MANAGE_VOLUME_PRIVILEGE (28L)
+#define SE_IMPERSONATE_PRIVILEGE (29L)
+#define SE_CREATE_GLOBAL_PRIVILEGE (30L)
+#define SE_TRUSTED_CREDMAN_ACCESS_PRIVILEGE (31L)
+#define SE_RELABEL_PRIVILEGE (32L)
+#define SE_INC_WORKING_SET_PRIVILEGE (33L)
+#define SE_TIME_ZONE_PRIVILEGE (34L)
+#define SE_CREATE_SYMBOLIC_LINK_PRIVILEGE (35L)
+
+// Memory allocation (counted by the benchmark harness)
+
+HANDLE GetProcessHeap( void );
+LPVOID HeapAlloc( HANDLE hHeap, DWORD dwFlags, SIZE_T dwBytes );
+BOOL HeapFree( HANDLE hHeap, DWORD dwFlags, LPVOID lpMem );
+
+// Thread local storage (a fixed number of slots)
+
+#define TLS_OUT_OF_INDEXES ((DWORD) 0xFFFFFFFF)
+DWORD TlsAlloc( void );
+BOOL TlsFree( DWORD dwTlsIndex );
+LPVOID TlsGetValue( DWORD dwTlsIndex );
+BOOL TlsSetValue( DWORD dwTlsIndex, LPVOID lpTlsValue );
+
+// String formatting
+
+int _vscwprintf( const wchar_t* format, va_list argptr );
+int _vsnwprintf_s( wchar_t* buffer, size_t sizeOfBuffer, size_t count,
+	const wchar_t* format, va_list argptr );
+#define _wcsicmp wcscasecmp
+#define _wcsnicmp wcsncasecmp
+
+// Character sets
+
+#define IS_HIGH_SURROGATE(wch) (((wch) & 0xFC00) == 0xD800)
+UINT GetConsoleOutputCP( void );
+int MultiByteToWideChar( UINT CodePage, DWORD dwFlags, const char* lpMultiByteStr,
+	int cbMultiByte, wchar_t* lpWideCharStr, int cchWideChar );
+int WideCharToMultiByte( UINT CodePage, DWORD dwFlags, const wchar_t* lpWideCharStr,
+	int cchWideChar, char* lpMultiByteStr, int cbMultiByte, const char* lpDefaultChar,
+	BOOL* lpUsedDefaultChar );
+
+// Standard handles (the file descriptors; a terminal is a console)
+
+HANDLE GetStdHandle( DWORD nStdHandle );
+BOOL GetConsoleMode( HANDLE hConsoleHandle, DWORD* lpMode );
+BOOL WriteConsoleW( HANDLE hConsoleOutput, const void* lpBuffer, DWORD nNumberOfCharsToWrite,
+	DWORD* lpNumberOfCharsWritten, void* lpReserved );
+
+// Process, time and files (the file functions always fail, except
+// WriteFile on a standard handle)
+
+wchar_t* GetCommandLine( void );
+DWORD GetLastError( void );
+void SetLastError( DWORD dwErrCode );
+HANDLE GetCurrentProcess( void );
+HANDLE GetCurrentThread( void );
+DWORD GetCurrentProcessId( void );
+DWORD GetCurrentThreadId( void );
+LONG InterlockedIncrement( LONG volatile* Addend );
+LONG InterlockedExchangeAdd( LONG volatile* Addend, LONG Value );
+LONG InterlockedCompareExchange( LONG volatile* Destination, LONG Exchange, LONG Comperand );
+BOOL GetProcessHandleCount( HANDLE hProcess, PDWORD pdwHandleCount );
+BOOL QueryPerformanceCounter( LARGE_INTEGER* lpPerformanceCount );
+BOOL QueryPerformanceFrequency( LARGE_INTEGER* lpFrequency );
+LONG CompareFileTime( const FILETIME* lpFileTime1, const FILETIME* lpFileTime2 );
+BOOL IsWellKnownSid( PSID pSid, WELL_KNOWN_SID_TYPE WellKnownSidType );
+
+#define CreateFile CreateFileW
+#define GetFileAttributes GetFileAttributesW
+HANDLE CreateFileW( LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode,
+	LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition,
+	DWORD dwFlagsAndAttributes, HANDLE hTemplateFile );
+DWORD GetFileAttributesW( LPCWSTR lpFileName );
+BOOL GetFileSizeEx( HANDLE hFile, LARGE_INTEGER* lpFileSize );
+BOOL ReadFile( HANDLE hFile, void* lpBuffer, DWORD nNumberOfBytesToRead,
+	DWORD* lpNumberOfBytesRead, void* lpOverlapped );
+BOOL WriteFile( HANDLE hFile, const void* lpBuffer, DWORD nNumberOfBytesToWrite,
+	DWORD* lpNumberOfBytesWritten, void* lpOverlapped );
+BOOL CloseHandle( HANDLE hObject );
+
+// Threads (POSIX threads): only thread handles can be waited for
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0x00000000L
+#define WAIT_FAILED ((DWORD) 0xFFFFFFFF)
+#define MAXIMUM_WAIT_OBJECTS 64
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)( LPVOID lpParameter );
+HANDLE CreateThread( LPSECURITY_ATTRIBUTES lpThreadAttributes, SIZE_T dwStackSize,
+	LPTHREAD_START_ROUTINE lpStartAddress, LPVOID lpParameter, DWORD dwCreationFlags,
+	LPDWORD lpThreadId );
+DWORD WaitForSingleObject( HANDLE hHandle, DWORD dwMilliseconds );
+DWORD WaitForMultipleObjects( DWORD nCount, const HANDLE* lpHandles, BOOL bWaitAll,
+	DWORD dwMilliseconds );
+
+// System functions of the Win32 backend (always fail)
+
+#define GetModuleHandle GetModuleHandleW
+HMODULE GetModuleHandleW( LPCWSTR lpModuleName );
+void* GetProcAddress( HMODULE hModule, const char* lpProcName );
+#define LoadLibrary LoadLibraryW
+HMODULE LoadLibraryW( LPCWSTR lpLibFileName );
+#define GetSystemDirectory GetSystemDirectoryW
+UINT GetSystemDirectoryW( LPWSTR lpBuffer, UINT uSize );
+
+HANDLE OpenProcess( DWORD dwDesiredAccess, BOOL bInheritHandle, DWORD dwProcessId );
+DWORD GetProcessId( HANDLE hProcess );
+BOOL GetProcessTimes( HANDLE hProcess, LPFILETIME lpCreationTime, LPFILETIME lpExitTime,
+	LPFILETIME lpKernelTime, LPFILETIME lpUserTime );
+BOOL GetExitCodeProcess( HANDLE hProcess, LPDWORD lpExitCode );
+BOOL QueryFullProcessImageNameW( HANDLE hProcess, DWORD dwFlags, LPWSTR lpExeName,
+	PDWORD lpdwSize );
+BOOL ProcessIdToSessionId( DWORD dwProcessId, DWORD* pSessionId );
+BOOL GetNamedPipeServerProcessId( HANDLE hPipe, PULONG ServerProcessId );
+#define CreateProcessAsUser CreateProcessAsUserW
+BOOL CreateProcessAsUserW( HANDLE hToken, LPCWSTR lpApplicationName, LPWSTR lpCommandLine,
+	LPSECURITY_ATTRIBUTES lpProcessAttributes, LPSECURITY_ATTRIBUTES lpThreadAttributes,
+	BOOL bInheritHandles, DWORD dwCreationFlags, LPVOID lpEnvironment,
+	LPCWSTR lpCurrentDirectory, LPSTARTUPINFOW lpStartupInfo,
+	LPPROCESS_INFORMATION lpProcessInformation );
+BOOL UpdateProcThreadAttribute( LPPROC_THREAD_ATTRIBUTE_LIST lpAttributeList, DWORD dwFlags,
+	ULONG_PTR Attribute, PVOID lpValue, SIZE_T cbSize, PVOID lpPreviousValue,
+	SIZE_T* lpReturnSize );
+BOOL GetNumaHighestNodeNumber( PULONG HighestNodeNumber );
+
+BOOL OpenProcessToken( HANDLE hProcess, DWORD dwDesiredAccess, PHANDLE phToken );
+BOOL DuplicateTokenEx( HANDLE hExistingToken, DWORD dwDesiredAccess,
+	LPSECURITY_ATTRIBUTES lpTokenAttributes, SECURITY_IMPERSONATION_LEVEL ImpersonationLevel,
+	TOKEN_TYPE TokenType, PHANDLE phNewToken );
+BOOL AdjustTokenPrivileges( HANDLE hToken, BOOL bDisableAllPrivileges,
+	PTOKEN_PRIVILEGES NewState, DWORD BufferLength, PTOKEN_PRIVILEGES PreviousState,
+	PDWORD ReturnLength );
+BOOL GetTokenInformation( HANDLE hToken, TOKEN_INFORMATION_CLASS TokenInformationClass,
+	LPVOID TokenInformation, DWORD TokenInformationLength, PDWORD ReturnLength );
+BOOL SetTokenInformation( HANDLE hToken, TOKEN_INFORMATION_CLASS TokenInformationClass,
+	LPVOID TokenInformation, DWORD TokenInformationLength );
+BOOL SetThreadToken( PHANDLE phThread, HANDLE hToken );
+BOOL OpenThreadToken( HANDLE ThreadHandle, DWORD DesiredAccess, BOOL OpenAsSelf,
+	PHANDLE TokenHandle );
+
+SC_HANDLE OpenSCManagerW( LPCWSTR lpMachineName, LPCWSTR lpDatabaseName,
+	DWORD dwDesiredAccess );
+SC_HANDLE OpenServiceW( SC_HANDLE hSCManager, LPCWSTR lpServiceName, DWORD dwDesiredAccess );
+BOOL QueryServiceStatusEx( SC_HANDLE hService, SC_STATUS_TYPE InfoLevel, LPBYTE lpBuffer,
+	DWORD cbBufSize, LPDWORD pcbBytesNeeded );
+BOOL StartServiceW( SC_HANDLE hService, DWORD dwNumServiceArgs,
+	LPCWSTR* lpServiceArgVectors );
+DWORD NotifyServiceStatusChangeW( SC_HANDLE hService, DWORD dwNotifyMask,
+	PSERVICE_NOTIFYW pNotifyBuffer );
+BOOL CloseServiceHandle( SC_HANDLE hSCObject );
+
+LSTATUS RegOpenKeyExW( HKEY hKey, LPCWSTR lpSubKey, DWORD ulOptions, REGSAM samDesired,
+	PHKEY phkResult );
+LSTATUS RegCreateKeyExW( HKEY hKey, LPCWSTR lpSubKey, DWORD Reserved, LPWSTR lpClass,
+	DWORD dwOptions, REGSAM samDesired, const LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+	PHKEY phkResult, LPDWORD lpdwDisposition );
+LSTATUS RegQueryValueExW( HKEY hKey, LPCWSTR lpValueName, LPDWORD lpReserved,
+	LPDWORD lpType, LPBYTE lpData, LPDWORD lpcbData );
+LSTATUS RegSetValueExW( HKEY hKey, LPCWSTR lpValueName, DWORD Reserved, DWORD dwType,
+	const BYTE* lpData, DWORD cbData );
+LSTATUS RegCloseKey( HKEY hKey );
+
+ULONGLONG GetTickCount64( void );
+void Sleep( DWORD dwMilliseconds );
+DWORD SleepEx( DWORD dwMilliseconds, BOOL bAlertable );
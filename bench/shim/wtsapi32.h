@@ -0,0 +1,41 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/shim/wtsapi32.h
+
+	Minimal <wtsapi32.h> replacement for the host-native benchmarks
+
+*/
+
+#include <windows.h>
+
+typedef struct {
+	DWORD SessionId;
+	DWORD ProcessId;
+	LPWSTR pProcessName;
+	PSID pUserSid;
+} WTS_PROCESS_INFOW, *PWTS_PROCESS_INFOW;
+
+typedef enum {
+	WTSActive,
+	WTSConnected,
+	WTSConnectQuery,
+	WTSShadow,
+	WTSDisconnected,
+	WTSIdle,
+	WTSListen,
+	WTSReset,
+	WTSDown,
+	WTSInit
+} WTS_CONNECTSTATE_CLASS;
+
+typedef struct {
+	DWORD SessionId;
+	LPWSTR pWinStationName;
+	WTS_CONNECTSTATE_CLASS State;
+} WTS_SESSION_INFOW, *PWTS_SESSION_INFOW;
+
+#define WTS_CURRENT_SERVER_HANDLE ((HANDLE) NULL)
@@ -0,0 +1,86 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	bench/spawn.c
+
+	Process launch time measurement (Windows)
+
+	Launches a command line a number of times, waiting for each process to
+	exit, and reports the minimum, median and mean times from CreateProcess
+	to the process exit. With a command which exits immediately (e.g.
+	"sudo64.exe /h"), this is the cost of loading and initializing the
+	executable: compare the default and the CRT-free builds.
+
+	Usage: spawn <iterations> <command line>
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <windows.h>
+
+static int compareTimes( const void* p1, const void* p2 )
+{
+	double d1 = *(const double*) p1, d2 = *(const double*) p2;
+	return (d1 > d2) - (d1 < d2);
+}
+
+
+int wmain( int argc, wchar_t* argv[] )
+{
+	if (argc < 3) {
+		fwprintf( stderr, L"Usage: spawn <iterations> <command line>\n" );
+		return 1;
+	}
+	int nIterations = _wtoi( argv[ 1 ] );
+	if (nIterations <= 0) return 1;
+
+	// Command line after the iteration count
+	wchar_t* pwszCommandLine = wcsstr( GetCommandLine(), argv[ 1 ] ) + wcslen( argv[ 1 ] );
+	while (*pwszCommandLine == L' ' || *pwszCommandLine == L'\t') pwszCommandLine++;
+	size_t nSize = (wcslen( pwszCommandLine ) + 1) * sizeof( wchar_t );
+	wchar_t* pwszBuffer = malloc( nSize );
+
+	// Discard the output of the command
+	SECURITY_ATTRIBUTES sa = { sizeof( sa ), NULL, TRUE };
+	HANDLE hNul = CreateFile( L"NUL", GENERIC_READ | GENERIC_WRITE, 0, &sa, OPEN_EXISTING, 0,
+		NULL );
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency( &frequency );
+	double* aTimes = malloc( nIterations * sizeof( double ) );
+	double dTotal = 0;
+
+	for (int i = 0; i < nIterations; i++) {
+		STARTUPINFO startupInfo = { sizeof( startupInfo ) };
+		startupInfo.dwFlags = STARTF_USESTDHANDLES;
+		startupInfo.hStdInput = startupInfo.hStdOutput = startupInfo.hStdError = hNul;
+		PROCESS_INFORMATION processInfo;
+
+		// CreateProcess may modify the command line
+		memcpy( pwszBuffer, pwszCommandLine, nSize );
+
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter( &start );
+		if (! CreateProcess( NULL, pwszBuffer, NULL, NULL, TRUE, 0, NULL, NULL, &startupInfo,
+			&processInfo )) {
+			fwprintf( stderr, L"Cannot create the process (code: 0x%08lX)\n", GetLastError() );
+			return 1;
+		}
+		WaitForSingleObject( processInfo.hProcess, INFINITE );
+		QueryPerformanceCounter( &end );
+		CloseHandle( processInfo.hThread );
+		CloseHandle( processInfo.hProcess );
+
+		aTimes[ i ] = (double) (end.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart;
+		dTotal += aTimes[ i ];
+	}
+
+	qsort( aTimes, nIterations, sizeof( double ), compareTimes );
+	wprintf( L"%d launches: min %.1f us, median %.1f us, mean %.1f us\n", nIterations,
+		aTimes[ 0 ], aTimes[ nIterations / 2 ], dTotal / nIterations );
+	return 0;
+}
@@ -0,0 +1,437 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	broker.c
+
+	Launch broker
+
+	The setup (TrustedInstaller service start, token duplication) is done once.
+	Each client request then only costs a token duplication and the process
+	creation.
+
+	Protocol (message mode pipe, one request per connection):
+		client -> broker: BrokerRequest + command line
+		broker -> client: BrokerResponse
+
+	Only the administrators and the system can connect to the pipe. Its owner
+	is the system, which a user without privileges cannot set: the client
+	checks it, as such a user can create a pipe with the same name while the
+	broker is not running.
+
+*/
+
+#include "broker.h"
+
+#include <wchar.h>
+#include <windows.h>
+#include <aclapi.h>
+#include <sddl.h>
+
+#include "output.h" // Display functions
+#include "tokens.h" // Tokens and privileges management functions
+#include "utils.h"  // Utility functions
+
+#define CUSTOM_ERROR_INVALID_REQUEST 0xA0002000
+#define CUSTOM_ERROR_INVALID_RESPONSE 0xA0002001
+#define CUSTOM_ERROR_UNTRUSTED_BROKER 0xA0002002
+
+// Pipe security: owned by the system (the broker runs in the system
+// context), full access for the system and the administrators only
+#define BROKER_PIPE_SDDL L"O:SYD:P(A;;GA;;;SY)(A;;GA;;;BA)"
+
+#define BROKER_MAX_REQUEST_SIZE \
+	(sizeof( BrokerRequest ) + BROKER_MAX_COMMAND_LINE * sizeof( wchar_t ))
+
+// Resources acquired once and shared by all the requests
+static struct {
+	HANDLE hTIProcess;    // TrustedInstaller process
+	HANDLE hToken;        // Child process token (TrustedInstaller)
+	HANDLE hSystemToken;  // System impersonation token (system context)
+} broker = {0};
+
+static wchar_t wszDesktop[] = L"winsta0\\default";
+
+
+//
+// Create a child process for a client request.
+//
+static int launchRequest( HANDLE hPipe, const BrokerRequest* pRequest,
+	wchar_t* pwszCommandLine, BrokerResponse* pResponse )
+{
+	int errCode = 0;
+
+	// The child process runs in the client's session
+	ULONG ulClientPid = 0;
+	DWORD dwSessionId = (DWORD) -1;
+	if (! GetNamedPipeClientProcessId( hPipe, &ulClientPid ) ||
+		! ProcessIdToSessionId( ulClientPid, &dwSessionId ))
+		dwSessionId = WTSGetActiveConsoleSessionId();
+
+	showFmtVerbose( L"Request from process %lu (session %lu): '%ls'",
+		ulClientPid, dwSessionId, pwszCommandLine );
+
+	HANDLE hChildProcessToken = NULL;
+	errCode = duplicateChildProcessToken( broker.hToken, dwSessionId,
+		pRequest->privileges, NULL, &hChildProcessToken );
+	if (errCode) {
+		pResponse->dwError = GetLastError();
+		return errCode;
+	}
+
+	// Initialize startupInfo
+
+	STARTUPINFOEX startupInfo = {0};
+
+	startupInfo.StartupInfo.cb = sizeof( STARTUPINFOEX );
+	startupInfo.StartupInfo.lpDesktop = wszDesktop;
+	startupInfo.StartupInfo.dwFlags = STARTF_USESHOWWINDOW;
+	if (pRequest->dwFlags & BROKER_FLAG_MINIMIZE)
+		startupInfo.StartupInfo.wShowWindow = SW_SHOWMINNOACTIVE;
+	else
+		startupInfo.StartupInfo.wShowWindow = SW_SHOWNORMAL;
+
+	DWORD dwCreationFlags = CREATE_NEW_CONSOLE;
+	HANDLE ahStdHandles[ 3 ] = {0};
+	DWORD nStdHandles = 0;
+
+	if (pRequest->dwFlags & BROKER_FLAG_STD_HANDLES) {
+		// Duplicate the client's standard handles, to be inherited by the child
+		// process. Only these handles are inherited (handle list attribute).
+		HANDLE hClientProcess = OpenProcess( PROCESS_DUP_HANDLE, FALSE, ulClientPid );
+		if (hClientProcess) {
+			for (int i = 0; i < 3; i++) {
+				if (pRequest->adwStdHandles[ i ] && DuplicateHandle( hClientProcess,
+					ULongToHandle( pRequest->adwStdHandles[ i ] ), GetCurrentProcess(),
+					&ahStdHandles[ i ], 0, TRUE, DUPLICATE_SAME_ACCESS ))
+					nStdHandles++;
+				else ahStdHandles[ i ] = NULL;
+			}
+			CloseHandle( hClientProcess );
+		}
+
+		if (nStdHandles) {
+			// Pack the valid handles for the handle list
+			HANDLE ahInherited[ 3 ];
+			nStdHandles = 0;
+			for (int i = 0; i < 3; i++)
+				if (ahStdHandles[ i ]) ahInherited[ nStdHandles++ ] = ahStdHandles[ i ];
+
+			SIZE_T attributeListLength = 0;
+			InitializeProcThreadAttributeList( NULL, 1, 0, (PSIZE_T) &attributeListLength );
+			startupInfo.lpAttributeList = allocHeap( HEAP_ZERO_MEMORY, attributeListLength );
+			InitializeProcThreadAttributeList( startupInfo.lpAttributeList, 1, 0,
+				(PSIZE_T) &attributeListLength );
+			UpdateProcThreadAttribute( startupInfo.lpAttributeList, 0,
+				PROC_THREAD_ATTRIBUTE_HANDLE_LIST, ahInherited,
+				nStdHandles * sizeof( HANDLE ), NULL, NULL );
+
+			startupInfo.StartupInfo.dwFlags |= STARTF_USESTDHANDLES;
+			startupInfo.StartupInfo.hStdInput = ahStdHandles[ 0 ];
+			startupInfo.StartupInfo.hStdOutput = ahStdHandles[ 1 ];
+			startupInfo.StartupInfo.hStdError = ahStdHandles[ 2 ];
+
+			// The child process writes to the client's console: no console window
+			dwCreationFlags = EXTENDED_STARTUPINFO_PRESENT | CREATE_NO_WINDOW;
+		}
+	}
+
+	// Create process
+
+	PROCESS_INFORMATION processInfo = {0};
+
+	BOOL bCreateResult = CreateProcessAsUser(
+		hChildProcessToken,
+		NULL,
+		pwszCommandLine,
+		NULL,
+		NULL,
+		nStdHandles != 0,
+		dwCreationFlags,
+		NULL,
+		NULL,
+		(LPSTARTUPINFO) &startupInfo,
+		&processInfo
+	);
+
+	DWORD dwCreateError = bCreateResult ? 0 : GetLastError();
+
+	CloseHandle( hChildProcessToken );
+	if (startupInfo.lpAttributeList) {
+		DeleteProcThreadAttributeList( startupInfo.lpAttributeList );
+		freeHeap( startupInfo.lpAttributeList );
+	}
+	for (int i = 0; i < 3; i++)
+		if (ahStdHandles[ i ]) CloseHandle( ahStdHandles[ i ] );
+
+	if (bCreateResult) {
+		showFmtVerbose( L"Created process ID: %lu", processInfo.dwProcessId );
+		pResponse->dwProcessId = processInfo.dwProcessId;
+
+		if (pRequest->dwFlags & BROKER_FLAG_WAIT) {
+			WaitForSingleObject( processInfo.hProcess, INFINITE );
+
+			// Get exit code of child process
+			if (GetExitCodeProcess( processInfo.hProcess, &pResponse->dwExitCode ))
+				showFmtVerbose( L"Process %lu exited with code %ld",
+					processInfo.dwProcessId, pResponse->dwExitCode );
+			else {
+				pResponse->dwError = GetLastError();
+				errCode = 6;
+			}
+		}
+
+		CloseHandle( processInfo.hProcess );
+		CloseHandle( processInfo.hThread );
+	}
+	else {
+		showError( L"Process creation failed", dwCreateError, 0 );
+		pResponse->dwError = dwCreateError;
+		errCode = 4;
+	}
+
+	return errCode;
+}
+
+
+//
+// Serve a client connected to the pipe (thread procedure).
+//
+static DWORD WINAPI serveClient( LPVOID lpParameter )
+{
+	HANDLE hPipe = (HANDLE) lpParameter;
+	BrokerResponse response = {0};
+
+	// The memory of the request is released at once, when it has been served
+	Arena arena;
+	openArena( &arena, LAUNCH_ARENA_SIZE );
+
+	// The process creation requires the system context (per thread)
+	SetThreadToken( NULL, broker.hSystemToken );
+
+	// Read the request
+	BYTE* pBuffer = allocHeap( 0, BROKER_MAX_REQUEST_SIZE + sizeof( wchar_t ) );
+	BrokerRequest* pRequest = (BrokerRequest*) pBuffer;
+	DWORD dwRead = 0;
+	if (ReadFile( hPipe, pBuffer, BROKER_MAX_REQUEST_SIZE, &dwRead, NULL ) &&
+		dwRead >= sizeof( BrokerRequest ) &&
+		pRequest->dwMagic == BROKER_MAGIC &&
+		pRequest->dwVersion == BROKER_VERSION &&
+		pRequest->cchCommandLine > 0 &&
+		pRequest->cchCommandLine <= BROKER_MAX_COMMAND_LINE &&
+		dwRead == sizeof( BrokerRequest ) + pRequest->cchCommandLine * sizeof( wchar_t )) {
+		// The command line follows the request. It must be writable and
+		// null-terminated.
+		wchar_t* pwszCommandLine = (wchar_t*) (pBuffer + sizeof( BrokerRequest ));
+		pwszCommandLine[ pRequest->cchCommandLine ] = L'\0';
+
+		response.dwStatus = launchRequest( hPipe, pRequest, pwszCommandLine, &response );
+	}
+	else {
+		response.dwStatus = 1;
+		response.dwError = CUSTOM_ERROR_INVALID_REQUEST;
+	}
+
+	freeHeap( pBuffer );
+
+	// Send the response
+	DWORD dwWritten;
+	WriteFile( hPipe, &response, sizeof( response ), &dwWritten, NULL );
+	FlushFileBuffers( hPipe );
+	DisconnectNamedPipe( hPipe );
+	CloseHandle( hPipe );
+
+	closeArena( &arena );
+	DWORD dwHandles = 0;
+	GetProcessHandleCount( GetCurrentProcess(), &dwHandles );
+	showFmtVerbose( L"Request served: %ld blocks (%llu bytes) in %ld arena chunks "
+		L"released, %lu handles open", arena.nBlocks, (ULONGLONG) arena.nUsedBytes,
+		arena.nChunks, dwHandles );
+
+	return 0;
+}
+
+
+int runBroker( void )
+{
+	int errCode = 0;
+	DWORD dwLastError = 0;
+	int iStep = 1;
+
+	// Keep the system impersonation token for the threads serving the clients
+	if (! OpenThreadToken( GetCurrentThread(), TOKEN_IMPERSONATE, TRUE,
+		&broker.hSystemToken )) {
+		showError( L"Failed to create system context", GetLastError(), 0 );
+		return 5;
+	}
+
+	// Start the TrustedInstaller service and get its process handle
+	errCode = getTrustedInstallerProcess( &broker.hTIProcess );
+	if (errCode) return errCode;
+
+	// Create the child process token, duplicated for each request
+	errCode = createChildProcessToken( broker.hTIProcess, &broker.hToken );
+	if (errCode) return errCode;
+
+	// Create the pipe security attributes
+	SECURITY_ATTRIBUTES sa = {
+		.nLength = sizeof( SECURITY_ATTRIBUTES ),
+		.lpSecurityDescriptor = NULL,
+		.bInheritHandle = FALSE
+	};
+	if (! ConvertStringSecurityDescriptorToSecurityDescriptorW( BROKER_PIPE_SDDL,
+		SDDL_REVISION_1, &sa.lpSecurityDescriptor, NULL )) {
+		showError( L"Failed to start the broker", GetLastError(), iStep );
+		return 5;
+	}
+	iStep++;
+
+	showFmtVerbose( L"Broker listening on %ls", BROKER_PIPE_NAME );
+
+	DWORD dwOpenMode = PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE;
+	for (;;) {
+		HANDLE hPipe = CreateNamedPipe( BROKER_PIPE_NAME, dwOpenMode,
+			PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT |
+			PIPE_REJECT_REMOTE_CLIENTS, PIPE_UNLIMITED_INSTANCES,
+			sizeof( BrokerResponse ), BROKER_MAX_REQUEST_SIZE, 0, &sa );
+		if (hPipe == INVALID_HANDLE_VALUE) {
+			// The first instance fails if another broker is running
+			dwLastError = GetLastError();
+			break;
+		}
+		dwOpenMode = PIPE_ACCESS_DUPLEX;
+
+		// Wait for a client
+		if (ConnectNamedPipe( hPipe, NULL ) || GetLastError() == ERROR_PIPE_CONNECTED) {
+			HANDLE hThread = CreateThread( NULL, 0, serveClient, hPipe, 0, NULL );
+			if (hThread) CloseHandle( hThread );
+			else CloseHandle( hPipe );
+		}
+		else CloseHandle( hPipe );
+	}
+
+	LocalFree( sa.lpSecurityDescriptor );
+
+	showError( L"Failed to start the broker", dwLastError, iStep );
+	return 5;
+}
+
+
+//
+// Check that a pipe was created by the broker: its owner is the system.
+// Returns FALSE otherwise (the last error is set).
+//
+static BOOL isBrokerPipe( HANDLE hPipe )
+{
+	PSID pOwner = NULL;
+	PSECURITY_DESCRIPTOR pSecurityDescriptor = NULL;
+	DWORD dwError = GetSecurityInfo( hPipe, SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION,
+		&pOwner, NULL, NULL, NULL, &pSecurityDescriptor );
+	if (dwError != ERROR_SUCCESS) {
+		SetLastError( dwError );
+		return FALSE;
+	}
+
+	BOOL bSystem = pOwner && IsWellKnownSid( pOwner, WinLocalSystemSid );
+	LocalFree( pSecurityDescriptor );
+	if (! bSystem) SetLastError( CUSTOM_ERROR_UNTRUSTED_BROKER );
+	return bSystem;
+}
+
+
+int callBroker( wchar_t* pwszCommandLine, DWORD dwFlags, PrivilegeMask privileges,
+	DWORD* pdwExitCode )
+{
+	DWORD dwLastError = 0;
+	int iStep = 1;
+
+	size_t cchCommandLine = wcslen( pwszCommandLine );
+	if (cchCommandLine > BROKER_MAX_COMMAND_LINE) {
+		showError( L"Command line too long", 0, 0 );
+		return 1;
+	}
+
+	// Connect to the broker. The broker is not allowed to impersonate the client.
+	HANDLE hPipe;
+	for (;;) {
+		hPipe = CreateFile( BROKER_PIPE_NAME, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+			OPEN_EXISTING, SECURITY_SQOS_PRESENT | SECURITY_IDENTIFICATION, NULL );
+		if (hPipe != INVALID_HANDLE_VALUE) break;
+
+		dwLastError = GetLastError();
+		if (dwLastError != ERROR_PIPE_BUSY || ! WaitNamedPipe( BROKER_PIPE_NAME, 5000 )) {
+			showError( L"Failed to connect to the broker", dwLastError, iStep );
+			return 7;
+		}
+	}
+	iStep++;
+
+	// The request must not reach a pipe created by another user
+	if (! isBrokerPipe( hPipe )) {
+		dwLastError = GetLastError();
+		CloseHandle( hPipe );
+		showError( L"The broker pipe is not owned by the system", dwLastError, iStep );
+		return 7;
+	}
+	iStep++;
+
+	DWORD dwMode = PIPE_READMODE_MESSAGE;
+	SetNamedPipeHandleState( hPipe, &dwMode, NULL, NULL );
+
+	// Build the request
+	DWORD dwRequestSize = (DWORD) (sizeof( BrokerRequest ) +
+		cchCommandLine * sizeof( wchar_t ));
+	BYTE* pBuffer = allocHeap( HEAP_ZERO_MEMORY, dwRequestSize );
+	BrokerRequest* pRequest = (BrokerRequest*) pBuffer;
+	pRequest->dwMagic = BROKER_MAGIC;
+	pRequest->dwVersion = BROKER_VERSION;
+	pRequest->dwFlags = dwFlags;
+	pRequest->cchCommandLine = (DWORD) cchCommandLine;
+	pRequest->privileges = privileges;
+	if (dwFlags & BROKER_FLAG_STD_HANDLES) {
+		pRequest->adwStdHandles[ 0 ] = HandleToULong( GetStdHandle( STD_INPUT_HANDLE ) );
+		pRequest->adwStdHandles[ 1 ] = HandleToULong( GetStdHandle( STD_OUTPUT_HANDLE ) );
+		pRequest->adwStdHandles[ 2 ] = HandleToULong( GetStdHandle( STD_ERROR_HANDLE ) );
+	}
+	memcpy( pBuffer + sizeof( BrokerRequest ), pwszCommandLine,
+		cchCommandLine * sizeof( wchar_t ) );
+
+	// Send the request and wait for the response
+	BrokerResponse response = {0};
+	DWORD dwWritten = 0, dwRead = 0;
+	BOOL bSuccess = WriteFile( hPipe, pBuffer, dwRequestSize, &dwWritten, NULL );
+	if (bSuccess) {
+		iStep++;
+		bSuccess = ReadFile( hPipe, &response, sizeof( response ), &dwRead, NULL );
+		if (bSuccess && dwRead != sizeof( response )) {
+			bSuccess = FALSE;
+			SetLastError( CUSTOM_ERROR_INVALID_RESPONSE );
+		}
+	}
+	if (! bSuccess) dwLastError = GetLastError();
+
+	freeHeap( pBuffer );
+	CloseHandle( hPipe );
+
+	if (! bSuccess) {
+		showError( L"Failed to communicate with the broker", dwLastError, iStep );
+		return 7;
+	}
+
+	if (response.dwStatus) {
+		if (response.dwStatus == 4)
+			showError( L"Process creation failed", response.dwError, 0 );
+		else
+			showError( L"The broker failed to process the request", response.dwError, 0 );
+		return (int) response.dwStatus;
+	}
+
+	showFmtVerbose( L"Created process ID: %lu", response.dwProcessId );
+	if (dwFlags & BROKER_FLAG_WAIT) {
+		showFmtVerbose( L"Process exited with code %ld", response.dwExitCode );
+		*pdwExitCode = response.dwExitCode;
+	}
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	broker.h
+
+	Launch broker
+
+	The broker acquires the TrustedInstaller token once, then creates child
+	processes on behalf of clients connecting to a local named pipe.
+
+*/
+
+#include <windows.h>
+
+#include "privileges.h" // Privilege table and privilege sets
+
+#define BROKER_PIPE_NAME L"\\\\.\\pipe\\superUser.broker"
+
+#define BROKER_MAGIC 0x52425553  // "SUBR"
+#define BROKER_VERSION 1
+
+// Request flags
+#define BROKER_FLAG_WAIT 0x1         // Wait for the child process to finish
+#define BROKER_FLAG_MINIMIZE 0x2     // Minimize the created window
+#define BROKER_FLAG_STD_HANDLES 0x4  // The child process uses the client's standard handles
+
+// Maximum command line length (wide chars)
+#define BROKER_MAX_COMMAND_LINE 32767
+
+//
+// Request sent by a client, followed by the command line (wide chars, not
+// null-terminated).
+//
+// The layout is the same for 32-bit and 64-bit processes.
+//
+typedef struct {
+	DWORD dwMagic;                // BROKER_MAGIC
+	DWORD dwVersion;              // BROKER_VERSION
+	DWORD dwFlags;                // BROKER_FLAG_xxx
+	DWORD cchCommandLine;         // Command line length (wide chars)
+	PrivilegeMask privileges;     // Privileges to enable in the child process token
+	DWORD adwStdHandles[ 3 ];     // Client's standard handles (input, output, error)
+	DWORD dwReserved;
+} BrokerRequest;
+
+//
+// Response sent by the broker.
+//
+typedef struct {
+	DWORD dwStatus;      // superUser error code (0: success)
+	DWORD dwError;       // Win32 error code if the request failed
+	DWORD dwProcessId;   // Child process id
+	DWORD dwExitCode;    // Child process exit code (with BROKER_FLAG_WAIT)
+} BrokerResponse;
+
+// Run the broker.
+// The TrustedInstaller process must be accessible (SeDebugPrivilege) and
+// the system context must be created. Returns only if an error occurs.
+int runBroker( void );
+
+// Create a child process through the broker.
+int callBroker( wchar_t* pwszCommandLine, DWORD dwFlags, PrivilegeMask privileges,
+	DWORD* pdwExitCode );
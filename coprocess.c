@@ -0,0 +1,340 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	coprocess.c
+
+	Coprocess mode: run the commands read from the standard input
+
+	The setup (TrustedInstaller service start, child process token) is done
+	once. Each command then only costs its process creation, so that a script
+	can keep one superUser process open instead of starting one per command.
+
+	Protocol:
+		input: one command line per line (UTF-8, or the console code page).
+		       Empty lines are ignored.
+		output: one JSON line per command, written when it has exited:
+		        {"id":1,"pid":4242,"status":0,"exitCode":0,"error":0,"elapsedMs":12.345}
+		        id: number of the command (from 1), in input order.
+		        status: superUser error code (0: the command ran, 1: invalid line,
+		        4: process creation failed, 6: exit code unavailable).
+		        error: Win32 error code if the status is not 0.
+
+	The standard input of the commands is the NUL device, and their output and
+	errors go to the standard error of superUser, so that the standard output
+	only carries the result lines.
+
+*/
+
+#include "coprocess.h"
+
+#include <string.h>
+#include <wchar.h>
+#include <windows.h>
+
+#include "output.h" // Display functions
+#include "timing.h" // Launch phase timing
+#include "utils.h"  // Utility functions
+
+// Size of the input buffer: the longest command line, in UTF-8, and a line break
+#define COPROCESS_BUFFER_SIZE (COPROCESS_MAX_COMMAND_LINE * 3 + 2)
+
+// Buffered reader of the standard input
+typedef struct {
+	HANDLE hInput;
+	UINT uCodePage;  // Encoding of the input
+	char* pBuffer;   // COPROCESS_BUFFER_SIZE bytes
+	DWORD iStart;    // Beginning of the data not returned yet
+	DWORD iEnd;      // End of the data read
+	BOOL bEnd;       // The end of the input is reached
+} LineReader;
+
+// Result of a command
+typedef struct {
+	DWORD dwId;
+	DWORD dwProcessId;
+	int status;        // superUser error code
+	DWORD dwExitCode;
+	DWORD dwError;     // Win32 error code
+	double dElapsedMs;
+} CommandResult;
+
+
+//
+// Read the next line of the input (without its line break). Returns FALSE at
+// the end of the input. If the line does not fit in the buffer, its beginning
+// is discarded and *pbTooLong is set.
+//
+static BOOL readLine( LineReader* pReader, char** ppLine, DWORD* pnLength, BOOL* pbTooLong )
+{
+	*pbTooLong = FALSE;
+	DWORD iScan = pReader->iStart;
+
+	for (;;) {
+		while (iScan < pReader->iEnd && pReader->pBuffer[ iScan ] != '\n') iScan++;
+		if (iScan < pReader->iEnd ||
+			(pReader->bEnd && (iScan > pReader->iStart || *pbTooLong))) {
+			*ppLine = pReader->pBuffer + pReader->iStart;
+			*pnLength = iScan - pReader->iStart;
+			pReader->iStart = iScan < pReader->iEnd ? iScan + 1 : iScan;
+			return TRUE;
+		}
+		if (pReader->bEnd) return FALSE;
+
+		if (pReader->iStart) {
+			// Move the beginning of the line to the beginning of the buffer
+			DWORD nPending = pReader->iEnd - pReader->iStart;
+			memmove( pReader->pBuffer, pReader->pBuffer + pReader->iStart, nPending );
+			pReader->iStart = 0;
+			pReader->iEnd = iScan = nPending;
+		}
+		else if (pReader->iEnd == COPROCESS_BUFFER_SIZE) {
+			// The buffer is full: discard the data up to the line break
+			*pbTooLong = TRUE;
+			pReader->iEnd = iScan = 0;
+		}
+
+		// ERROR_BROKEN_PIPE: the writer closed the pipe. An empty read from a
+		// console (Ctrl+Z) also ends the input.
+		DWORD dwRead = 0;
+		if (! ReadFile( pReader->hInput, pReader->pBuffer + pReader->iEnd,
+			COPROCESS_BUFFER_SIZE - pReader->iEnd, &dwRead, NULL ) || ! dwRead)
+			pReader->bEnd = TRUE;
+		pReader->iEnd += dwRead;
+	}
+}
+
+
+//
+// Convert a line of the input to a command line. Returns NULL if the line is
+// empty or if it cannot be converted (*pdwError is then set).
+//
+static wchar_t* getCommandLine( const LineReader* pReader, const char* pLine, DWORD nLength,
+	DWORD* pdwError )
+{
+	*pdwError = 0;
+
+	// Trim the spaces, the carriage return and a UTF-8 byte order mark
+	if (nLength >= 3 && ! memcmp( pLine, "\xEF\xBB\xBF", 3 )) {
+		pLine += 3;
+		nLength -= 3;
+	}
+	while (nLength && (*pLine == ' ' || *pLine == '\t')) {
+		pLine++;
+		nLength--;
+	}
+	while (nLength && (pLine[ nLength - 1 ] == '\r' || pLine[ nLength - 1 ] == ' ' ||
+		pLine[ nLength - 1 ] == '\t'))
+		nLength--;
+	if (! nLength) return NULL;
+
+	int cchCommandLine = MultiByteToWideChar( pReader->uCodePage, 0, pLine, (int) nLength,
+		NULL, 0 );
+	if (cchCommandLine <= 0) {
+		*pdwError = GetLastError();
+		return NULL;
+	}
+	if (cchCommandLine > COPROCESS_MAX_COMMAND_LINE) {
+		*pdwError = ERROR_FILENAME_EXCED_RANGE;
+		return NULL;
+	}
+
+	// CreateProcess may modify the command line: it is a new string
+	wchar_t* pwszCommandLine = allocHeap( 0, (cchCommandLine + 1) * sizeof( wchar_t ) );
+	MultiByteToWideChar( pReader->uCodePage, 0, pLine, (int) nLength, pwszCommandLine,
+		cchCommandLine );
+	pwszCommandLine[ cchCommandLine ] = L'\0';
+	return pwszCommandLine;
+}
+
+
+//
+// Run a command and wait for it to exit.
+//
+static void runCommand( HANDLE hToken, STARTUPINFOEX* pStartupInfo, wchar_t* pwszCommandLine,
+	CommandResult* pResult )
+{
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency( &frequency );
+	QueryPerformanceCounter( &start );
+
+	showFmtVerbose( L"[%lu] Starting '%ls'", pResult->dwId, pwszCommandLine );
+
+	PROCESS_INFORMATION processInfo = {0};
+	int iEvent = beginPhase( PHASE_CREATE_PROCESS );
+	if (! CreateProcessAsUser( hToken, NULL, pwszCommandLine, NULL, NULL, TRUE,
+		EXTENDED_STARTUPINFO_PRESENT | CREATE_NO_WINDOW, NULL, NULL,
+		(LPSTARTUPINFO) pStartupInfo, &processInfo )) {
+		pResult->dwError = GetLastError();
+		pResult->status = 4;
+		endPhaseStep( iEvent, pResult->dwError, 0 );
+		showFmtVerbose( L"[%lu] Process creation failed (code: 0x%08lX)", pResult->dwId,
+			pResult->dwError );
+	}
+	else {
+		endPhase( iEvent );
+		CloseHandle( processInfo.hThread );
+		pResult->dwProcessId = processInfo.dwProcessId;
+
+		// Show each command on its own track
+		int iRunEvent = beginPhase( PHASE_CHILD_RUN );
+		wchar_t* pwszTrack = printFmtString( L"command %lu", pResult->dwId );
+		if (pwszTrack) {
+			setEventTrack( iEvent, processInfo.dwProcessId, pwszTrack );
+			setEventTrack( iRunEvent, processInfo.dwProcessId, pwszTrack );
+			freeHeap( pwszTrack );
+		}
+
+		WaitForSingleObject( processInfo.hProcess, INFINITE );
+		if (! GetExitCodeProcess( processInfo.hProcess, &pResult->dwExitCode )) {
+			pResult->dwError = GetLastError();
+			pResult->status = 6;
+		}
+		endPhaseStep( iRunEvent, pResult->dwExitCode, 0 );
+		CloseHandle( processInfo.hProcess );
+	}
+
+	QueryPerformanceCounter( &end );
+	pResult->dElapsedMs = (double) (end.QuadPart - start.QuadPart) * 1e3 / frequency.QuadPart;
+}
+
+
+//
+// Write the result line of a command to the standard output, in one write,
+// so that a reader of a pipe gets whole lines.
+//
+static BOOL writeResult( HANDLE hOutput, const CommandResult* pResult )
+{
+	wchar_t* pwszLine = printFmtString( L"{\"id\":%lu,\"pid\":%lu,\"status\":%d,"
+		L"\"exitCode\":%ld,\"error\":%lu,\"elapsedMs\":%.3f}\n", pResult->dwId,
+		pResult->dwProcessId, pResult->status, pResult->dwExitCode, pResult->dwError,
+		pResult->dElapsedMs );
+	if (! pwszLine) return FALSE;
+
+	// The line is ASCII
+	char szLine[ 160 ];
+	int nLength = WideCharToMultiByte( CP_UTF8, 0, pwszLine, -1, szLine, sizeof( szLine ),
+		NULL, NULL ) - 1;
+	freeHeap( pwszLine );
+
+	DWORD dwWritten = 0;
+	return nLength > 0 && WriteFile( hOutput, szLine, nLength, &dwWritten, NULL ) &&
+		dwWritten == (DWORD) nLength;
+}
+
+
+int runCoprocess( PrivilegeMask privileges, MissingPrivilegeFunc fnMPCb )
+{
+	int errCode = 0;
+
+	HANDLE hOutput = GetStdHandle( STD_OUTPUT_HANDLE );
+	LineReader reader = { GetStdHandle( STD_INPUT_HANDLE ) };
+	if (! reader.hInput || reader.hInput == INVALID_HANDLE_VALUE ||
+		! hOutput || hOutput == INVALID_HANDLE_VALUE) {
+		showError( L"The coprocess mode requires a standard input and output", 0, 0 );
+		return 1;
+	}
+	DWORD dwMode;
+	reader.uCodePage = GetConsoleMode( reader.hInput, &dwMode ) ? GetConsoleCP() : CP_UTF8;
+
+	// The commands run in the session of superUser
+	DWORD dwSessionId;
+	if (! ProcessIdToSessionId( GetCurrentProcessId(), &dwSessionId ))
+		dwSessionId = WTSGetActiveConsoleSessionId();
+
+	// Create the child process token once
+	HANDLE hBaseProcess = NULL, hBaseToken = NULL, hToken = NULL;
+	errCode = getTrustedInstallerProcess( &hBaseProcess );
+	if (! errCode) {
+		errCode = createChildProcessToken( hBaseProcess, &hBaseToken );
+		CloseHandle( hBaseProcess );
+	}
+	if (! errCode) {
+		errCode = duplicateChildProcessToken( hBaseToken, dwSessionId, privileges, fnMPCb,
+			&hToken );
+		CloseHandle( hBaseToken );
+	}
+	if (errCode) return errCode;
+
+	// Standard handles of the commands: only these handles are inherited
+	SECURITY_ATTRIBUTES sa = { sizeof( SECURITY_ATTRIBUTES ), NULL, TRUE };
+	HANDLE ahInherited[ 2 ] = {0};
+	DWORD nInherited = 0;
+	HANDLE hNul = CreateFile( L"NUL", GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, NULL );
+	if (hNul == INVALID_HANDLE_VALUE) {
+		showError( L"Failed to open the NUL device", GetLastError(), 0 );
+		CloseHandle( hToken );
+		return 5;
+	}
+	ahInherited[ nInherited++ ] = hNul;
+
+	HANDLE hError = NULL;
+	HANDLE hStdError = GetStdHandle( STD_ERROR_HANDLE );
+	if (hStdError && hStdError != INVALID_HANDLE_VALUE &&
+		DuplicateHandle( GetCurrentProcess(), hStdError, GetCurrentProcess(), &hError, 0, TRUE,
+		DUPLICATE_SAME_ACCESS ))
+		ahInherited[ nInherited++ ] = hError;
+	else hError = NULL;
+
+	STARTUPINFOEX startupInfo = {0};
+	startupInfo.StartupInfo.cb = sizeof( STARTUPINFOEX );
+	startupInfo.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+	startupInfo.StartupInfo.hStdInput = hNul;
+	startupInfo.StartupInfo.hStdOutput = startupInfo.StartupInfo.hStdError =
+		hError ? hError : hNul;
+
+	SIZE_T attributeListLength = 0;
+	InitializeProcThreadAttributeList( NULL, 1, 0, (PSIZE_T) &attributeListLength );
+	startupInfo.lpAttributeList = allocHeap( HEAP_ZERO_MEMORY, attributeListLength );
+	InitializeProcThreadAttributeList( startupInfo.lpAttributeList, 1, 0,
+		(PSIZE_T) &attributeListLength );
+	UpdateProcThreadAttribute( startupInfo.lpAttributeList, 0,
+		PROC_THREAD_ATTRIBUTE_HANDLE_LIST, ahInherited, nInherited * sizeof( HANDLE ), NULL,
+		NULL );
+
+	reader.pBuffer = allocHeap( 0, COPROCESS_BUFFER_SIZE );
+	showFmtVerbose( L"Reading the commands from the standard input" );
+
+	DWORD dwId = 0;
+	char* pLine;
+	DWORD nLength;
+	BOOL bTooLong;
+	while (readLine( &reader, &pLine, &nLength, &bTooLong )) {
+		// The memory of a command is released at once, when it has exited
+		Arena arena;
+		openArena( &arena, LAUNCH_ARENA_SIZE );
+
+		CommandResult result = {0};
+		wchar_t* pwszCommandLine = NULL;
+		if (bTooLong) result.dwError = ERROR_FILENAME_EXCED_RANGE;
+		else pwszCommandLine = getCommandLine( &reader, pLine, nLength, &result.dwError );
+
+		BOOL bWritten = TRUE;
+		if (pwszCommandLine || result.dwError) {
+			result.dwId = ++dwId;
+			if (pwszCommandLine) runCommand( hToken, &startupInfo, pwszCommandLine, &result );
+			else result.status = 1;
+			bWritten = writeResult( hOutput, &result );
+		}
+		if (pwszCommandLine) freeHeap( pwszCommandLine );
+
+		closeArena( &arena );
+		if (! bWritten) {
+			showError( L"Failed to write the result", GetLastError(), 0 );
+			errCode = 5;
+			break;
+		}
+	}
+
+	showFmtVerbose( L"End of the input: %lu commands", dwId );
+
+	freeHeap( reader.pBuffer );
+	DeleteProcThreadAttributeList( startupInfo.lpAttributeList );
+	freeHeap( startupInfo.lpAttributeList );
+	if (hError) CloseHandle( hError );
+	CloseHandle( hNul );
+	CloseHandle( hToken );
+	return errCode;
+}
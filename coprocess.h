@@ -0,0 +1,25 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	coprocess.h
+
+	Coprocess mode: run the commands read from the standard input
+
+*/
+
+#include <windows.h>
+
+#include "tokens.h" // Tokens and privileges management functions
+
+// Maximum length of a command line read from the standard input (wide chars)
+#define COPROCESS_MAX_COMMAND_LINE 32767
+
+// Read commands from the standard input, one per line, and run each of them
+// when the previous one has exited. A result line is written to the standard
+// output for each command.
+// SeDebugPrivilege must be acquired and the system context must be created.
+// Returns 0 at the end of the input, or an error code.
+int runCoprocess( PrivilegeMask privileges, MissingPrivilegeFunc fnMPCb );
@@ -0,0 +1,277 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	job.c
+
+	Job object management
+
+	A watched process tree is terminated from a thread pool wait, registered
+	on an event that the console control handler sets, with the maximum run
+	time as timeout: the thread waiting for the process (or relaying its
+	output) simply sees it exit.
+
+	To wait for a whole process tree, the job posts its notifications to a
+	completion port, associated before the process runs: the last process of
+	the job to exit, whichever it is, posts JOB_OBJECT_MSG_ACTIVE_PROCESS_ZERO.
+
+*/
+
+#include "job.h"
+
+#include <windows.h>
+
+#include "output.h" // Display functions
+#include "utils.h"  // Utility functions
+
+// Time given to the termination of the process tree when the console is
+// closed, before this process is ended by the system (milliseconds)
+#define JOB_WATCH_CLOSE_DELAY 3000
+
+// State of the active watch, and its events (created once, never closed: the
+// console control handler may still run on another thread when the watch stops)
+static volatile BOOL bWatchActive = FALSE;
+static BOOL bWatchSharedConsole = FALSE;
+static HANDLE hCancelEvent = NULL;      // Set on a console control event
+static HANDLE hTerminatedEvent = NULL;  // Set once the tree has been terminated
+
+//
+// Create a job object and assign a (suspended) process to it.
+//
+HANDLE createProcessJob( HANDLE hProcess, HANDLE* phPort )
+{
+	HANDLE hJob = CreateJobObject( NULL, NULL );
+	if (! hJob) return NULL;
+
+	// Let the processes that ask for it leave the job,
+	// as they would do without superUser.
+	JOBOBJECT_EXTENDED_LIMIT_INFORMATION limitInfo = {0};
+	limitInfo.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_BREAKAWAY_OK;
+
+	HANDLE hPort = NULL;
+	BOOL bSuccess = TRUE;
+	if (phPort) {
+		// The process tree does not outlive this process
+		limitInfo.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+
+		hPort = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 1 );
+		JOBOBJECT_ASSOCIATE_COMPLETION_PORT portInfo = { hJob, hPort };
+		bSuccess = hPort && SetInformationJobObject( hJob,
+			JobObjectAssociateCompletionPortInformation, &portInfo, sizeof( portInfo ) );
+	}
+
+	if (! bSuccess ||
+		! SetInformationJobObject( hJob, JobObjectExtendedLimitInformation, &limitInfo,
+		sizeof( limitInfo ) ) ||
+		! AssignProcessToJobObject( hJob, hProcess )) {
+		// Most commonly, the process is already in a job that cannot be nested
+		// (before Windows 8).
+		DWORD dwError = GetLastError();
+		if (hPort) CloseHandle( hPort );
+		CloseHandle( hJob );
+		SetLastError( dwError );
+		return NULL;
+	}
+
+	if (phPort) *phPort = hPort;
+	return hJob;
+}
+
+
+//
+// Wait until all the processes of a job have exited.
+//
+BOOL waitForJob( HANDLE hJob, HANDLE hPort )
+{
+	for (;;) {
+		DWORD dwMessage = 0;
+		ULONG_PTR key = 0;
+		LPOVERLAPPED pOverlapped = NULL;
+		if (! GetQueuedCompletionStatus( hPort, &dwMessage, &key, &pOverlapped, INFINITE ))
+			return FALSE;
+
+		// The other messages: new process, process exit...
+		if (key == (ULONG_PTR) hJob && dwMessage == JOB_OBJECT_MSG_ACTIVE_PROCESS_ZERO)
+			return TRUE;
+	}
+}
+
+
+//
+// Get the resource usage of all the processes of a job.
+//
+BOOL getJobReport( HANDLE hJob, JobReport* pReport )
+{
+	JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accountingInfo = {0};
+	JOBOBJECT_EXTENDED_LIMIT_INFORMATION limitInfo = {0};
+
+	if (! QueryInformationJobObject( hJob, JobObjectBasicAndIoAccountingInformation,
+		&accountingInfo, sizeof( accountingInfo ), NULL ) ||
+		! QueryInformationJobObject( hJob, JobObjectExtendedLimitInformation,
+		&limitInfo, sizeof( limitInfo ), NULL ))
+		return FALSE;
+
+	pReport->ullUserTime = accountingInfo.BasicInfo.TotalUserTime.QuadPart;
+	pReport->ullKernelTime = accountingInfo.BasicInfo.TotalKernelTime.QuadPart;
+	pReport->nPeakJobMemory = limitInfo.PeakJobMemoryUsed;
+	pReport->nPeakProcessMemory = limitInfo.PeakProcessMemoryUsed;
+	pReport->ullReadOperations = accountingInfo.IoInfo.ReadOperationCount;
+	pReport->ullWriteOperations = accountingInfo.IoInfo.WriteOperationCount;
+	pReport->ullReadBytes = accountingInfo.IoInfo.ReadTransferCount;
+	pReport->ullWriteBytes = accountingInfo.IoInfo.WriteTransferCount;
+	pReport->dwTotalProcesses = accountingInfo.BasicInfo.TotalProcesses;
+	return TRUE;
+}
+
+
+//
+// Show the resource usage of a job as verbose messages.
+//
+void showJobReport( const JobReport* pReport )
+{
+	showFmtVerbose( L"Job processes: %lu", pReport->dwTotalProcesses );
+	showFmtVerbose( L"Job CPU time: user %llu ms, kernel %llu ms",
+		pReport->ullUserTime / 10000, pReport->ullKernelTime / 10000 );
+	showFmtVerbose( L"Job peak memory: job %llu KB, process %llu KB",
+		(ULONGLONG) pReport->nPeakJobMemory / 1024,
+		(ULONGLONG) pReport->nPeakProcessMemory / 1024 );
+	showFmtVerbose( L"Job I/O: %llu reads (%llu bytes), %llu writes (%llu bytes)",
+		pReport->ullReadOperations, pReport->ullReadBytes,
+		pReport->ullWriteOperations, pReport->ullWriteBytes );
+}
+
+
+//
+// Append the resource usage of a job to a file, as a JSON line.
+//
+BOOL writeJobReport( const wchar_t* pwszPath, const wchar_t* pwszCommandLine,
+	DWORD dwExitCode, const JobReport* pReport )
+{
+	BOOL bSuccess = FALSE;
+	wchar_t* pwszEscaped = escapeJsonString( pwszCommandLine );
+
+	wchar_t* pwszRecord = printFmtString(
+		L"{\"command\":\"%ls\",\"exitCode\":%ld,\"processes\":%lu,"
+		L"\"userTimeUs\":%llu,\"kernelTimeUs\":%llu,"
+		L"\"peakJobMemory\":%llu,\"peakProcessMemory\":%llu,"
+		L"\"readOperations\":%llu,\"writeOperations\":%llu,"
+		L"\"readBytes\":%llu,\"writeBytes\":%llu}\n",
+		pwszEscaped, dwExitCode, pReport->dwTotalProcesses,
+		pReport->ullUserTime / 10, pReport->ullKernelTime / 10,
+		(ULONGLONG) pReport->nPeakJobMemory, (ULONGLONG) pReport->nPeakProcessMemory,
+		pReport->ullReadOperations, pReport->ullWriteOperations,
+		pReport->ullReadBytes, pReport->ullWriteBytes );
+
+	if (pwszRecord) {
+		bSuccess = appendTextFile( pwszPath, pwszRecord );
+		freeHeap( pwszRecord );
+	}
+
+	freeHeap( pwszEscaped );
+	return bSuccess;
+}
+
+
+//
+// Check whether a process of a job is still running (TRUE if unknown).
+//
+static BOOL hasActiveProcesses( HANDLE hJob )
+{
+	JOBOBJECT_BASIC_ACCOUNTING_INFORMATION accountingInfo = {0};
+	return ! QueryInformationJobObject( hJob, JobObjectBasicAccountingInformation,
+		&accountingInfo, sizeof( accountingInfo ), NULL ) || accountingInfo.ActiveProcesses;
+}
+
+
+//
+// Terminate a watched process tree (thread pool callback): on the timeout, or
+// when the cancellation event is set.
+//
+static VOID CALLBACK terminateWatchedTree( PVOID pContext, BOOLEAN bTimedOut )
+{
+	JobWatch* pWatch = pContext;
+
+	// The process (or the whole tree) may have just exited by itself
+	if (pWatch->hProcess ? WaitForSingleObject( pWatch->hProcess, 0 ) == WAIT_TIMEOUT :
+		hasActiveProcesses( pWatch->hJob )) {
+		UINT nExitCode = bTimedOut ? ERROR_TIMEOUT : ERROR_CANCELLED;
+		InterlockedExchange( &pWatch->nReason, bTimedOut ? JOB_WATCH_TIMEOUT :
+			JOB_WATCH_CANCELLED );
+		if (! pWatch->hJob || ! TerminateJobObject( pWatch->hJob, nExitCode ))
+			TerminateProcess( pWatch->hProcess, nExitCode );
+	}
+	SetEvent( hTerminatedEvent );
+}
+
+
+//
+// Console control handler: cancel the watched process tree.
+//
+static BOOL WINAPI handleConsoleEvent( DWORD dwCtrlType )
+{
+	if (! bWatchActive) return FALSE;
+
+	// In a shared console, the process decides what Ctrl+C means:
+	// wait for it as usual.
+	if (bWatchSharedConsole &&
+		(dwCtrlType == CTRL_C_EVENT || dwCtrlType == CTRL_BREAK_EVENT))
+		return TRUE;
+
+	SetEvent( hCancelEvent );
+
+	// This process is ended when the handler returns from the close, logoff
+	// and shutdown events: let the tree be terminated first.
+	if (dwCtrlType != CTRL_C_EVENT && dwCtrlType != CTRL_BREAK_EVENT)
+		WaitForSingleObject( hTerminatedEvent, JOB_WATCH_CLOSE_DELAY );
+	return TRUE;
+}
+
+
+//
+// Start watching a process tree.
+//
+BOOL startJobWatch( JobWatch* pWatch, HANDLE hProcess, HANDLE hJob, DWORD dwTimeout,
+	BOOL bSharedConsole )
+{
+	pWatch->hProcess = hProcess;
+	pWatch->hJob = hJob;
+	pWatch->hWait = NULL;
+	pWatch->nReason = JOB_WATCH_NONE;
+
+	if (! hCancelEvent) {
+		hCancelEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+		hTerminatedEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+		if (! hCancelEvent || ! hTerminatedEvent) return FALSE;
+	}
+	ResetEvent( hCancelEvent );
+	ResetEvent( hTerminatedEvent );
+
+	if (! RegisterWaitForSingleObject( &pWatch->hWait, hCancelEvent, &terminateWatchedTree,
+		pWatch, dwTimeout, WT_EXECUTEONLYONCE )) {
+		pWatch->hWait = NULL;
+		return FALSE;
+	}
+
+	bWatchSharedConsole = bSharedConsole;
+	bWatchActive = TRUE;
+	SetConsoleCtrlHandler( &handleConsoleEvent, TRUE );
+	return TRUE;
+}
+
+
+//
+// Stop watching a process tree.
+//
+int stopJobWatch( JobWatch* pWatch )
+{
+	SetConsoleCtrlHandler( &handleConsoleEvent, FALSE );
+	bWatchActive = FALSE;
+
+	// Wait for a running termination to complete
+	if (pWatch->hWait) {
+		UnregisterWaitEx( pWatch->hWait, INVALID_HANDLE_VALUE );
+		pWatch->hWait = NULL;
+	}
+	return (int) pWatch->nReason;
+}
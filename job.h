@@ -0,0 +1,80 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	job.h
+
+	Job object management
+
+*/
+
+#include <windows.h>
+
+// Resource usage of all the processes of a job
+typedef struct {
+	ULONGLONG ullUserTime;         // Total user CPU time (100 ns units)
+	ULONGLONG ullKernelTime;       // Total kernel CPU time (100 ns units)
+	SIZE_T nPeakJobMemory;         // Peak memory committed by the whole job (bytes)
+	SIZE_T nPeakProcessMemory;     // Peak memory committed by a process (bytes)
+	ULONGLONG ullReadOperations;   // Number of I/O read operations
+	ULONGLONG ullWriteOperations;  // Number of I/O write operations
+	ULONGLONG ullReadBytes;        // Number of bytes read
+	ULONGLONG ullWriteBytes;       // Number of bytes written
+	DWORD dwTotalProcesses;        // Number of processes started in the job
+} JobReport;
+
+// Reasons of the termination of a watched process tree
+#define JOB_WATCH_NONE 0       // The process exited by itself
+#define JOB_WATCH_TIMEOUT 1    // The maximum run time elapsed
+#define JOB_WATCH_CANCELLED 2  // A console control event was received
+
+// Watch of a process tree: the process and the other processes of its job
+// are terminated when the maximum run time elapses or when a console control
+// event (Ctrl+C, Ctrl+Break, closing of the console) is received.
+// Only one watch can be active at a time.
+typedef struct {
+	HANDLE hProcess;        // Watched process (NULL: all the processes of the job)
+	HANDLE hJob;            // Job of the process (NULL: only the process is terminated)
+	HANDLE hWait;           // Registered wait for the timeout or the cancellation
+	volatile LONG nReason;  // Reason of the termination (JOB_WATCH_...)
+} JobWatch;
+
+// Create a job object and assign a (suspended) process to it.
+// The processes it creates are included in the job.
+// phPort: if not NULL, receives a completion port for waitForJob, and the
+// processes of the job are terminated when its last handle is closed (e.g.
+// when this process ends).
+// Returns NULL if an error occurs.
+HANDLE createProcessJob( HANDLE hProcess, HANDLE* phPort );
+
+// Wait until all the processes of a job have exited.
+// hPort: the completion port created with the job by createProcessJob.
+// Returns FALSE if an error occurs.
+BOOL waitForJob( HANDLE hJob, HANDLE hPort );
+
+// Get the resource usage of all the processes of a job.
+BOOL getJobReport( HANDLE hJob, JobReport* pReport );
+
+// Show the resource usage of a job as verbose messages.
+void showJobReport( const JobReport* pReport );
+
+// Append the resource usage of a job to a file, as a JSON line.
+BOOL writeJobReport( const wchar_t* pwszPath, const wchar_t* pwszCommandLine,
+	DWORD dwExitCode, const JobReport* pReport );
+
+// Start watching a process tree.
+// hProcess: the process whose exit ends the watch, or NULL to wait for all the
+// processes of the job (hJob is then required).
+// dwTimeout: maximum run time in milliseconds (INFINITE: no limit).
+// bSharedConsole: the process shares the console of this process, so
+// Ctrl+C and Ctrl+Break are left to it (the close, logoff and shutdown events
+// still terminate it).
+// Returns FALSE if an error occurs.
+BOOL startJobWatch( JobWatch* pWatch, HANDLE hProcess, HANDLE hJob, DWORD dwTimeout,
+	BOOL bSharedConsole );
+
+// Stop watching a process tree, once the process has exited.
+// Returns the reason of its termination (JOB_WATCH_...).
+int stopJobWatch( JobWatch* pWatch );
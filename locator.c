@@ -0,0 +1,195 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	locator.c
+
+	System process locator
+
+	Several strategies are tried in turn, the fastest first:
+	- SCM: the process id of the server of the SCM named pipe.
+	- Process scan: a single NtQuerySystemInformation snapshot of all the
+	  processes, matched by image name and session without any allocation.
+	- WTS enumeration: the former method, which also retrieves the name and
+	  the SID of each process.
+
+*/
+
+#include "locator.h"
+
+#include <wchar.h>
+#include <windows.h>
+#include <wtsapi32.h>
+
+#include "backend.h" // Win32 backend
+#include "output.h"  // Display functions
+#include "utils.h"   // Utility functions
+
+#define CUSTOM_ERROR_PROCESS_NOT_FOUND 0xA0001000
+
+#define SERVICES_IMAGE_NAME L"services.exe"
+
+// Named pipe of the service control manager (served by services.exe)
+#define SCM_PIPE_NAME L"\\\\.\\pipe\\ntsvcs"
+
+
+//
+// Check that a process runs as System in session 0.
+//
+static BOOL isSystemProcess( DWORD dwProcessId )
+{
+	DWORD dwSessionId = (DWORD) -1;
+	if (! pBackend->fnProcessIdToSessionId( dwProcessId, &dwSessionId ) || dwSessionId)
+		return FALSE;
+
+	BOOL bSystem = FALSE;
+	HANDLE hProcess = pBackend->fnOpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE,
+		dwProcessId );
+	if (hProcess) {
+		HANDLE hToken = NULL;
+		if (pBackend->fnOpenProcessToken( hProcess, TOKEN_QUERY, &hToken )) {
+			// TOKEN_USER followed by the SID
+			union {
+				TOKEN_USER tokenUser;
+				BYTE buffer[ sizeof( TOKEN_USER ) + SECURITY_MAX_SID_SIZE ];
+			} user;
+			DWORD dwLength = 0;
+			bSystem = pBackend->fnGetTokenInformation( hToken, TokenUser, &user,
+				sizeof( user ), &dwLength ) &&
+				IsWellKnownSid( user.tokenUser.User.Sid, WinLocalSystemSid );
+			pBackend->fnCloseHandle( hToken );
+		}
+		pBackend->fnCloseHandle( hProcess );
+	}
+
+	return bSystem;
+}
+
+
+//
+// SCM strategy: get the process id of the server of the SCM named pipe.
+//
+static DWORD locateByScm( void )
+{
+	HANDLE hPipe = pBackend->fnCreateFile( SCM_PIPE_NAME, FILE_READ_ATTRIBUTES, 0, NULL,
+		OPEN_EXISTING, 0, NULL );
+	if (hPipe == INVALID_HANDLE_VALUE) return 0;
+
+	ULONG ulProcessId = 0;
+	if (! pBackend->fnGetNamedPipeServerProcessId( hPipe, &ulProcessId )) ulProcessId = 0;
+	pBackend->fnCloseHandle( hPipe );
+
+	if (ulProcessId && ! isSystemProcess( ulProcessId )) ulProcessId = 0;
+	return ulProcessId;
+}
+
+
+//
+// Process scan strategy: search the process in a snapshot of all the processes.
+//
+static DWORD locateByScan( void )
+{
+	// Get the snapshot in a single buffer, enlarged if too small
+	ULONG ulSize = 0x80000;
+	BYTE* pBuffer = NULL;
+	LONG status;
+	do {
+		if (pBuffer) freeHeap( pBuffer );
+		pBuffer = allocHeap( 0, ulSize );
+		ULONG ulNeeded = 0;
+		status = pBackend->fnNtQuerySystemInformation( SystemProcessInformation, pBuffer,
+			ulSize, &ulNeeded );
+		// New processes may appear before the next call
+		if (ulNeeded > ulSize) ulSize = ulNeeded + 0x10000;
+		else ulSize *= 2;
+	} while (status == STATUS_INFO_LENGTH_MISMATCH);
+
+	DWORD dwProcessId = 0;
+	if (status >= 0) {
+		const size_t cbName = sizeof( SERVICES_IMAGE_NAME ) - sizeof( wchar_t );
+		const BYTE* p = pBuffer;
+		for (;;) {
+			const SystemProcessEntry* pEntry = (const SystemProcessEntry*) p;
+			if (pEntry->SessionId == 0 && pEntry->ImageName.Length == cbName &&
+				! _wcsnicmp( pEntry->ImageName.Buffer, SERVICES_IMAGE_NAME,
+					cbName / sizeof( wchar_t ) )) {
+				// Check the SID of the candidate only
+				DWORD dwCandidate = (DWORD) (ULONG_PTR) pEntry->UniqueProcessId;
+				if (isSystemProcess( dwCandidate )) {
+					dwProcessId = dwCandidate;
+					break;
+				}
+			}
+			if (! pEntry->NextEntryOffset) break;
+			p += pEntry->NextEntryOffset;
+		}
+	}
+
+	freeHeap( pBuffer );
+	return dwProcessId;
+}
+
+
+//
+// WTS enumeration strategy: search the process in the list of all the processes.
+//
+static DWORD locateByWts( void )
+{
+	DWORD dwProcessId = 0;
+	PWTS_PROCESS_INFOW pProcList = NULL;
+	DWORD dwProcCount = 0;
+
+	if (pBackend->fnWTSEnumerateProcesses( WTS_CURRENT_SERVER_HANDLE, 0, 1,
+		&pProcList, &dwProcCount )) {
+		PWTS_PROCESS_INFOW pProc = pProcList;
+		while (dwProcCount > 0) {
+			if (! pProc->SessionId && pProc->pProcessName &&
+				! _wcsicmp( SERVICES_IMAGE_NAME, pProc->pProcessName ) &&
+				pProc->pUserSid &&
+				IsWellKnownSid( pProc->pUserSid, WinLocalSystemSid )) {
+				dwProcessId = pProc->ProcessId;
+				break;
+			}
+			pProc++;
+			dwProcCount--;
+		}
+		pBackend->fnWTSFreeMemory( pProcList );
+	}
+
+	return dwProcessId;
+}
+
+
+static const struct {
+	const wchar_t* pwszName;
+	DWORD (*fnLocate)( void );
+} aStrategies[] = {
+	{ L"SCM", locateByScm },
+	{ L"process scan", locateByScan },
+	{ L"WTS enumeration", locateByWts }
+};
+
+
+DWORD locateServicesProcess( void )
+{
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency( &frequency );
+	QueryPerformanceCounter( &start );
+
+	for (int i = 0; i < sizeof( aStrategies ) / sizeof( aStrategies[ 0 ] ); i++) {
+		DWORD dwProcessId = aStrategies[ i ].fnLocate();
+		if (dwProcessId) {
+			QueryPerformanceCounter( &end );
+			showFmtVerbose( L"Found " SERVICES_IMAGE_NAME " (PID %lu) by %ls in %llu us",
+				dwProcessId, aStrategies[ i ].pwszName,
+				(ULONGLONG) (end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart );
+			return dwProcessId;
+		}
+		showFmtVerbose( L"Could not find " SERVICES_IMAGE_NAME " by %ls",
+			aStrategies[ i ].pwszName );
+	}
+
+	SetLastError( CUSTOM_ERROR_PROCESS_NOT_FOUND );
+	return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	locator.h
+
+	System process locator
+
+*/
+
+#include <windows.h>
+
+// Find the process id of services.exe (running as System in session 0).
+// Returns 0 if the process is not found (the last error is set).
+DWORD locateServicesProcess( void );
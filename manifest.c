@@ -0,0 +1,414 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	manifest.c
+
+	Manifest mode: run many commands with dependencies
+
+	Manifest file format (UTF-8 or UTF-16LE with BOM), one command per line:
+
+		<id> [after:<id>[,<id>...]] <command_line>
+
+	Empty lines and lines beginning with '#' are ignored.
+
+	The TrustedInstaller token is created once and used for all the commands.
+	A command starts when all the commands it depends on have succeeded (exit
+	code 0). If one of them fails, the command is skipped. Independent commands
+	run concurrently, up to the maximum number of jobs.
+
+*/
+
+#include "manifest.h"
+
+#include <wchar.h>
+#include <windows.h>
+
+#include "output.h" // Display functions
+#include "timing.h" // Launch phase timing
+#include "tokens.h" // Tokens and privileges management functions
+#include "utils.h"  // Utility functions
+
+enum NodeState {
+	NODE_PENDING,
+	NODE_RUNNING,
+	NODE_SUCCEEDED,
+	NODE_FAILED,         // Non-zero exit code
+	NODE_NOT_CREATED,    // Process creation failed
+	NODE_SKIPPED
+};
+
+typedef struct {
+	wchar_t* pwszId;           // Command id
+	wchar_t* pwszAfter;        // Dependencies (comma-separated ids), or NULL
+	wchar_t* pwszCommandLine;  // Command line (writable)
+	int iLine;                 // Line number in the manifest
+	int* piDeps;               // Indexes of the commands it depends on
+	int nDeps;
+	int nPendingDeps;          // Number of dependencies not yet succeeded
+	enum NodeState state;
+	HANDLE hProcess;
+	DWORD dwExitCode;
+	ULONGLONG ullStartTime;    // Start tick count (ms)
+	int iRunEvent;             // Timing event of the run
+} ManifestNode;
+
+typedef struct {
+	ManifestNode* pNodes;
+	int nNodes;
+} Manifest;
+
+
+static BOOL isSpace( wchar_t c )
+{
+	return c == L' ' || c == L'\t';
+}
+
+
+static int findNode( const Manifest* pManifest, const wchar_t* pwszId, size_t nLength )
+{
+	for (int i = 0; i < pManifest->nNodes; i++) {
+		const wchar_t* pwszNodeId = pManifest->pNodes[ i ].pwszId;
+		if (wcslen( pwszNodeId ) == nLength && ! wcsncmp( pwszNodeId, pwszId, nLength ))
+			return i;
+	}
+	return -1;
+}
+
+
+//
+// Parse the manifest text. The text is modified in place (the nodes point to it).
+//
+static int parseManifest( wchar_t* pwszText, Manifest* pManifest )
+{
+	// Count the lines to allocate the nodes
+	int nLines = 1;
+	for (wchar_t* p = pwszText; *p; p++) if (*p == L'\n') nLines++;
+	pManifest->pNodes = allocHeap( HEAP_ZERO_MEMORY, nLines * sizeof( ManifestNode ) );
+	pManifest->nNodes = 0;
+
+	wchar_t* p = pwszText;
+	for (int iLine = 1; *p; iLine++) {
+		// Isolate the line
+		wchar_t* pLine = p;
+		while (*p && *p != L'\n') p++;
+		wchar_t* pEnd = p;
+		if (*p) *p++ = L'\0';
+
+		// Trim the line
+		while (pEnd > pLine && (isSpace( pEnd[ -1 ] ) || pEnd[ -1 ] == L'\r'))
+			*--pEnd = L'\0';
+		while (isSpace( *pLine )) pLine++;
+		if (! *pLine || *pLine == L'#') continue;
+
+		ManifestNode* pNode = &pManifest->pNodes[ pManifest->nNodes ];
+		pNode->iLine = iLine;
+
+		// Command id
+		pNode->pwszId = pLine;
+		while (*pLine && ! isSpace( *pLine )) pLine++;
+		size_t nIdLength = pLine - pNode->pwszId;
+		if (*pLine) *pLine++ = L'\0';
+		while (isSpace( *pLine )) pLine++;
+
+		if (findNode( pManifest, pNode->pwszId, nIdLength ) >= 0) {
+			showFmtError( 0, 0, L"Manifest line %d: duplicate id '%ls'", iLine,
+				pNode->pwszId );
+			return 1;
+		}
+
+		// Dependencies
+		if (! _wcsnicmp( pLine, L"after:", 6 )) {
+			pLine += 6;
+			pNode->pwszAfter = pLine;
+			while (*pLine && ! isSpace( *pLine )) pLine++;
+			if (*pLine) *pLine++ = L'\0';
+			while (isSpace( *pLine )) pLine++;
+		}
+
+		// Command line
+		if (! *pLine) {
+			showFmtError( 0, 0, L"Manifest line %d: missing command", iLine );
+			return 1;
+		}
+		pNode->pwszCommandLine = pLine;
+
+		pManifest->nNodes++;
+	}
+
+	if (! pManifest->nNodes) {
+		showError( L"The manifest contains no command", 0, 0 );
+		return 1;
+	}
+
+	// Resolve the dependencies
+	for (int i = 0; i < pManifest->nNodes; i++) {
+		ManifestNode* pNode = &pManifest->pNodes[ i ];
+		if (! pNode->pwszAfter) continue;
+
+		int nDeps = 1;
+		for (wchar_t* q = pNode->pwszAfter; *q; q++) if (*q == L',') nDeps++;
+		pNode->piDeps = allocHeap( 0, nDeps * sizeof( int ) );
+
+		wchar_t* q = pNode->pwszAfter;
+		do {
+			wchar_t* pDep = q;
+			while (*q && *q != L',') q++;
+			int iDep = findNode( pManifest, pDep, q - pDep );
+			if (iDep < 0 || iDep == i) {
+				showFmtError( 0, 0, L"Manifest line %d: invalid dependency '%.*ls'",
+					pNode->iLine, (int) (q - pDep), pDep );
+				return 1;
+			}
+			pNode->piDeps[ pNode->nDeps++ ] = iDep;
+		} while (*q++);
+		pNode->nPendingDeps = pNode->nDeps;
+	}
+
+	// Check that the dependency graph has no cycle (topological sort)
+	int* pnRemaining = allocHeap( 0, pManifest->nNodes * sizeof( int ) );
+	BOOL* pbSorted = allocHeap( HEAP_ZERO_MEMORY, pManifest->nNodes * sizeof( BOOL ) );
+	for (int i = 0; i < pManifest->nNodes; i++)
+		pnRemaining[ i ] = pManifest->pNodes[ i ].nDeps;
+
+	int nSorted = 0;
+	BOOL bProgress = TRUE;
+	while (bProgress) {
+		bProgress = FALSE;
+		for (int i = 0; i < pManifest->nNodes; i++) {
+			if (pbSorted[ i ] || pnRemaining[ i ]) continue;
+			pbSorted[ i ] = TRUE;
+			nSorted++;
+			bProgress = TRUE;
+			for (int j = 0; j < pManifest->nNodes; j++) {
+				const ManifestNode* pNode = &pManifest->pNodes[ j ];
+				for (int k = 0; k < pNode->nDeps; k++)
+					if (pNode->piDeps[ k ] == i) pnRemaining[ j ]--;
+			}
+		}
+	}
+
+	int errCode = 0;
+	if (nSorted < pManifest->nNodes) {
+		for (int i = 0; i < pManifest->nNodes; i++) {
+			if (! pbSorted[ i ]) {
+				showFmtError( 0, 0, L"Manifest line %d: cyclic dependency on '%ls'",
+					pManifest->pNodes[ i ].iLine, pManifest->pNodes[ i ].pwszId );
+				break;
+			}
+		}
+		errCode = 1;
+	}
+
+	freeHeap( pbSorted );
+	freeHeap( pnRemaining );
+	return errCode;
+}
+
+
+static void freeManifest( Manifest* pManifest )
+{
+	if (! pManifest->pNodes) return;
+	for (int i = 0; i < pManifest->nNodes; i++)
+		if (pManifest->pNodes[ i ].piDeps) freeHeap( pManifest->pNodes[ i ].piDeps );
+	freeHeap( pManifest->pNodes );
+	pManifest->pNodes = NULL;
+}
+
+
+//
+// Skip all the pending commands depending (directly or not) on a failed command.
+//
+static void skipDependents( Manifest* pManifest, int iFailed )
+{
+	for (int i = 0; i < pManifest->nNodes; i++) {
+		ManifestNode* pNode = &pManifest->pNodes[ i ];
+		if (pNode->state != NODE_PENDING) continue;
+		for (int k = 0; k < pNode->nDeps; k++) {
+			if (pNode->piDeps[ k ] == iFailed) {
+				pNode->state = NODE_SKIPPED;
+				showFmtInfo( L"[%ls] skipped (dependency '%ls' failed)\n",
+					pNode->pwszId, pManifest->pNodes[ iFailed ].pwszId );
+				skipDependents( pManifest, i );
+				break;
+			}
+		}
+	}
+}
+
+
+//
+// Start a command. Returns FALSE if the process could not be created.
+//
+static BOOL startNode( ManifestNode* pNode, HANDLE hToken )
+{
+	STARTUPINFO startupInfo = {0};
+	startupInfo.cb = sizeof( STARTUPINFO );
+
+	PROCESS_INFORMATION processInfo = {0};
+
+	showFmtVerbose( L"[%ls] Starting '%ls'", pNode->pwszId, pNode->pwszCommandLine );
+	pNode->ullStartTime = GetTickCount64();
+
+	int iEvent = beginPhase( PHASE_CREATE_PROCESS );
+	if (! CreateProcessAsUser( hToken, NULL, pNode->pwszCommandLine, NULL, NULL, FALSE,
+		0, NULL, NULL, &startupInfo, &processInfo )) {
+		DWORD dwError = GetLastError();
+		endPhaseStep( iEvent, dwError, 0 );
+		showFmtError( dwError, 0, L"[%ls] Process creation failed", pNode->pwszId );
+		return FALSE;
+	}
+	endPhase( iEvent );
+
+	// Show each command on its own track (the process id cannot be a thread id)
+	pNode->iRunEvent = beginPhase( PHASE_CHILD_RUN );
+	setEventTrack( iEvent, processInfo.dwProcessId, pNode->pwszId );
+	setEventTrack( pNode->iRunEvent, processInfo.dwProcessId, pNode->pwszId );
+
+	showFmtVerbose( L"[%ls] Created process ID: %lu", pNode->pwszId,
+		processInfo.dwProcessId );
+	CloseHandle( processInfo.hThread );
+	pNode->hProcess = processInfo.hProcess;
+	return TRUE;
+}
+
+
+//
+// Run the commands in dependency order, up to nMaxJobs at the same time.
+//
+static void scheduleManifest( Manifest* pManifest, int nMaxJobs, HANDLE hToken )
+{
+	HANDLE ahRunning[ MANIFEST_MAX_JOBS ];
+	int aiRunning[ MANIFEST_MAX_JOBS ];
+	int nRunning = 0;
+
+	for (;;) {
+		// Start the ready commands, in manifest order
+		for (int i = 0; i < pManifest->nNodes && nRunning < nMaxJobs; i++) {
+			ManifestNode* pNode = &pManifest->pNodes[ i ];
+			if (pNode->state != NODE_PENDING || pNode->nPendingDeps) continue;
+
+			if (startNode( pNode, hToken )) {
+				pNode->state = NODE_RUNNING;
+				ahRunning[ nRunning ] = pNode->hProcess;
+				aiRunning[ nRunning ] = i;
+				nRunning++;
+			}
+			else {
+				pNode->state = NODE_NOT_CREATED;
+				skipDependents( pManifest, i );
+			}
+		}
+
+		if (! nRunning) break;  // Nothing left to run
+
+		// Wait for a command to finish
+		DWORD dwWait = WaitForMultipleObjects( nRunning, ahRunning, FALSE, INFINITE );
+		if (dwWait >= WAIT_OBJECT_0 + nRunning) {
+			showError( L"Failed to wait for the processes", GetLastError(), 0 );
+			break;
+		}
+
+		int iSlot = dwWait - WAIT_OBJECT_0;
+		int iNode = aiRunning[ iSlot ];
+		ManifestNode* pNode = &pManifest->pNodes[ iNode ];
+
+		// Remove it from the running list
+		nRunning--;
+		ahRunning[ iSlot ] = ahRunning[ nRunning ];
+		aiRunning[ iSlot ] = aiRunning[ nRunning ];
+
+		ULONGLONG ullElapsed = GetTickCount64() - pNode->ullStartTime;
+		if (! GetExitCodeProcess( pNode->hProcess, &pNode->dwExitCode ))
+			pNode->dwExitCode = (DWORD) -1;
+		endPhaseStep( pNode->iRunEvent, pNode->dwExitCode, 0 );
+		CloseHandle( pNode->hProcess );
+		pNode->hProcess = NULL;
+
+		showFmtInfo( L"[%ls] exited with code %ld (%llu ms)\n", pNode->pwszId,
+			pNode->dwExitCode, ullElapsed );
+
+		if (pNode->dwExitCode == 0) {
+			pNode->state = NODE_SUCCEEDED;
+			for (int i = 0; i < pManifest->nNodes; i++) {
+				ManifestNode* pDependent = &pManifest->pNodes[ i ];
+				for (int k = 0; k < pDependent->nDeps; k++)
+					if (pDependent->piDeps[ k ] == iNode) pDependent->nPendingDeps--;
+			}
+		}
+		else {
+			pNode->state = NODE_FAILED;
+			skipDependents( pManifest, iNode );
+		}
+	}
+
+	// In case of error, leave the remaining processes running
+	for (int i = 0; i < nRunning; i++) CloseHandle( ahRunning[ i ] );
+}
+
+
+int runManifest( const wchar_t* pwszPath, int nMaxJobs, PrivilegeMask privileges,
+	MissingPrivilegeFunc fnMPCb, int* pnExitCode )
+{
+	int errCode = 0;
+	Manifest manifest = {0};
+
+	// Read and parse the manifest
+	wchar_t* pwszText = readTextFile( pwszPath );
+	if (! pwszText) {
+		showFmtError( GetLastError(), 0, L"Failed to read manifest '%ls'", pwszPath );
+		return 1;
+	}
+	errCode = parseManifest( pwszText, &manifest );
+
+	// Create the child process token once
+	HANDLE hBaseProcess = NULL, hBaseToken = NULL, hToken = NULL;
+	if (! errCode) errCode = getTrustedInstallerProcess( &hBaseProcess );
+	if (! errCode) {
+		errCode = createChildProcessToken( hBaseProcess, &hBaseToken );
+		CloseHandle( hBaseProcess );
+	}
+	if (! errCode) {
+		errCode = duplicateChildProcessToken( hBaseToken,
+			WTSGetActiveConsoleSessionId(), privileges, fnMPCb, &hToken );
+		CloseHandle( hBaseToken );
+	}
+
+	if (! errCode) {
+		showFmtVerbose( L"Running %d commands, up to %d at a time", manifest.nNodes,
+			nMaxJobs );
+		scheduleManifest( &manifest, nMaxJobs, hToken );
+		CloseHandle( hToken );
+
+		// Aggregate result: the exit code of the first failed command
+		int nSucceeded = 0, nFailed = 0, nSkipped = 0;
+		*pnExitCode = 0;
+		for (int i = 0; i < manifest.nNodes; i++) {
+			const ManifestNode* pNode = &manifest.pNodes[ i ];
+			switch (pNode->state) {
+			case NODE_SUCCEEDED:
+				nSucceeded++;
+				break;
+			case NODE_FAILED:
+				if (! nFailed) *pnExitCode = (int) pNode->dwExitCode;
+				nFailed++;
+				break;
+			case NODE_NOT_CREATED:
+				if (! nFailed) errCode = 4;  // Process creation failed
+				nFailed++;
+				break;
+			default:
+				nSkipped++;
+				break;
+			}
+		}
+
+		showFmtInfo( L"%d succeeded, %d failed, %d skipped\n", nSucceeded, nFailed,
+			nSkipped );
+	}
+
+	freeManifest( &manifest );
+	freeHeap( pwszText );
+	return errCode;
+}
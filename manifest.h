@@ -0,0 +1,24 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	manifest.h
+
+	Manifest mode: run many commands with dependencies
+
+*/
+
+#include <windows.h>
+
+#include "tokens.h" // Tokens and privileges management functions
+
+// Maximum number of commands running at the same time
+#define MANIFEST_MAX_JOBS MAXIMUM_WAIT_OBJECTS
+
+// Run the commands of a manifest file.
+// SeDebugPrivilege must be acquired and the system context must be created.
+// pnExitCode receives the aggregate result (0 if all the commands succeeded).
+int runManifest( const wchar_t* pwszPath, int nMaxJobs, PrivilegeMask privileges,
+	MissingPrivilegeFunc fnMPCb, int* pnExitCode );
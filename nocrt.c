@@ -0,0 +1,579 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	nocrt.c
+
+	C runtime replacement for the CRT-free build variant (make NOCRT=1)
+
+	- Entry points: wmainCRTStartup (console programs) or wWinMainCRTStartup
+	  (superUserW, compiled with NOCRT_WINMAIN)
+	- abort, and the string functions used by the sources and by the compiler
+	- Formatting: _vsnwprintf_s and _vscwprintf, with the conversions used by
+	  the sources (d i u x X c s p f %, flags - 0 + and space, width,
+	  precision, and the h l ll I64 z size prefixes)
+
+	The functions are defined under their CRT symbol names, and under the
+	__imp_ names used when the SDK headers declare them as imported from the
+	C runtime DLL.
+
+*/
+
+#include <stdarg.h>
+#include <windows.h>
+
+#include "args.h"  // Command line parsing
+
+#define SYMBOL_STRING2( x ) #x
+#define SYMBOL_STRING( x ) SYMBOL_STRING2( x )
+
+// Symbol of a C function, and of its import pointer
+#define CRT_SYMBOL( name ) SYMBOL_STRING( __USER_LABEL_PREFIX__ ) name
+#define CRT_IMPORT_SYMBOL( name ) "__imp_" CRT_SYMBOL( name )
+
+// Define the import pointer of a function
+#define CRT_IMPORT( name, function ) \
+	__attribute__(( used )) void* const pImport_##function __asm__( CRT_IMPORT_SYMBOL( name ) ) = \
+		(void*) function
+
+// Keep the functions called by the compiler (memcpy...) after link-time
+// optimization, and prevent GCC from replacing their loops by calls to
+// themselves.
+#if defined( __GNUC__ ) && ! defined( __clang__ )
+#define CRT_FUNCTION __attribute__(( used, optimize( "no-tree-loop-distribute-patterns" ) ))
+#else
+#define CRT_FUNCTION __attribute__(( used ))
+#endif
+
+
+//
+// Entry points
+//
+
+#ifdef NOCRT_WINMAIN
+
+int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine,
+	int nShowCmd );
+
+__attribute__(( used )) void wWinMainCRTStartup( void )
+{
+	// Command line without the program name
+	ArgumentParser parser;
+	initArgumentParser( &parser, NULL );
+	wchar_t* pwszCmdLine = parser.p;
+	while (*pwszCmdLine == L' ' || *pwszCmdLine == L'\t') pwszCmdLine++;
+
+	STARTUPINFOW startupInfo;
+	GetStartupInfoW( &startupInfo );
+	int nShowCmd = (startupInfo.dwFlags & STARTF_USESHOWWINDOW) ?
+		startupInfo.wShowWindow : SW_SHOWDEFAULT;
+
+	ExitProcess( wWinMain( GetModuleHandle( NULL ), NULL, pwszCmdLine, nShowCmd ) );
+}
+
+#else
+
+int wmain( void );
+
+__attribute__(( used )) void wmainCRTStartup( void )
+{
+	ExitProcess( wmain() );
+}
+
+#endif
+
+
+// Terminate the process, with the exit code of the CRT abort
+CRT_FUNCTION __attribute__(( noreturn )) void crtAbort( void ) __asm__( CRT_SYMBOL( "abort" ) );
+CRT_FUNCTION __attribute__(( noreturn )) void crtAbort( void )
+{
+	ExitProcess( 3 );
+}
+CRT_IMPORT( "abort", crtAbort );
+
+
+//
+// Memory functions
+//
+
+CRT_FUNCTION void* crtMemcpy( void* pDest, const void* pSrc, size_t nSize )
+	__asm__( CRT_SYMBOL( "memcpy" ) );
+CRT_FUNCTION void* crtMemcpy( void* pDest, const void* pSrc, size_t nSize )
+{
+	BYTE* d = pDest;
+	const BYTE* s = pSrc;
+	while (nSize--) *d++ = *s++;
+	return pDest;
+}
+CRT_IMPORT( "memcpy", crtMemcpy );
+
+
+CRT_FUNCTION void* crtMemmove( void* pDest, const void* pSrc, size_t nSize )
+	__asm__( CRT_SYMBOL( "memmove" ) );
+CRT_FUNCTION void* crtMemmove( void* pDest, const void* pSrc, size_t nSize )
+{
+	BYTE* d = pDest;
+	const BYTE* s = pSrc;
+	if (d < s) {
+		while (nSize--) *d++ = *s++;
+	}
+	else {
+		d += nSize;
+		s += nSize;
+		while (nSize--) *--d = *--s;
+	}
+	return pDest;
+}
+CRT_IMPORT( "memmove", crtMemmove );
+
+
+CRT_FUNCTION void* crtMemset( void* pDest, int c, size_t nSize )
+	__asm__( CRT_SYMBOL( "memset" ) );
+CRT_FUNCTION void* crtMemset( void* pDest, int c, size_t nSize )
+{
+	BYTE* d = pDest;
+	while (nSize--) *d++ = (BYTE) c;
+	return pDest;
+}
+CRT_IMPORT( "memset", crtMemset );
+
+
+CRT_FUNCTION int crtMemcmp( const void* p1, const void* p2, size_t nSize )
+	__asm__( CRT_SYMBOL( "memcmp" ) );
+CRT_FUNCTION int crtMemcmp( const void* p1, const void* p2, size_t nSize )
+{
+	const BYTE* s1 = p1;
+	const BYTE* s2 = p2;
+	for (; nSize; nSize--, s1++, s2++) {
+		if (*s1 != *s2) return *s1 - *s2;
+	}
+	return 0;
+}
+CRT_IMPORT( "memcmp", crtMemcmp );
+
+
+//
+// String functions (case-insensitive comparisons fold ASCII letters only, as
+// the "C" locale of the CRT)
+//
+
+static wchar_t toLowerAscii( wchar_t c )
+{
+	return (c >= L'A' && c <= L'Z') ? c + (L'a' - L'A') : c;
+}
+
+
+CRT_FUNCTION size_t crtWcslen( const wchar_t* pwsz ) __asm__( CRT_SYMBOL( "wcslen" ) );
+CRT_FUNCTION size_t crtWcslen( const wchar_t* pwsz )
+{
+	const wchar_t* p = pwsz;
+	while (*p) p++;
+	return p - pwsz;
+}
+CRT_IMPORT( "wcslen", crtWcslen );
+
+
+CRT_FUNCTION int crtWcsncmp( const wchar_t* pwsz1, const wchar_t* pwsz2, size_t nCount )
+	__asm__( CRT_SYMBOL( "wcsncmp" ) );
+CRT_FUNCTION int crtWcsncmp( const wchar_t* pwsz1, const wchar_t* pwsz2, size_t nCount )
+{
+	for (; nCount; nCount--, pwsz1++, pwsz2++) {
+		if (*pwsz1 != *pwsz2) return (*pwsz1 < *pwsz2) ? -1 : 1;
+		if (! *pwsz1) break;
+	}
+	return 0;
+}
+CRT_IMPORT( "wcsncmp", crtWcsncmp );
+
+
+CRT_FUNCTION int crtWcsnicmp( const wchar_t* pwsz1, const wchar_t* pwsz2, size_t nCount )
+	__asm__( CRT_SYMBOL( "_wcsnicmp" ) );
+CRT_FUNCTION int crtWcsnicmp( const wchar_t* pwsz1, const wchar_t* pwsz2, size_t nCount )
+{
+	for (; nCount; nCount--, pwsz1++, pwsz2++) {
+		wchar_t c1 = toLowerAscii( *pwsz1 );
+		wchar_t c2 = toLowerAscii( *pwsz2 );
+		if (c1 != c2) return (c1 < c2) ? -1 : 1;
+		if (! c1) break;
+	}
+	return 0;
+}
+CRT_IMPORT( "_wcsnicmp", crtWcsnicmp );
+
+
+CRT_FUNCTION int crtWcsicmp( const wchar_t* pwsz1, const wchar_t* pwsz2 )
+	__asm__( CRT_SYMBOL( "_wcsicmp" ) );
+CRT_FUNCTION int crtWcsicmp( const wchar_t* pwsz1, const wchar_t* pwsz2 )
+{
+	return crtWcsnicmp( pwsz1, pwsz2, (size_t) -1 );
+}
+CRT_IMPORT( "_wcsicmp", crtWcsicmp );
+
+
+//
+// Convert a string to a long or unsigned long (wcstol and wcstoul): on
+// overflow, the limit of the type is returned.
+//
+static unsigned long convertInteger( const wchar_t* pwsz, wchar_t** ppEnd, int nBase,
+	BOOL bUnsigned )
+{
+	const wchar_t* p = pwsz;
+	while (*p == L' ' || (*p >= L'\t' && *p <= L'\r')) p++;
+
+	BOOL bNegative = FALSE;
+	if (*p == L'-' || *p == L'+') bNegative = (*p++ == L'-');
+
+	if ((nBase == 0 || nBase == 16) && p[ 0 ] == L'0' && toLowerAscii( p[ 1 ] ) == L'x') {
+		p += 2;
+		nBase = 16;
+	}
+	else if (nBase == 0) nBase = (*p == L'0') ? 8 : 10;
+
+	unsigned long nLimit = bUnsigned ? 0xFFFFFFFFUL : bNegative ? 0x80000000UL : 0x7FFFFFFFUL;
+	unsigned long nValue = 0;
+	BOOL bOverflow = FALSE;
+	const wchar_t* pDigits = p;
+	for (;; p++) {
+		wchar_t c = toLowerAscii( *p );
+		int nDigit = (c >= L'0' && c <= L'9') ? c - L'0' : (c >= L'a' && c <= L'z') ?
+			c - L'a' + 10 : 99;
+		if (nDigit >= nBase) break;
+		if (nValue > (nLimit - nDigit) / nBase) bOverflow = TRUE;
+		else nValue = nValue * nBase + nDigit;
+	}
+
+	if (p == pDigits) {
+		// No digits
+		if (ppEnd) *ppEnd = (wchar_t*) pwsz;
+		return 0;
+	}
+	if (ppEnd) *ppEnd = (wchar_t*) p;
+	if (bOverflow) {
+		if (bUnsigned) return nLimit;
+		nValue = nLimit;
+	}
+	return bNegative ? 0 - nValue : nValue;
+}
+
+
+CRT_FUNCTION long crtWcstol( const wchar_t* pwsz, wchar_t** ppEnd, int nBase )
+	__asm__( CRT_SYMBOL( "wcstol" ) );
+CRT_FUNCTION long crtWcstol( const wchar_t* pwsz, wchar_t** ppEnd, int nBase )
+{
+	return (long) convertInteger( pwsz, ppEnd, nBase, FALSE );
+}
+CRT_IMPORT( "wcstol", crtWcstol );
+
+
+CRT_FUNCTION unsigned long crtWcstoul( const wchar_t* pwsz, wchar_t** ppEnd, int nBase )
+	__asm__( CRT_SYMBOL( "wcstoul" ) );
+CRT_FUNCTION unsigned long crtWcstoul( const wchar_t* pwsz, wchar_t** ppEnd, int nBase )
+{
+	return convertInteger( pwsz, ppEnd, nBase, TRUE );
+}
+CRT_IMPORT( "wcstoul", crtWcstoul );
+
+
+//
+// Formatting
+//
+
+// Output of the formatting: the characters beyond the buffer are counted only
+typedef struct {
+	wchar_t* p;
+	wchar_t* pEnd;   // End of the buffer, without the terminating NUL
+	size_t nLength;  // Length of the whole formatted string
+} FormatOutput;
+
+
+static void putChars( FormatOutput* pOut, const wchar_t* pChars, size_t nCount )
+{
+	pOut->nLength += nCount;
+	while (nCount-- && pOut->p < pOut->pEnd) *pOut->p++ = *pChars++;
+}
+
+
+static void putRepeated( FormatOutput* pOut, wchar_t c, int nCount )
+{
+	for (; nCount > 0; nCount--) {
+		pOut->nLength++;
+		if (pOut->p < pOut->pEnd) *pOut->p++ = c;
+	}
+}
+
+
+//
+// Write a field: a sign (or prefix), then a body, padded to the width with
+// spaces, or with zeros between the sign and the body.
+//
+static void putField( FormatOutput* pOut, const wchar_t* pSign, size_t nSignLength,
+	const wchar_t* pBody, size_t nBodyLength, int nWidth, BOOL bLeft, BOOL bZero )
+{
+	int nPadding = nWidth - (int) (nSignLength + nBodyLength);
+	if (! bLeft && ! bZero) putRepeated( pOut, L' ', nPadding );
+	putChars( pOut, pSign, nSignLength );
+	if (! bLeft && bZero) putRepeated( pOut, L'0', nPadding );
+	putChars( pOut, pBody, nBodyLength );
+	if (bLeft) putRepeated( pOut, L' ', nPadding );
+}
+
+
+//
+// Write an integer, with at least nPrecision digits. wcPositive is the sign
+// of a positive number: '+', ' ' (flags + and space) or 0.
+//
+static void putInteger( FormatOutput* pOut, ULONGLONG nValue, BOOL bNegative,
+	wchar_t wcPositive, unsigned nBase, BOOL bUpper, int nPrecision, int nWidth, BOOL bLeft,
+	BOOL bZero )
+{
+	const wchar_t* pwszDigits = bUpper ? L"0123456789ABCDEF" : L"0123456789abcdef";
+	wchar_t awcDigits[ 64 ];
+	wchar_t* p = awcDigits + 64;
+
+	if (nPrecision > 32) nPrecision = 32;
+	while (nValue) {
+		*--p = pwszDigits[ nValue % nBase ];
+		nValue /= nBase;
+	}
+	int nDigits = (int) (awcDigits + 64 - p);
+	int nMinDigits = (nPrecision < 0) ? 1 : nPrecision;
+	for (; nDigits < nMinDigits; nDigits++) *--p = L'0';
+
+	// The 0 flag is ignored with a precision
+	wchar_t wcSign = bNegative ? L'-' : wcPositive;
+	putField( pOut, &wcSign, wcSign ? 1 : 0, p, nDigits, nWidth, bLeft,
+		bZero && nPrecision < 0 );
+}
+
+
+//
+// Write a floating-point number in decimal notation (%f).
+//
+static void putDouble( FormatOutput* pOut, double dValue, wchar_t wcPositive, int nPrecision,
+	int nWidth, BOOL bLeft, BOOL bZero )
+{
+	if (nPrecision < 0) nPrecision = 6;
+	if (nPrecision > 9) nPrecision = 9;
+
+	wchar_t wcSign = (dValue < 0) ? L'-' : wcPositive;
+	if (dValue < 0) dValue = -dValue;
+
+	if (dValue != dValue) {
+		putField( pOut, NULL, 0, L"nan", 3, nWidth, bLeft, FALSE );
+		return;
+	}
+	if (dValue >= 1.8e19) {
+		// Infinity, or beyond the integer part range
+		putField( pOut, &wcSign, wcSign ? 1 : 0, L"inf", 3, nWidth, bLeft, FALSE );
+		return;
+	}
+
+	ULONGLONG nScale = 1;
+	for (int i = 0; i < nPrecision; i++) nScale *= 10;
+	ULONGLONG nWhole = (ULONGLONG) dValue;
+	ULONGLONG nFraction = (ULONGLONG) ((dValue - (double) nWhole) * (double) nScale + 0.5);
+	if (nFraction >= nScale) {
+		nWhole++;
+		nFraction -= nScale;
+	}
+
+	// Integer part, point, fraction
+	wchar_t awcBody[ 32 ];
+	wchar_t* p = awcBody + 32;
+	for (int i = 0; i < nPrecision; i++) {
+		*--p = L'0' + (wchar_t) (nFraction % 10);
+		nFraction /= 10;
+	}
+	if (nPrecision) *--p = L'.';
+	do {
+		*--p = L'0' + (wchar_t) (nWhole % 10);
+		nWhole /= 10;
+	} while (nWhole);
+
+	putField( pOut, &wcSign, wcSign ? 1 : 0, p, awcBody + 32 - p, nWidth, bLeft, bZero );
+}
+
+
+//
+// Format a string to a buffer of nSize characters (the result is truncated
+// and NUL-terminated if nSize is not 0). Returns the length of the whole
+// formatted string.
+//
+static size_t formatString( wchar_t* pBuffer, size_t nSize, const wchar_t* pwszFormat,
+	va_list args )
+{
+	FormatOutput out = { pBuffer, pBuffer + (nSize ? nSize - 1 : 0), 0 };
+
+	for (const wchar_t* f = pwszFormat; *f; f++) {
+		if (*f != L'%') {
+			const wchar_t* pBegin = f;
+			while (f[ 1 ] && f[ 1 ] != L'%') f++;
+			putChars( &out, pBegin, f - pBegin + 1 );
+			continue;
+		}
+		f++;
+
+		// Flags
+		BOOL bLeft = FALSE, bZero = FALSE;
+		wchar_t wcPositive = 0;  // Sign of the positive numbers (the + flag wins)
+		for (;; f++) {
+			if (*f == L'-') bLeft = TRUE;
+			else if (*f == L'0') bZero = TRUE;
+			else if (*f == L'+') wcPositive = L'+';
+			else if (*f == L' ') {
+				if (! wcPositive) wcPositive = L' ';
+			}
+			else if (*f != L'#') break;
+		}
+
+		// Width and precision
+		int nWidth = 0;
+		if (*f == L'*') {
+			nWidth = va_arg( args, int );
+			if (nWidth < 0) {
+				bLeft = TRUE;
+				nWidth = -nWidth;
+			}
+			f++;
+		}
+		else while (*f >= L'0' && *f <= L'9') nWidth = nWidth * 10 + (*f++ - L'0');
+
+		int nPrecision = -1;
+		if (*f == L'.') {
+			f++;
+			nPrecision = 0;
+			if (*f == L'*') {
+				nPrecision = va_arg( args, int );
+				if (nPrecision < 0) nPrecision = -1;
+				f++;
+			}
+			else while (*f >= L'0' && *f <= L'9') nPrecision = nPrecision * 10 + (*f++ - L'0');
+		}
+
+		// Size prefix
+		enum { SIZE_INT, SIZE_SHORT, SIZE_LONG, SIZE_LONGLONG, SIZE_POINTER } size = SIZE_INT;
+		if (f[ 0 ] == L'l' && f[ 1 ] == L'l') {
+			size = SIZE_LONGLONG;
+			f += 2;
+		}
+		else if (f[ 0 ] == L'I' && f[ 1 ] == L'6' && f[ 2 ] == L'4') {
+			size = SIZE_LONGLONG;
+			f += 3;
+		}
+		else if (*f == L'l' || *f == L'w') {
+			size = SIZE_LONG;
+			f++;
+		}
+		else if (*f == L'h') {
+			size = SIZE_SHORT;
+			f++;
+		}
+		else if (*f == L'z' || *f == L'I') {
+			size = SIZE_POINTER;
+			f++;
+		}
+
+		switch (*f) {
+		case L'd':
+		case L'i': {
+			LONGLONG nValue =
+				(size == SIZE_LONGLONG) ? va_arg( args, LONGLONG ) :
+				(size == SIZE_POINTER) ? va_arg( args, INT_PTR ) :
+				(size == SIZE_LONG) ? va_arg( args, long ) :
+				(size == SIZE_SHORT) ? (short) va_arg( args, int ) : va_arg( args, int );
+			putInteger( &out, (nValue < 0) ? 0 - (ULONGLONG) nValue : (ULONGLONG) nValue,
+				nValue < 0, wcPositive, 10, FALSE, nPrecision, nWidth, bLeft, bZero );
+			break;
+		}
+		case L'u':
+		case L'x':
+		case L'X': {
+			ULONGLONG nValue =
+				(size == SIZE_LONGLONG) ? va_arg( args, ULONGLONG ) :
+				(size == SIZE_POINTER) ? va_arg( args, UINT_PTR ) :
+				(size == SIZE_LONG) ? va_arg( args, unsigned long ) :
+				(size == SIZE_SHORT) ? (unsigned short) va_arg( args, unsigned int ) :
+				va_arg( args, unsigned int );
+			putInteger( &out, nValue, FALSE, 0, (*f == L'u') ? 10 : 16, *f == L'X', nPrecision,
+				nWidth, bLeft, bZero );
+			break;
+		}
+		case L'p':
+			putInteger( &out, (UINT_PTR) va_arg( args, void* ), FALSE, 0, 16, TRUE,
+				2 * sizeof( void* ), nWidth, bLeft, FALSE );
+			break;
+		case L'c': {
+			// A wide character, or a narrow one with h
+			wchar_t c = (wchar_t) va_arg( args, int );
+			if (size == SIZE_SHORT) c = (BYTE) c;
+			putField( &out, NULL, 0, &c, 1, nWidth, bLeft, FALSE );
+			break;
+		}
+		case L's': {
+			// A wide string, or a narrow one (ASCII) with h
+			if (size == SIZE_SHORT) {
+				const char* psz = va_arg( args, const char* );
+				if (! psz) psz = "(null)";
+				int nLength = 0;
+				while (psz[ nLength ] && (nPrecision < 0 || nLength < nPrecision)) nLength++;
+				if (! bLeft) putRepeated( &out, L' ', nWidth - nLength );
+				for (int i = 0; i < nLength; i++) {
+					wchar_t c = (BYTE) psz[ i ];
+					putChars( &out, &c, 1 );
+				}
+				if (bLeft) putRepeated( &out, L' ', nWidth - nLength );
+			}
+			else {
+				const wchar_t* pwsz = va_arg( args, const wchar_t* );
+				if (! pwsz) pwsz = L"(null)";
+				size_t nLength = 0;
+				while (pwsz[ nLength ] && (nPrecision < 0 || nLength < (size_t) nPrecision))
+					nLength++;
+				putField( &out, NULL, 0, pwsz, nLength, nWidth, bLeft, FALSE );
+			}
+			break;
+		}
+		case L'f':
+		case L'F':
+			putDouble( &out, va_arg( args, double ), wcPositive, nPrecision, nWidth, bLeft,
+				bZero );
+			break;
+		case L'\0':
+			// Incomplete conversion at the end of the format
+			f--;
+			break;
+		default:
+			// %% and unknown conversions
+			putChars( &out, f, 1 );
+			break;
+		}
+	}
+
+	if (nSize) *out.p = L'\0';
+	return out.nLength;
+}
+
+
+CRT_FUNCTION int crtVsnwprintf_s( wchar_t* pBuffer, size_t nSizeOfBuffer, size_t nCount,
+	const wchar_t* pwszFormat, va_list args ) __asm__( CRT_SYMBOL( "_vsnwprintf_s" ) );
+CRT_FUNCTION int crtVsnwprintf_s( wchar_t* pBuffer, size_t nSizeOfBuffer, size_t nCount,
+	const wchar_t* pwszFormat, va_list args )
+{
+	if (! pBuffer || ! nSizeOfBuffer) return -1;
+
+	// At most nCount characters, unless nCount is _TRUNCATE
+	size_t nSize = (nCount < nSizeOfBuffer) ? nCount + 1 : nSizeOfBuffer;
+	size_t nLength = formatString( pBuffer, nSize, pwszFormat, args );
+	return (nLength < nSize) ? (int) nLength : -1;
+}
+CRT_IMPORT( "_vsnwprintf_s", crtVsnwprintf_s );
+
+
+CRT_FUNCTION int crtVscwprintf( const wchar_t* pwszFormat, va_list args )
+	__asm__( CRT_SYMBOL( "_vscwprintf" ) );
+CRT_FUNCTION int crtVscwprintf( const wchar_t* pwszFormat, va_list args )
+{
+	return (int) formatString( NULL, 0, pwszFormat, args );
+}
+CRT_IMPORT( "_vscwprintf", crtVscwprintf );
@@ -15,6 +15,9 @@
 // Show an informational message.
 BOOL showInfo( const wchar_t* pwszString );
 
+// Show a formatted informational message with variable arguments.
+BOOL showFmtInfo( const wchar_t* pwszFormat, ... );
+
 // Show an error message.
 void showError( const wchar_t* pwszMessage, DWORD dwCode, int iPosition );
 
@@ -24,5 +27,16 @@ void showFmtError( DWORD dwCode, int iPosition, const wchar_t* pwszFormat, ... )
 // Show a formatted debug message with variable arguments.
 void showFmtDebug( const wchar_t* pwszFormat, ... );
 
+// Write the informational and debug messages to the standard error, so that
+// the standard output only carries the data of the program (console only).
+void setMessageOutputToError( void );
+
+// Enable or disable the verbose messages.
+void setVerboseOutput( BOOL bVerbose );
+
+// Show a formatted debug message with variable arguments,
+// only if the verbose messages are enabled.
+void showFmtVerbose( const wchar_t* pwszFormat, ... );
+
 // Set the output title.
 void setOutputTitle( const wchar_t* pwszString );
@@ -7,57 +7,160 @@
 
 	Display functions (console version)
 
+	Messages are formatted once, in a stack buffer (a heap buffer is only used
+	for messages longer than OUTPUT_BUFFER_LENGTH), and written with a single
+	call: WriteConsoleW on a console, or WriteFile after a conversion to the
+	console output code page when the stream is redirected (one call per
+	message, up to OUTPUT_BUFFER_LENGTH characters).
+
 */
 
 #include <stdarg.h>
-#include <stdio.h>
+#include <string.h>
 #include <windows.h>
 
 #include "utils.h"  // Utility functions
 
+// Length of the stack buffers of the messages (characters)
+#define OUTPUT_BUFFER_LENGTH 512
+
+// Bytes per UTF-16 code unit in the worst code page (GB18030)
+#define OUTPUT_MAX_CHAR_SIZE 4
+
+// Standard output stream
+typedef struct {
+	DWORD nStdHandle;
+	BOOL bInitialized;
+	HANDLE hStream;
+	BOOL bConsole;  // Attached to a console (otherwise redirected)
+} OutputStream;
+
+static OutputStream outputStream = { STD_OUTPUT_HANDLE };
+static OutputStream errorStream = { STD_ERROR_HANDLE };
+
+// Stream of the informational and debug messages
+static OutputStream* pMessageStream = &outputStream;
+
+static BOOL bVerboseOutput = FALSE;
+
 //
-// Print a string to a stream using the current console output code page.
+// Write a string to a stream.
 //
-static BOOL printConsoleStream( FILE* stream, const wchar_t* pwszString )
+static BOOL writeOutput( OutputStream* pStream, const wchar_t* pString, size_t nLength )
 {
-	BOOL bSuccess = FALSE;
+	if (! pStream->bInitialized) {
+		pStream->hStream = GetStdHandle( pStream->nStdHandle );
+		DWORD dwMode;
+		pStream->bConsole = GetConsoleMode( pStream->hStream, &dwMode );
+		pStream->bInitialized = TRUE;
+	}
+	if (! pStream->hStream || pStream->hStream == INVALID_HANDLE_VALUE) return FALSE;
+
+	if (pStream->bConsole) {
+		// The console displays UTF-16 directly
+		DWORD dwWritten;
+		return WriteConsoleW( pStream->hStream, pString, (DWORD) nLength, &dwWritten, NULL );
+	}
 
-	// Convert the string (wide chars) to console output code page (bytes)
+	// Redirected stream: convert the string (wide chars) to the console output
+	// code page (bytes) in a buffer, with CR LF line ends as in text mode, and
+	// write the buffer when it is full and at the end of the string.
+	char aBuffer[ OUTPUT_BUFFER_LENGTH * OUTPUT_MAX_CHAR_SIZE ];
+	size_t nUsed = 0;
 	UINT nCodePage = GetConsoleOutputCP();
-	int nSize = WideCharToMultiByte( nCodePage, 0, pwszString, -1, NULL, 0, NULL, NULL );
-	if (nSize > 0) {
-		char* pBuffer = allocHeap( 0, nSize );
-		if (WideCharToMultiByte( nCodePage, 0, pwszString, -1, pBuffer, nSize,
-			NULL, NULL ) > 0) {
-			// Write to the console stream
-			bSuccess = fputs( pBuffer, stream ) >= 0;
+	DWORD dwWritten;
+	while (nLength) {
+		// Next part of the string: up to a line feed, as much as the buffer can hold
+		size_t nMax = (sizeof( aBuffer ) - nUsed - 2) / OUTPUT_MAX_CHAR_SIZE;
+		if (nMax < 2) {
+			if (! WriteFile( pStream->hStream, aBuffer, (DWORD) nUsed, &dwWritten, NULL ))
+				return FALSE;
+			nUsed = 0;
+			continue;
 		}
-		freeHeap( pBuffer );
-	}
+		size_t nChunk = 0;
+		while (nChunk < nLength && nChunk < nMax && pString[ nChunk ] != L'\n') nChunk++;
+		// Do not split a surrogate pair
+		if (nChunk == nMax && nChunk < nLength && IS_HIGH_SURROGATE( pString[ nChunk - 1 ] ))
+			nChunk--;
 
-	return bSuccess;
+		if (nChunk) {
+			int nSize = WideCharToMultiByte( nCodePage, 0, pString, (int) nChunk,
+				aBuffer + nUsed, (int) (sizeof( aBuffer ) - nUsed), NULL, NULL );
+			if (nSize <= 0) return FALSE;
+			nUsed += nSize;
+		}
+		if (nChunk < nLength && pString[ nChunk ] == L'\n') {
+			aBuffer[ nUsed++ ] = '\r';
+			aBuffer[ nUsed++ ] = '\n';
+			nChunk++;
+		}
+
+		pString += nChunk;
+		nLength -= nChunk;
+	}
+	if (nUsed && ! WriteFile( pStream->hStream, aBuffer, (DWORD) nUsed, &dwWritten, NULL ))
+		return FALSE;
+	return TRUE;
 }
 
 
 //
-// Print a formatted string with variable arguments to a stream
-// using the current console output code page.
+// Write a formatted message with a list of variable arguments to a stream,
+// between a prefix and a suffix.
 //
-static BOOL printFmtConsoleStream( FILE* stream, const wchar_t* pwszFormat, ... )
+static BOOL v_writeFmtOutput( OutputStream* pStream, const wchar_t* pwszPrefix,
+	const wchar_t* pwszSuffix, const wchar_t* pwszFormat, va_list arg_list )
 {
-	va_list args;
-	va_start( args, pwszFormat );
+	wchar_t awcBuffer[ OUTPUT_BUFFER_LENGTH ];
+	wchar_t* pBuffer = awcBuffer;
+	size_t nSize = OUTPUT_BUFFER_LENGTH;
+	size_t nPrefixLength = wcslen( pwszPrefix );
+	size_t nSuffixLength = wcslen( pwszSuffix );
 	BOOL bSuccess = FALSE;
 
-	// Allocate a buffer and write the formatted string to it
-	wchar_t* pBuffer = v_printFmtString( pwszFormat, args );
-	if (pBuffer) {
-		// Print the buffer to the stream using the current console output code page
-		bSuccess = printConsoleStream( stream, pBuffer );
+	for (;;) {
+		va_list args;
+		va_copy( args, arg_list );
+		int nLen = _vsnwprintf_s( pBuffer + nPrefixLength,
+			nSize - nPrefixLength - nSuffixLength, _TRUNCATE, pwszFormat, args );
+		va_end( args );
 
-		freeHeap( pBuffer );
+		if (nLen >= 0) {
+			memcpy( pBuffer, pwszPrefix, nPrefixLength * sizeof( wchar_t ) );
+			memcpy( pBuffer + nPrefixLength + nLen, pwszSuffix,
+				nSuffixLength * sizeof( wchar_t ) );
+			bSuccess = writeOutput( pStream, pBuffer,
+				nPrefixLength + nLen + nSuffixLength );
+			break;
+		}
+		if (pBuffer != awcBuffer) break;
+
+		// The message does not fit in the stack buffer: measure it and
+		// format it again in a heap buffer.
+		va_copy( args, arg_list );
+		nLen = _vscwprintf( pwszFormat, args );
+		va_end( args );
+		if (nLen < 0) break;
+		nSize = nPrefixLength + nLen + nSuffixLength + 1;
+		pBuffer = allocHeap( 0, nSize * sizeof( wchar_t ) );
 	}
 
+	if (pBuffer != awcBuffer) freeHeap( pBuffer );
+	return bSuccess;
+}
+
+
+//
+// Write a formatted message with variable arguments to a stream,
+// between a prefix and a suffix.
+//
+static BOOL writeFmtOutput( OutputStream* pStream, const wchar_t* pwszPrefix,
+	const wchar_t* pwszSuffix, const wchar_t* pwszFormat, ... )
+{
+	va_list args;
+	va_start( args, pwszFormat );
+	BOOL bSuccess = v_writeFmtOutput( pStream, pwszPrefix, pwszSuffix, pwszFormat, args );
 	va_end( args );
 	return bSuccess;
 }
@@ -68,7 +171,55 @@ static BOOL printFmtConsoleStream( FILE* stream, const wchar_t* pwszFormat, ...
 //
 BOOL showInfo( const wchar_t* pwszString )
 {
-	return printConsoleStream( stdout, pwszString );
+	return writeOutput( pMessageStream, pwszString, wcslen( pwszString ) );
+}
+
+
+//
+// Show a formatted informational message with variable arguments.
+//
+BOOL showFmtInfo( const wchar_t* pwszFormat, ... )
+{
+	va_list args;
+	va_start( args, pwszFormat );
+	BOOL bSuccess = v_writeFmtOutput( pMessageStream, L"", L"", pwszFormat, args );
+	va_end( args );
+	return bSuccess;
+}
+
+
+//
+// Write the end of an error message: " (code: 0x%08lX, pos: %d)\n",
+// without the code/position part if they are 0. The buffer must hold
+// 40 characters.
+//
+static void getErrorSuffix( DWORD dwCode, int iPosition, wchar_t* pBuffer )
+{
+	static const wchar_t awcHex[] = L"0123456789ABCDEF";
+	wchar_t* p = pBuffer;
+
+	if (dwCode) {
+		memcpy( p, L" (code: 0x", 10 * sizeof( wchar_t ) );
+		p += 10;
+		for (int iShift = 28; iShift >= 0; iShift -= 4) *p++ = awcHex[ (dwCode >> iShift) & 0xF ];
+
+		if (iPosition) {
+			memcpy( p, L", pos: ", 7 * sizeof( wchar_t ) );
+			p += 7;
+			unsigned int n = (unsigned int) iPosition;
+			if (iPosition < 0) {
+				*p++ = L'-';
+				n = 0 - n;
+			}
+			wchar_t awcDigits[ 10 ];
+			int nDigits = 0;
+			do awcDigits[ nDigits++ ] = L'0' + n % 10; while (n /= 10);
+			while (nDigits) *p++ = awcDigits[ --nDigits ];
+		}
+		*p++ = L')';
+	}
+	*p++ = L'\n';
+	*p = L'\0';
 }
 
 
@@ -77,22 +228,9 @@ BOOL showInfo( const wchar_t* pwszString )
 //
 void showError( const wchar_t* pwszMessage, DWORD dwCode, int iPosition )
 {
-	wchar_t pwszFormat[] = L"[E] %ls (code: 0x%08lX, pos: %d)\n";
-	wchar_t* pEnd = NULL;
-	if (dwCode == 0) {
-		// Remove the error code/position part from the format
-		pEnd = pwszFormat + 7;
-	}
-	else if (iPosition == 0) {
-		// Remove the error position part from the format
-		pEnd = pwszFormat + 22;
-		*pEnd++ = L')';
-	}
-	if (pEnd) {
-		*pEnd++ = L'\n';
-		*pEnd = L'\0';
-	}
-	printFmtConsoleStream( stderr, pwszFormat, pwszMessage, dwCode, iPosition );
+	wchar_t awcSuffix[ 40 ];
+	getErrorSuffix( dwCode, iPosition, awcSuffix );
+	writeFmtOutput( &errorStream, L"[E] ", awcSuffix, L"%ls", pwszMessage );
 }
 
 
@@ -101,18 +239,12 @@ void showError( const wchar_t* pwszMessage, DWORD dwCode, int iPosition )
 //
 void showFmtError( DWORD dwCode, int iPosition, const wchar_t* pwszFormat, ... )
 {
+	wchar_t awcSuffix[ 40 ];
+	getErrorSuffix( dwCode, iPosition, awcSuffix );
+
 	va_list args;
 	va_start( args, pwszFormat );
-
-	// Allocate a buffer and write the formatted error message to it
-	wchar_t* pBuffer = v_printFmtString( pwszFormat, args );
-	if (pBuffer) {
-		// Show the error message
-		showError( pBuffer, dwCode, iPosition );
-
-		freeHeap( pBuffer );
-	}
-
+	v_writeFmtOutput( &errorStream, L"[E] ", awcSuffix, pwszFormat, args );
 	va_end( args );
 }
 
@@ -124,15 +256,39 @@ void showFmtDebug( const wchar_t* pwszFormat, ... )
 {
 	va_list args;
 	va_start( args, pwszFormat );
+	v_writeFmtOutput( pMessageStream, L"[D] ", L"\n", pwszFormat, args );
+	va_end( args );
+}
 
-	// Allocate a buffer and write the formatted message to it
-	wchar_t* pBuffer = v_printFmtString( pwszFormat, args );
-	if (pBuffer) {
-		// Print the debug message to standard output
-		printFmtConsoleStream( stdout, L"[D] %ls\n", pBuffer );
 
-		freeHeap( pBuffer );
-	}
+//
+// Write the informational and debug messages to the standard error.
+//
+void setMessageOutputToError( void )
+{
+	pMessageStream = &errorStream;
+}
+
 
+//
+// Enable or disable the verbose messages.
+//
+void setVerboseOutput( BOOL bVerbose )
+{
+	bVerboseOutput = bVerbose;
+}
+
+
+//
+// Show a formatted debug message with variable arguments,
+// only if the verbose messages are enabled.
+//
+void showFmtVerbose( const wchar_t* pwszFormat, ... )
+{
+	if (! bVerboseOutput) return;
+
+	va_list args;
+	va_start( args, pwszFormat );
+	v_writeFmtOutput( pMessageStream, L"[D] ", L"\n", pwszFormat, args );
 	va_end( args );
 }
@@ -75,6 +75,28 @@ BOOL showInfo( const wchar_t* pwszString )
 }
 
 
+//
+// Show a formatted informational message with variable arguments.
+//
+BOOL showFmtInfo( const wchar_t* pwszFormat, ... )
+{
+	va_list args;
+	va_start( args, pwszFormat );
+	BOOL bSuccess = FALSE;
+
+	// Allocate a buffer and write the formatted message to it
+	wchar_t* pBuffer = v_printFmtString( pwszFormat, args );
+	if (pBuffer) {
+		bSuccess = showInfo( pBuffer );
+
+		freeHeap( pBuffer );
+	}
+
+	va_end( args );
+	return bSuccess;
+}
+
+
 //
 // Show an error message.
 //
@@ -119,3 +141,22 @@ void showFmtError( DWORD dwCode, int iPosition, const wchar_t* pwszFormat, ... )
 
 	va_end( args );
 }
+
+
+//
+// Enable or disable the verbose messages.
+//
+// Verbose messages are not supported in the windows version.
+//
+void setVerboseOutput( BOOL bVerbose )
+{
+}
+
+
+//
+// Show a formatted debug message with variable arguments,
+// only if the verbose messages are enabled.
+//
+void showFmtVerbose( const wchar_t* pwszFormat, ... )
+{
+}
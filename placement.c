@@ -0,0 +1,182 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	placement.c
+
+	Placement of the child process: processor group, affinity mask and
+	preferred NUMA node
+
+	They are given to CreateProcess as process attributes (Windows 7 and
+	later): the functions of the processor groups are resolved when needed,
+	as the program runs on Windows Vista and later.
+
+*/
+
+#include "placement.h"
+
+#include <wchar.h>
+#include <windows.h>
+
+// Process attributes (not in the headers for Windows Vista)
+#ifndef PROC_THREAD_ATTRIBUTE_GROUP_AFFINITY
+#define PROC_THREAD_ATTRIBUTE_GROUP_AFFINITY 0x00030003
+#endif
+#ifndef PROC_THREAD_ATTRIBUTE_PREFERRED_NODE
+#define PROC_THREAD_ATTRIBUTE_PREFERRED_NODE 0x00020004
+#endif
+
+typedef WORD (WINAPI* GetActiveProcessorGroupCountFunc)( void );
+typedef DWORD (WINAPI* GetActiveProcessorCountFunc)( WORD );
+typedef BOOL (WINAPI* GetNumaNodeProcessorMaskExFunc)( USHORT, PGROUP_AFFINITY );
+
+
+//
+// Parse the number of an item ("<name>=<number>", decimal or hexadecimal
+// digits only, with an optional "0x" prefix). The number must end the item.
+// Returns FALSE if it is invalid.
+//
+static BOOL parseItemNumber( const wchar_t* pItem, size_t nLength, size_t nNameLength,
+	unsigned base, unsigned long long nMax, unsigned long long* pValue )
+{
+	const wchar_t* p = pItem + nNameLength + 1;
+	const wchar_t* pEnd = pItem + nLength;
+	if (base == 16 && pEnd - p > 2 && p[ 0 ] == L'0' && (p[ 1 ] | 0x20) == L'x') p += 2;
+	if (p == pEnd) return FALSE;
+
+	unsigned long long value = 0;
+	for (; p < pEnd; p++) {
+		wchar_t c = *p | 0x20;  // Lower case letter
+		unsigned nDigit = (*p >= L'0' && *p <= L'9') ? (unsigned) (*p - L'0') :
+			(c >= L'a' && c <= L'f') ? (unsigned) (c - L'a' + 10) : base;
+		if (nDigit >= base || value > (nMax - nDigit) / base) return FALSE;
+		value = value * base + nDigit;
+	}
+	*pValue = value;
+	return TRUE;
+}
+
+
+//
+// Parse placement settings.
+//
+BOOL parsePlacementSettings( const wchar_t* pwszValue, PlacementSettings* pSettings )
+{
+	PlacementSettings settings = *pSettings;
+	const wchar_t* p = pwszValue;
+
+	do {
+		const wchar_t* pItem = p;
+		while (*p && *p != L',') p++;
+		size_t nLength = p - pItem;
+
+		unsigned long long value;
+		if (nLength > 6 && ! _wcsnicmp( pItem, L"group=", 6 )) {
+			if (! parseItemNumber( pItem, nLength, 5, 10, 0xFFFF, &value )) return FALSE;
+			settings.affinity.Group = (WORD) value;
+			settings.bAffinity = TRUE;
+		}
+		else if (nLength > 5 && ! _wcsnicmp( pItem, L"mask=", 5 )) {
+			if (! parseItemNumber( pItem, nLength, 4, 16, (KAFFINITY) -1, &value ) ||
+				! value) return FALSE;
+			settings.affinity.Mask = (KAFFINITY) value;
+			settings.bAffinity = TRUE;
+		}
+		else if (nLength > 5 && ! _wcsnicmp( pItem, L"node=", 5 )) {
+			if (! parseItemNumber( pItem, nLength, 4, 10, 0xFFFF, &value )) return FALSE;
+			settings.nNode = (USHORT) value;
+			settings.bNode = TRUE;
+		}
+		else return FALSE;
+	} while (*p++);
+
+	*pSettings = settings;
+	return TRUE;
+}
+
+
+//
+// Check and complete placement settings.
+//
+BOOL resolvePlacementSettings( PlacementSettings* pSettings )
+{
+	HMODULE hKernel32 = GetModuleHandle( L"kernel32.dll" );
+	GetActiveProcessorGroupCountFunc fnGetActiveProcessorGroupCount =
+		(GetActiveProcessorGroupCountFunc) GetProcAddress( hKernel32,
+		"GetActiveProcessorGroupCount" );
+	GetActiveProcessorCountFunc fnGetActiveProcessorCount =
+		(GetActiveProcessorCountFunc) GetProcAddress( hKernel32, "GetActiveProcessorCount" );
+	GetNumaNodeProcessorMaskExFunc fnGetNumaNodeProcessorMaskEx =
+		(GetNumaNodeProcessorMaskExFunc) GetProcAddress( hKernel32,
+		"GetNumaNodeProcessorMaskEx" );
+	if (! fnGetActiveProcessorGroupCount || ! fnGetActiveProcessorCount ||
+		! fnGetNumaNodeProcessorMaskEx) {
+		SetLastError( ERROR_NOT_SUPPORTED );
+		return FALSE;
+	}
+
+	if (pSettings->bNode) {
+		ULONG nHighestNode = 0;
+		GROUP_AFFINITY nodeAffinity = {0};
+		if (! GetNumaHighestNodeNumber( &nHighestNode ) ||
+			pSettings->nNode > nHighestNode ||
+			! fnGetNumaNodeProcessorMaskEx( pSettings->nNode, &nodeAffinity ) ||
+			! nodeAffinity.Mask) {
+			SetLastError( ERROR_INVALID_PARAMETER );
+			return FALSE;
+		}
+		// Without a group, run on the processors of the node
+		if (! pSettings->bAffinity) {
+			pSettings->affinity = nodeAffinity;
+			pSettings->bAffinity = TRUE;
+		}
+	}
+
+	if (pSettings->bAffinity) {
+		if (pSettings->affinity.Group >= fnGetActiveProcessorGroupCount()) {
+			SetLastError( ERROR_INVALID_PARAMETER );
+			return FALSE;
+		}
+		// The active processors of a group are numbered from 0
+		DWORD nProcessors = fnGetActiveProcessorCount( pSettings->affinity.Group );
+		KAFFINITY groupMask = nProcessors >= sizeof( KAFFINITY ) * 8 ? (KAFFINITY) -1 :
+			((KAFFINITY) 1 << nProcessors) - 1;
+		if (! pSettings->affinity.Mask) pSettings->affinity.Mask = groupMask;
+		else if (pSettings->affinity.Mask & ~groupMask) {
+			SetLastError( ERROR_INVALID_PARAMETER );
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+//
+// Get the number of process attributes of placement settings.
+//
+DWORD getPlacementAttributeCount( const PlacementSettings* pSettings )
+{
+	return (pSettings->bAffinity ? 1 : 0) + (pSettings->bNode ? 1 : 0);
+}
+
+
+//
+// Add the process attributes of placement settings to an attribute list.
+//
+BOOL addPlacementAttributes( LPPROC_THREAD_ATTRIBUTE_LIST pAttributeList,
+	PlacementSettings* pSettings )
+{
+	if (pSettings->bAffinity && ! UpdateProcThreadAttribute( pAttributeList, 0,
+		PROC_THREAD_ATTRIBUTE_GROUP_AFFINITY, &pSettings->affinity,
+		sizeof( pSettings->affinity ), NULL, NULL ))
+		return FALSE;
+
+	if (pSettings->bNode && ! UpdateProcThreadAttribute( pAttributeList, 0,
+		PROC_THREAD_ATTRIBUTE_PREFERRED_NODE, &pSettings->nNode,
+		sizeof( pSettings->nNode ), NULL, NULL ))
+		return FALSE;
+
+	return TRUE;
+}
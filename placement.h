@@ -0,0 +1,40 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	placement.h
+
+	Placement of the child process: processor group, affinity mask and
+	preferred NUMA node
+
+*/
+
+#include <windows.h>
+
+// Placement settings (all zero: the scheduler places the process)
+typedef struct {
+	BOOL bAffinity;           // Whether to set the processor group affinity
+	GROUP_AFFINITY affinity;  // Processor group and affinity mask (0: all processors)
+	BOOL bNode;               // Whether to set the preferred NUMA node
+	USHORT nNode;             // Preferred NUMA node
+} PlacementSettings;
+
+// Parse placement settings: a comma-separated list of "group=<n>",
+// "mask=<hex>" and "node=<n>". Returns FALSE if the settings are invalid.
+BOOL parsePlacementSettings( const wchar_t* pwszValue, PlacementSettings* pSettings );
+
+// Check the settings against the processors of the computer, and complete
+// them: all the processors of the group without a mask, those of the NUMA
+// node without a group. Requires Windows 7 or later.
+// Returns FALSE (the last error is set) if they do not match.
+BOOL resolvePlacementSettings( PlacementSettings* pSettings );
+
+// Number of process attributes of the settings (0 to 2)
+DWORD getPlacementAttributeCount( const PlacementSettings* pSettings );
+
+// Add the process attributes of the settings to an attribute list. The
+// settings must remain valid until the process is created.
+BOOL addPlacementAttributes( LPPROC_THREAD_ATTRIBUTE_LIST pAttributeList,
+	PlacementSettings* pSettings );
@@ -0,0 +1,196 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	privileges.c
+
+	Privilege table and privilege sets
+
+	The well-known privileges have fixed LUID values, so they never need to be
+	looked up with LookupPrivilegeValue.
+
+*/
+
+#include "privileges.h"
+
+#include <wchar.h>
+#include <windows.h>
+#ifdef __GNUC__
+#include "winnt2.h"
+#endif
+
+static const struct {
+	const wchar_t* pwszName;
+	LONG lValue;  // LUID low part (the high part is always 0), 0 if unknown
+} aPrivileges[ PRIVILEGE_COUNT ] = {
+	{ SE_ASSIGNPRIMARYTOKEN_NAME, SE_ASSIGNPRIMARYTOKEN_PRIVILEGE },
+	{ SE_AUDIT_NAME, SE_AUDIT_PRIVILEGE },
+	{ SE_BACKUP_NAME, SE_BACKUP_PRIVILEGE },
+	{ SE_CHANGE_NOTIFY_NAME, SE_CHANGE_NOTIFY_PRIVILEGE },
+	{ SE_CREATE_GLOBAL_NAME, SE_CREATE_GLOBAL_PRIVILEGE },
+	{ SE_CREATE_PAGEFILE_NAME, SE_CREATE_PAGEFILE_PRIVILEGE },
+	{ SE_CREATE_PERMANENT_NAME, SE_CREATE_PERMANENT_PRIVILEGE },
+	{ SE_CREATE_SYMBOLIC_LINK_NAME, SE_CREATE_SYMBOLIC_LINK_PRIVILEGE },
+	{ SE_CREATE_TOKEN_NAME, SE_CREATE_TOKEN_PRIVILEGE }, // Most users won't have that.
+	{ SE_DEBUG_NAME, SE_DEBUG_PRIVILEGE },
+	{ SE_DELEGATE_SESSION_USER_IMPERSONATE_NAME,
+		SE_DELEGATE_SESSION_USER_IMPERSONATE_PRIVILEGE },
+	{ SE_ENABLE_DELEGATION_NAME, SE_ENABLE_DELEGATION_PRIVILEGE }, // Most users won't have that.
+	{ SE_IMPERSONATE_NAME, SE_IMPERSONATE_PRIVILEGE },
+	{ SE_INC_BASE_PRIORITY_NAME, SE_INC_BASE_PRIORITY_PRIVILEGE },
+	{ SE_INC_WORKING_SET_NAME, SE_INC_WORKING_SET_PRIVILEGE },
+	{ SE_INCREASE_QUOTA_NAME, SE_INCREASE_QUOTA_PRIVILEGE },
+	{ SE_LOAD_DRIVER_NAME, SE_LOAD_DRIVER_PRIVILEGE },
+	{ SE_LOCK_MEMORY_NAME, SE_LOCK_MEMORY_PRIVILEGE },
+	{ SE_MACHINE_ACCOUNT_NAME, SE_MACHINE_ACCOUNT_PRIVILEGE }, // Most users won't have that.
+	{ SE_MANAGE_VOLUME_NAME, SE_MANAGE_VOLUME_PRIVILEGE },
+	{ SE_PROF_SINGLE_PROCESS_NAME, SE_PROF_SINGLE_PROCESS_PRIVILEGE },
+	{ SE_RELABEL_NAME, SE_RELABEL_PRIVILEGE }, // Most users won't have that.
+	{ SE_REMOTE_SHUTDOWN_NAME, SE_REMOTE_SHUTDOWN_PRIVILEGE }, // Most users won't have that.
+	{ SE_RESTORE_NAME, SE_RESTORE_PRIVILEGE },
+	{ SE_SECURITY_NAME, SE_SECURITY_PRIVILEGE },
+	{ SE_SHUTDOWN_NAME, SE_SHUTDOWN_PRIVILEGE },
+	{ SE_SYNC_AGENT_NAME, SE_SYNC_AGENT_PRIVILEGE }, // Most users won't have that.
+	{ SE_SYSTEM_ENVIRONMENT_NAME, SE_SYSTEM_ENVIRONMENT_PRIVILEGE },
+	{ SE_SYSTEM_PROFILE_NAME, SE_SYSTEM_PROFILE_PRIVILEGE },
+	{ SE_SYSTEMTIME_NAME, SE_SYSTEMTIME_PRIVILEGE },
+	{ SE_TAKE_OWNERSHIP_NAME, SE_TAKE_OWNERSHIP_PRIVILEGE },
+	{ SE_TCB_NAME, SE_TCB_PRIVILEGE },
+	{ SE_TIME_ZONE_NAME, SE_TIME_ZONE_PRIVILEGE },
+	{ SE_TRUSTED_CREDMAN_ACCESS_NAME, SE_TRUSTED_CREDMAN_ACCESS_PRIVILEGE }, // Most users won't have that.
+	{ SE_UNDOCK_NAME, SE_UNDOCK_PRIVILEGE },
+	{ SE_UNSOLICITED_INPUT_NAME, 0 } // Obsolete, not known by the system.
+};
+
+#define PRIVILEGE_VALUE_MAX SE_DELEGATE_SESSION_USER_IMPERSONATE_PRIVILEGE
+
+// Index of each privilege in the table, by LUID value
+static const signed char aPrivilegeIndex[ PRIVILEGE_VALUE_MAX + 1 ] = {
+	-1, -1, 8, 0, 17, 15, 18, 31, 24, 30, 16, 28, 29, 20, 13, 5, 6, 2, 23, 25,
+	9, 1, 27, 3, 22, 34, 26, 11, 19, 12, 4, 33, 21, 14, 32, 7, 10
+};
+
+// Named privilege profiles
+static const struct {
+	const wchar_t* pwszName;
+	PrivilegeMask mask;
+} aProfiles[] = {
+	{ L"all", PRIVILEGE_MASK_ALL },
+	{ L"backup-restore", PRIVILEGE_BIT( PRIVILEGE_BACKUP ) |
+		PRIVILEGE_BIT( PRIVILEGE_CHANGE_NOTIFY ) | PRIVILEGE_BIT( PRIVILEGE_RESTORE ) |
+		PRIVILEGE_BIT( PRIVILEGE_SECURITY ) | PRIVILEGE_BIT( PRIVILEGE_TAKE_OWNERSHIP ) },
+	{ L"debug-only", PRIVILEGE_BIT( PRIVILEGE_DEBUG ) }
+};
+
+
+//
+// Get the name of a privilege from its index in the table.
+//
+const wchar_t* getPrivilegeName( int iIndex )
+{
+	return aPrivileges[ iIndex ].pwszName;
+}
+
+
+//
+// Get the LUID of a privilege from its index in the table.
+//
+LUID getPrivilegeLuid( int iIndex )
+{
+	LUID luid = { .LowPart = aPrivileges[ iIndex ].lValue, .HighPart = 0 };
+	return luid;
+}
+
+
+//
+// Get the table index of a privilege from its LUID value.
+// Returns -1 if the privilege is not in the table.
+//
+int findPrivilegeByValue( LONG lValue )
+{
+	if (lValue < 0 || lValue > PRIVILEGE_VALUE_MAX) return -1;
+	return aPrivilegeIndex[ lValue ];
+}
+
+
+//
+// Get the table index of a privilege from its name.
+//
+// The name is compared case-insensitively, with or without the "Se" prefix
+// and "Privilege" suffix (e.g. "SeDebugPrivilege" or "debug").
+// Returns -1 if the privilege is not in the table.
+//
+int findPrivilegeByName( const wchar_t* pwszName, size_t nLength )
+{
+	for (int i = 0; i < PRIVILEGE_COUNT; i++) {
+		const wchar_t* pwszEntry = aPrivileges[ i ].pwszName;
+		size_t nEntryLength = wcslen( pwszEntry );
+		if (nLength == nEntryLength && ! _wcsnicmp( pwszName, pwszEntry, nLength ))
+			return i;
+		// Short name: without "Se" and "Privilege"
+		if (nLength == nEntryLength - 11 && ! _wcsnicmp( pwszName, pwszEntry + 2, nLength ))
+			return i;
+	}
+	return -1;
+}
+
+
+//
+// Parse a privilege profile and convert it to a set of privileges.
+//
+// The profile is a comma-separated list of profile names ("all",
+// "backup-restore", "debug-only") and/or privilege names.
+// Returns FALSE if the profile is invalid.
+//
+BOOL parsePrivilegeProfile( const wchar_t* pwszProfile, PrivilegeMask* pMask )
+{
+	PrivilegeMask mask = 0;
+	const wchar_t* p = pwszProfile;
+
+	do {
+		const wchar_t* pItem = p;
+		while (*p && *p != L',') p++;
+		size_t nLength = p - pItem;
+		if (nLength == 0) return FALSE;
+
+		BOOL bFound = FALSE;
+		for (int i = 0; i < sizeof( aProfiles ) / sizeof( *aProfiles ); i++) {
+			if (wcslen( aProfiles[ i ].pwszName ) == nLength &&
+				! _wcsnicmp( pItem, aProfiles[ i ].pwszName, nLength )) {
+				mask |= aProfiles[ i ].mask;
+				bFound = TRUE;
+				break;
+			}
+		}
+		if (! bFound) {
+			int iIndex = findPrivilegeByName( pItem, nLength );
+			if (iIndex < 0) return FALSE;
+			mask |= PRIVILEGE_BIT( iIndex );
+		}
+	} while (*p++);
+
+	*pMask = mask;
+	return TRUE;
+}
+
+
+//
+// Fill an array with the LUIDs of a set of privileges, marked as enabled.
+//
+// The array must have room for PRIVILEGE_COUNT entries. Privileges not known
+// by the system are skipped.
+// Returns the number of entries filled.
+//
+DWORD buildPrivilegeArray( PrivilegeMask privileges, LUID_AND_ATTRIBUTES* pPrivileges )
+{
+	DWORD dwCount = 0;
+	for (int i = 0; i < PRIVILEGE_COUNT; i++) {
+		if ((privileges & PRIVILEGE_BIT( i )) && aPrivileges[ i ].lValue) {
+			pPrivileges[ dwCount ].Luid = getPrivilegeLuid( i );
+			pPrivileges[ dwCount ].Attributes = SE_PRIVILEGE_ENABLED;
+			dwCount++;
+		}
+	}
+	return dwCount;
+}
@@ -0,0 +1,58 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	privileges.h
+
+	Privilege table and privilege sets
+
+*/
+
+#include <windows.h>
+
+// Set of privileges: one bit per entry of the privilege table
+typedef ULONGLONG PrivilegeMask;
+
+// Number of entries in the privilege table
+#define PRIVILEGE_COUNT 36
+
+// Set containing only the privilege at the specified table index
+#define PRIVILEGE_BIT(i) (((PrivilegeMask) 1) << (i))
+
+// All the privileges of the table
+#define PRIVILEGE_MASK_ALL (PRIVILEGE_BIT( PRIVILEGE_COUNT ) - 1)
+
+// Table index of some privileges
+enum {
+	PRIVILEGE_ASSIGNPRIMARYTOKEN = 0,
+	PRIVILEGE_BACKUP = 2,
+	PRIVILEGE_CHANGE_NOTIFY = 3,
+	PRIVILEGE_DEBUG = 9,
+	PRIVILEGE_RESTORE = 23,
+	PRIVILEGE_SECURITY = 24,
+	PRIVILEGE_TAKE_OWNERSHIP = 30
+};
+
+// Get the name of a privilege from its index in the table.
+const wchar_t* getPrivilegeName( int iIndex );
+
+// Get the LUID of a privilege from its index in the table.
+LUID getPrivilegeLuid( int iIndex );
+
+// Get the table index of a privilege from its LUID value.
+// Returns -1 if the privilege is not in the table.
+int findPrivilegeByValue( LONG lValue );
+
+// Get the table index of a privilege from its name.
+// Returns -1 if the privilege is not in the table.
+int findPrivilegeByName( const wchar_t* pwszName, size_t nLength );
+
+// Parse a privilege profile and convert it to a set of privileges.
+// Returns FALSE if the profile is invalid.
+BOOL parsePrivilegeProfile( const wchar_t* pwszProfile, PrivilegeMask* pMask );
+
+// Fill an array of PRIVILEGE_COUNT entries with the LUIDs of a set of
+// privileges, marked as enabled. Returns the number of entries filled.
+DWORD buildPrivilegeArray( PrivilegeMask privileges, LUID_AND_ATTRIBUTES* pPrivileges );
@@ -0,0 +1,287 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	relay.c
+
+	Output relay
+
+	Each stream has its own pipe, so that the standard output and error stay
+	separate. The pipes are read with overlapped I/O into large buffers, two
+	per stream: the next read is issued before the data just read is written
+	to the destination, so that the child process can go on writing while the
+	relay writes.
+
+*/
+
+#include "relay.h"
+
+#include <windows.h>
+
+#include "output.h" // Display functions
+#include "utils.h"  // Utility functions
+
+// Size of the pipe buffers (a hint for the system) and of the relay buffers
+#define RELAY_PIPE_BUFFER_SIZE (1024 * 1024)
+#define RELAY_BUFFER_SIZE (1024 * 1024)
+
+
+//
+// Create the pipe of a stream, and open its destination.
+//
+static BOOL createRelayStream( RelayStream* pStream, int iStream, const wchar_t* pwszFile )
+{
+	static LONG nPipes = 0;
+
+	// Unique pipe name, created by this process only
+	wchar_t* pwszPipeName = printFmtString( L"\\\\.\\pipe\\superUser.relay.%lu.%lu.%ld",
+		GetCurrentProcessId(), GetTickCount(), InterlockedIncrement( &nPipes ) );
+	if (! pwszPipeName) return FALSE;
+
+	pStream->hPipe = CreateNamedPipe( pwszPipeName,
+		PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 0,
+		RELAY_PIPE_BUFFER_SIZE, 0, NULL );
+	if (pStream->hPipe == INVALID_HANDLE_VALUE) {
+		pStream->hPipe = NULL;
+		freeHeap( pwszPipeName );
+		return FALSE;
+	}
+
+	// The write end (synchronous, as an anonymous pipe)
+	pStream->hChildEnd = CreateFile( pwszPipeName, GENERIC_WRITE | FILE_READ_ATTRIBUTES, 0,
+		NULL, OPEN_EXISTING, 0, NULL );
+	freeHeap( pwszPipeName );
+	if (pStream->hChildEnd == INVALID_HANDLE_VALUE) {
+		pStream->hChildEnd = NULL;
+		return FALSE;
+	}
+
+	pStream->overlapped.hEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+	if (! pStream->overlapped.hEvent) return FALSE;
+
+	if (pwszFile) {
+		pStream->hOutput = CreateFile( pwszFile, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+		if (pStream->hOutput == INVALID_HANDLE_VALUE) {
+			pStream->hOutput = NULL;
+			return FALSE;
+		}
+		pStream->bOwnOutput = TRUE;
+	}
+	else {
+		pStream->hOutput = GetStdHandle( iStream == RELAY_STDOUT ? STD_OUTPUT_HANDLE :
+			STD_ERROR_HANDLE );
+		// Without a standard handle, the data is discarded
+		if (! pStream->hOutput || pStream->hOutput == INVALID_HANDLE_VALUE) {
+			pStream->hOutput = NULL;
+			pStream->dwOutputError = ERROR_INVALID_HANDLE;
+		}
+	}
+
+	pStream->apBuffers[ 0 ] = allocHeap( 0, RELAY_BUFFER_SIZE );
+	pStream->apBuffers[ 1 ] = allocHeap( 0, RELAY_BUFFER_SIZE );
+	pStream->bActive = TRUE;
+	return TRUE;
+}
+
+
+BOOL createOutputRelay( OutputRelay* pRelay,
+	const wchar_t* const apwszFiles[ RELAY_STREAM_COUNT ] )
+{
+	ZeroMemory( pRelay, sizeof( OutputRelay ) );
+
+	for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+		if (! createRelayStream( &pRelay->aStreams[ i ], i, apwszFiles[ i ] )) {
+			DWORD dwError = GetLastError();
+			closeOutputRelay( pRelay );
+			SetLastError( dwError );
+			return FALSE;
+		}
+	}
+
+	// The child process reads nothing
+	pRelay->hChildInput = CreateFile( L"NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_EXISTING, 0, NULL );
+	if (pRelay->hChildInput == INVALID_HANDLE_VALUE) {
+		DWORD dwError = GetLastError();
+		pRelay->hChildInput = NULL;
+		closeOutputRelay( pRelay );
+		SetLastError( dwError );
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+BOOL prepareRelayChildHandles( OutputRelay* pRelay, HANDLE hParentProcess )
+{
+	HANDLE ahHandles[ 3 ] = {
+		pRelay->hChildInput,
+		pRelay->aStreams[ RELAY_STDOUT ].hChildEnd,
+		pRelay->aStreams[ RELAY_STDERR ].hChildEnd
+	};
+
+	pRelay->hParentProcess = hParentProcess;
+	for (int i = 0; i < 3; i++) {
+		if (! DuplicateHandle( GetCurrentProcess(), ahHandles[ i ], hParentProcess,
+			&pRelay->ahChildHandles[ i ], 0, TRUE, DUPLICATE_SAME_ACCESS )) {
+			DWORD dwError = GetLastError();
+			pRelay->ahChildHandles[ i ] = NULL;
+			releaseRelayChildHandles( pRelay );
+			SetLastError( dwError );
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+void releaseRelayChildHandles( OutputRelay* pRelay )
+{
+	// Close the duplicates in the parent process
+	for (int i = 0; i < 3; i++) {
+		if (pRelay->ahChildHandles[ i ]) {
+			DuplicateHandle( pRelay->hParentProcess, pRelay->ahChildHandles[ i ], NULL, NULL, 0,
+				FALSE, DUPLICATE_CLOSE_SOURCE );
+			pRelay->ahChildHandles[ i ] = NULL;
+		}
+	}
+
+	for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+		if (pRelay->aStreams[ i ].hChildEnd) {
+			CloseHandle( pRelay->aStreams[ i ].hChildEnd );
+			pRelay->aStreams[ i ].hChildEnd = NULL;
+		}
+	}
+	if (pRelay->hChildInput) {
+		CloseHandle( pRelay->hChildInput );
+		pRelay->hChildInput = NULL;
+	}
+}
+
+
+//
+// Start reading a stream into its current buffer.
+//
+static void startRead( RelayStream* pStream )
+{
+	if (! ReadFile( pStream->hPipe, pStream->apBuffers[ pStream->iBuffer ], RELAY_BUFFER_SIZE,
+		NULL, &pStream->overlapped ) && GetLastError() != ERROR_IO_PENDING) {
+		// ERROR_BROKEN_PIPE: all the write ends are closed
+		pStream->bActive = FALSE;
+	}
+}
+
+
+//
+// Write data read from a stream to its destination.
+//
+static void writeData( RelayStream* pStream, const BYTE* pData, DWORD dwSize )
+{
+	pStream->ullBytes += dwSize;
+
+	while (dwSize && ! pStream->dwOutputError) {
+		DWORD dwWritten = 0;
+		if (! WriteFile( pStream->hOutput, pData, dwSize, &dwWritten, NULL ))
+			pStream->dwOutputError = GetLastError();
+		else if (! dwWritten) pStream->dwOutputError = ERROR_WRITE_FAULT;
+		pData += dwWritten;
+		dwSize -= dwWritten;
+	}
+}
+
+
+BOOL runOutputRelay( OutputRelay* pRelay, HANDLE hStopProcess )
+{
+	for (int i = 0; i < RELAY_STREAM_COUNT; i++) startRead( &pRelay->aStreams[ i ] );
+
+	// Once the stop process has exited, only the reads that complete at once
+	// are relayed
+	BOOL bStopping = FALSE;
+
+	// The streams are scanned from the one after the last relayed, so that a
+	// busy stream cannot delay the other.
+	int iFirst = 0;
+	for (;;) {
+		HANDLE ahEvents[ RELAY_STREAM_COUNT + 1 ];
+		RelayStream* apStreams[ RELAY_STREAM_COUNT ];
+		DWORD nEvents = 0;
+		for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+			RelayStream* pStream = &pRelay->aStreams[ (iFirst + i) % RELAY_STREAM_COUNT ];
+			if (pStream->bActive) {
+				ahEvents[ nEvents ] = pStream->overlapped.hEvent;
+				apStreams[ nEvents++ ] = pStream;
+			}
+		}
+		if (! nEvents) break;
+
+		// The stop process is the last object: the streams come first
+		DWORD nObjects = nEvents;
+		if (hStopProcess && ! bStopping) ahEvents[ nObjects++ ] = hStopProcess;
+		DWORD dwWait = WaitForMultipleObjects( nObjects, ahEvents, FALSE,
+			bStopping ? 0 : INFINITE );
+		if (dwWait == WAIT_TIMEOUT) {
+			showFmtVerbose( L"The child process exited, its output is no longer relayed" );
+			break;
+		}
+		if (nObjects > nEvents && dwWait == WAIT_OBJECT_0 + nEvents) {
+			bStopping = TRUE;
+			continue;
+		}
+		if (dwWait >= WAIT_OBJECT_0 + nEvents) return FALSE;
+		RelayStream* pStream = apStreams[ dwWait - WAIT_OBJECT_0 ];
+		iFirst = (int) (pStream - pRelay->aStreams + 1) % RELAY_STREAM_COUNT;
+
+		DWORD dwRead = 0;
+		if (! GetOverlappedResult( pStream->hPipe, &pStream->overlapped, &dwRead, FALSE )) {
+			pStream->bActive = FALSE;
+			continue;
+		}
+
+		// Read into the other buffer while this one is written
+		BYTE* pData = pStream->apBuffers[ pStream->iBuffer ];
+		pStream->iBuffer ^= 1;
+		startRead( pStream );
+		writeData( pStream, pData, dwRead );
+	}
+
+	showFmtVerbose( L"Relayed %llu bytes of output and %llu bytes of errors",
+		pRelay->aStreams[ RELAY_STDOUT ].ullBytes, pRelay->aStreams[ RELAY_STDERR ].ullBytes );
+
+	BOOL bSuccess = TRUE;
+	for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+		RelayStream* pStream = &pRelay->aStreams[ i ];
+		// A missing standard handle is not an error
+		if (pStream->dwOutputError && pStream->hOutput) {
+			SetLastError( pStream->dwOutputError );
+			bSuccess = FALSE;
+		}
+	}
+	return bSuccess;
+}
+
+
+void closeOutputRelay( OutputRelay* pRelay )
+{
+	releaseRelayChildHandles( pRelay );
+
+	for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+		RelayStream* pStream = &pRelay->aStreams[ i ];
+		if (pStream->hPipe) {
+			// Cancel a pending read before freeing its buffer
+			if (! HasOverlappedIoCompleted( &pStream->overlapped ) && CancelIo( pStream->hPipe )) {
+				DWORD dwRead;
+				GetOverlappedResult( pStream->hPipe, &pStream->overlapped, &dwRead, TRUE );
+			}
+			CloseHandle( pStream->hPipe );
+		}
+		if (pStream->overlapped.hEvent) CloseHandle( pStream->overlapped.hEvent );
+		if (pStream->bOwnOutput) CloseHandle( pStream->hOutput );
+		if (pStream->apBuffers[ 0 ]) freeHeap( pStream->apBuffers[ 0 ] );
+		if (pStream->apBuffers[ 1 ]) freeHeap( pStream->apBuffers[ 1 ] );
+	}
+	ZeroMemory( pRelay, sizeof( OutputRelay ) );
+}
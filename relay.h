@@ -0,0 +1,70 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	relay.h
+
+	Output relay
+
+	The standard output and error of a child process are captured through
+	pipes, and written to the standard output and error of this process, or
+	to files.
+
+*/
+
+#include <windows.h>
+
+// Captured streams
+#define RELAY_STDOUT 0
+#define RELAY_STDERR 1
+#define RELAY_STREAM_COUNT 2
+
+// A captured stream
+typedef struct {
+	HANDLE hPipe;          // Read end of the pipe (overlapped)
+	HANDLE hChildEnd;      // Write end of the pipe, for the child process
+	HANDLE hOutput;        // Destination (standard handle or file)
+	BOOL bOwnOutput;       // The destination is a file opened by the relay
+	BOOL bActive;          // The end of the data is not reached
+	DWORD dwOutputError;   // Error of the last write to the destination (the
+	                       // data is then discarded)
+	OVERLAPPED overlapped;
+	BYTE* apBuffers[ 2 ];  // Buffers of the pending read and of the data written
+	int iBuffer;           // Buffer of the pending read
+	ULONGLONG ullBytes;    // Number of bytes relayed
+} RelayStream;
+
+typedef struct {
+	RelayStream aStreams[ RELAY_STREAM_COUNT ];
+	HANDLE hChildInput;       // Standard input of the child process (NUL device)
+	HANDLE hParentProcess;    // Process the child process inherits its handles from
+	HANDLE ahChildHandles[ 3 ];  // Standard handles of the child process, in the
+	                             // parent process (input, output, error)
+} OutputRelay;
+
+// Create the pipes of the output relay.
+// apwszFiles: files receiving the streams (NULL: the standard handle of this
+// process). Returns FALSE if an error occurs (the last error is set).
+BOOL createOutputRelay( OutputRelay* pRelay,
+	const wchar_t* const apwszFiles[ RELAY_STREAM_COUNT ] );
+
+// Duplicate the standard handles of the child process into the process it
+// will inherit them from (this process, or the parent process given by the
+// PROC_THREAD_ATTRIBUTE_PARENT_PROCESS attribute).
+// Returns FALSE if an error occurs (the last error is set).
+BOOL prepareRelayChildHandles( OutputRelay* pRelay, HANDLE hParentProcess );
+
+// Close the handles of the child process side, once it has been created (or
+// if its creation failed), so that the end of the data can be detected.
+void releaseRelayChildHandles( OutputRelay* pRelay );
+
+// Relay the streams until all the processes that inherited them have closed
+// them, or (if hStopProcess is not NULL) until this process has exited and
+// the data already in the pipes is relayed: the processes it created may
+// keep the pipes open. Returns FALSE if the output could not be written.
+BOOL runOutputRelay( OutputRelay* pRelay, HANDLE hStopProcess );
+
+// Close the pipes and the files of the output relay.
+void closeOutputRelay( OutputRelay* pRelay );
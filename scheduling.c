@@ -0,0 +1,203 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	scheduling.c
+
+	Scheduling settings of the child process: CPU priority class, I/O
+	priority, memory priority and power throttling (EcoQoS)
+
+	The priority class is given to CreateProcess. The other settings are set
+	on the suspended process, so that it runs with them from its first
+	instruction: SetProcessInformation (Windows 8 and later) and
+	NtSetInformationProcess are resolved when needed, as the program runs on
+	Windows Vista and later.
+
+*/
+
+#include "scheduling.h"
+
+#include <wchar.h>
+#include <windows.h>
+
+// SetProcessInformation definitions (not in the headers for Windows Vista)
+#define PROCESS_MEMORY_PRIORITY_CLASS 0  // ProcessMemoryPriority
+#define PROCESS_POWER_THROTTLING_CLASS 4  // ProcessPowerThrottling
+#define POWER_THROTTLING_VERSION 1
+#define POWER_THROTTLING_EXECUTION_SPEED 0x1
+
+typedef struct {
+	ULONG MemoryPriority;
+} MemoryPriorityInformation;
+
+typedef struct {
+	ULONG Version;
+	ULONG ControlMask;
+	ULONG StateMask;
+} PowerThrottlingState;
+
+// NtSetInformationProcess information class of the I/O priority
+#define PROCESS_IO_PRIORITY_CLASS 33
+
+typedef BOOL (WINAPI* SetProcessInformationFunc)( HANDLE, int, LPVOID, DWORD );
+typedef LONG (NTAPI* NtSetInformationProcessFunc)( HANDLE, ULONG, PVOID, ULONG );
+
+// Named values of a setting
+typedef struct {
+	const wchar_t* pwszName;
+	int value;
+} NamedValue;
+
+static const NamedValue aCpuPriorities[] = {
+	{ L"idle", IDLE_PRIORITY_CLASS },
+	{ L"below", BELOW_NORMAL_PRIORITY_CLASS },
+	{ L"normal", NORMAL_PRIORITY_CLASS },
+	{ L"above", ABOVE_NORMAL_PRIORITY_CLASS },
+	{ L"high", HIGH_PRIORITY_CLASS }
+};
+
+static const NamedValue aIoPriorities[] = {
+	{ L"verylow", SCHEDULING_IO_VERY_LOW },
+	{ L"low", SCHEDULING_IO_LOW },
+	{ L"normal", SCHEDULING_IO_NORMAL }
+};
+
+static const NamedValue aMemoryPriorities[] = {
+	{ L"verylow", 1 },
+	{ L"low", 2 },
+	{ L"medium", 3 },
+	{ L"below", 4 },
+	{ L"normal", 5 }
+};
+
+// Settings of the "background" profile: out of the way of the other processes
+static const SchedulingSettings backgroundSettings = {
+	IDLE_PRIORITY_CLASS, SCHEDULING_IO_VERY_LOW, 1, TRUE
+};
+
+
+//
+// Check whether an item of a list is a name, followed by '=' if bValue is set.
+//
+static BOOL isItem( const wchar_t* pItem, size_t nLength, const wchar_t* pwszName, BOOL bValue )
+{
+	size_t nNameLength = wcslen( pwszName );
+	return nLength >= nNameLength + bValue && ! _wcsnicmp( pItem, pwszName, nNameLength ) &&
+		(! bValue ? nLength == nNameLength : pItem[ nNameLength ] == L'=');
+}
+
+
+//
+// Find a value by its name. Returns FALSE if the name is unknown.
+//
+static BOOL findNamedValue( const NamedValue* aValues, int nValues, const wchar_t* pName,
+	size_t nLength, int* pValue )
+{
+	for (int i = 0; i < nValues; i++) {
+		if (wcslen( aValues[ i ].pwszName ) == nLength &&
+			! _wcsnicmp( pName, aValues[ i ].pwszName, nLength )) {
+			*pValue = aValues[ i ].value;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+//
+// Parse scheduling settings. The items apply in order: "background" replaces
+// the settings of the previous items.
+//
+BOOL parseSchedulingSettings( const wchar_t* pwszValue, SchedulingSettings* pSettings )
+{
+	SchedulingSettings settings = *pSettings;
+	const wchar_t* p = pwszValue;
+
+	do {
+		const wchar_t* pItem = p;
+		while (*p && *p != L',') p++;
+		size_t nLength = p - pItem;
+		if (nLength == 0) return FALSE;
+
+		int value;
+		if (isItem( pItem, nLength, L"background", FALSE )) settings = backgroundSettings;
+		else if (isItem( pItem, nLength, L"eco", FALSE )) settings.bEcoQoS = TRUE;
+		else if (isItem( pItem, nLength, L"cpu", TRUE )) {
+			if (! findNamedValue( aCpuPriorities, sizeof( aCpuPriorities ) /
+				sizeof( *aCpuPriorities ), pItem + 4, nLength - 4, &value ))
+				return FALSE;
+			settings.dwPriorityClass = (DWORD) value;
+		}
+		else if (isItem( pItem, nLength, L"io", TRUE )) {
+			if (! findNamedValue( aIoPriorities, sizeof( aIoPriorities ) /
+				sizeof( *aIoPriorities ), pItem + 3, nLength - 3, &settings.nIoPriority ))
+				return FALSE;
+		}
+		else if (isItem( pItem, nLength, L"memory", TRUE )) {
+			if (! findNamedValue( aMemoryPriorities, sizeof( aMemoryPriorities ) /
+				sizeof( *aMemoryPriorities ), pItem + 7, nLength - 7,
+				&settings.nMemoryPriority ))
+				return FALSE;
+		}
+		else return FALSE;
+	} while (*p++);
+
+	*pSettings = settings;
+	return TRUE;
+}
+
+
+//
+// Set the I/O priority, memory priority and power throttling of a process.
+//
+int applySchedulingSettings( HANDLE hProcess, const SchedulingSettings* pSettings )
+{
+	int iStep = 1;
+
+	if (pSettings->nIoPriority) {
+		NtSetInformationProcessFunc fnNtSetInformationProcess =
+			(NtSetInformationProcessFunc) GetProcAddress( GetModuleHandle( L"ntdll.dll" ),
+			"NtSetInformationProcess" );
+		if (! fnNtSetInformationProcess) {
+			SetLastError( ERROR_PROC_NOT_FOUND );
+			return iStep;
+		}
+		ULONG ulIoPriority = pSettings->nIoPriority - 1;  // IO_PRIORITY_HINT
+		LONG status = fnNtSetInformationProcess( hProcess, PROCESS_IO_PRIORITY_CLASS,
+			&ulIoPriority, sizeof( ulIoPriority ) );
+		if (status < 0) {
+			SetLastError( (DWORD) status );
+			return iStep;
+		}
+	}
+	iStep++;
+
+	if (! pSettings->nMemoryPriority && ! pSettings->bEcoQoS) return 0;
+
+	SetProcessInformationFunc fnSetProcessInformation =
+		(SetProcessInformationFunc) GetProcAddress( GetModuleHandle( L"kernel32.dll" ),
+		"SetProcessInformation" );
+	if (! fnSetProcessInformation) {
+		SetLastError( ERROR_PROC_NOT_FOUND );
+		return pSettings->nMemoryPriority ? iStep : iStep + 1;
+	}
+
+	if (pSettings->nMemoryPriority) {
+		MemoryPriorityInformation memoryInfo = { (ULONG) pSettings->nMemoryPriority };
+		if (! fnSetProcessInformation( hProcess, PROCESS_MEMORY_PRIORITY_CLASS, &memoryInfo,
+			sizeof( memoryInfo ) ))
+			return iStep;
+	}
+	iStep++;
+
+	if (pSettings->bEcoQoS) {
+		PowerThrottlingState throttlingState = { POWER_THROTTLING_VERSION,
+			POWER_THROTTLING_EXECUTION_SPEED, POWER_THROTTLING_EXECUTION_SPEED };
+		if (! fnSetProcessInformation( hProcess, PROCESS_POWER_THROTTLING_CLASS,
+			&throttlingState, sizeof( throttlingState ) ))
+			return iStep;
+	}
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	scheduling.h
+
+	Scheduling settings of the child process: CPU priority class, I/O
+	priority, memory priority and power throttling (EcoQoS)
+
+*/
+
+#include <windows.h>
+
+// I/O priorities (0: default)
+#define SCHEDULING_IO_VERY_LOW 1
+#define SCHEDULING_IO_LOW 2
+#define SCHEDULING_IO_NORMAL 3
+
+// Memory priorities are the MEMORY_PRIORITY_xxx values, 1 (very low) to 5
+// (normal), or 0 for the default.
+
+// Scheduling settings (all zero: the defaults)
+typedef struct {
+	DWORD dwPriorityClass;  // Priority class creation flag (0: default)
+	int nIoPriority;        // SCHEDULING_IO_xxx (0: default)
+	int nMemoryPriority;    // Memory priority (0: default)
+	BOOL bEcoQoS;           // Throttle the execution speed (efficiency mode)
+} SchedulingSettings;
+
+// Parse scheduling settings: a comma-separated list of "background",
+// "cpu=<idle|below|normal|above|high>", "io=<verylow|low|normal>",
+// "memory=<verylow|low|medium|below|normal>" and "eco".
+// Returns FALSE if the settings are invalid.
+BOOL parseSchedulingSettings( const wchar_t* pwszValue, SchedulingSettings* pSettings );
+
+// Set the I/O priority, memory priority and power throttling of a process
+// (before it runs: created suspended). The priority class is a creation flag.
+// Returns 0, or the position of the first setting that could not be set (the
+// last error is set, to an NTSTATUS for the I/O priority).
+int applySchedulingSettings( HANDLE hProcess, const SchedulingSettings* pSettings );
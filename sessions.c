@@ -0,0 +1,362 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	sessions.c
+
+	Session fan-out: run a command in several sessions at the same time
+
+	The TrustedInstaller token is created once. For each target session, it is
+	duplicated with the session id set, and the process is created by a small
+	pool of threads impersonating the system, so that the process creations of
+	hundreds of sessions overlap.
+
+	The processes are then waited for together, MAXIMUM_WAIT_OBJECTS at a time.
+	The run time of each one is taken from its creation and exit times, so it
+	does not depend on the order in which they are waited for.
+
+*/
+
+#include "sessions.h"
+
+#include <wchar.h>
+#include <windows.h>
+#include <wtsapi32.h>
+
+#include "backend.h" // Win32 backend
+#include "output.h"  // Display functions
+#include "timing.h"  // Launch phase timing
+#include "tokens.h"  // Tokens and privileges management functions
+#include "utils.h"   // Utility functions
+
+// Number of threads creating the processes (the calling thread included)
+#define SESSIONS_LAUNCH_THREADS 8
+
+static wchar_t wszDesktop[] = L"winsta0\\default";
+
+// Launch of the command in a session
+typedef struct {
+	DWORD dwSessionId;
+	BOOL bCreated;
+	BOOL bExited;          // The exit code is known
+	HANDLE hProcess;
+	DWORD dwProcessId;
+	DWORD dwExitCode;
+	ULONGLONG ullRunTime;  // Run time (ms)
+	int iRunEvent;         // Timing event of the run
+} SessionLaunch;
+
+// Fan-out state, shared by the threads creating the processes
+typedef struct {
+	SessionLaunch* pLaunches;
+	int nLaunches;
+	volatile LONG nNext;        // Next launch to create
+	const wchar_t* pwszCommandLine;
+	BOOL bMinimize;
+	PrivilegeMask privileges;
+	MissingPrivilegeFunc fnMPCb;
+	HANDLE hBaseToken;          // Child process token (TrustedInstaller)
+	HANDLE hSystemToken;        // System impersonation token (system context)
+} FanOut;
+
+
+BOOL parseSessionList( const wchar_t* pwszValue, SessionList* pList )
+{
+	freeSessionList( pList );
+	if (! _wcsicmp( pwszValue, L"all" )) {
+		pList->bAll = TRUE;
+		return TRUE;
+	}
+
+	int nIds = 1;
+	for (const wchar_t* p = pwszValue; *p; p++)
+		if (*p == L',') nIds++;
+	if (nIds > SESSIONS_MAX) return FALSE;
+	pList->pdwIds = allocHeap( 0, nIds * sizeof( DWORD ) );
+
+	const wchar_t* p = pwszValue;
+	for (;;) {
+		// Decimal digits only (no sign, no space)
+		if (*p < L'0' || *p > L'9') break;
+		wchar_t* pEnd = NULL;
+		unsigned long ulId = wcstoul( p, &pEnd, 10 );
+		if (ulId >= 0xFFFFFFFF) break;
+
+		// Ignore the duplicates
+		BOOL bFound = FALSE;
+		for (int i = 0; i < pList->nIds && ! bFound; i++)
+			bFound = pList->pdwIds[ i ] == (DWORD) ulId;
+		if (! bFound) pList->pdwIds[ pList->nIds++ ] = (DWORD) ulId;
+
+		if (! *pEnd) return TRUE;
+		if (*pEnd != L',') break;
+		p = pEnd + 1;
+	}
+
+	freeSessionList( pList );
+	return FALSE;
+}
+
+
+void freeSessionList( SessionList* pList )
+{
+	if (pList->pdwIds) freeHeap( pList->pdwIds );
+	ZeroMemory( pList, sizeof( SessionList ) );
+}
+
+
+//
+// Get the ids of the logged-on sessions: active or disconnected, except the
+// services session. The caller must use freeHeap to free the ids.
+// Returns FALSE if an error occurs (the last error is set).
+//
+static BOOL getLoggedOnSessions( DWORD** ppdwIds, int* pnIds )
+{
+	PWTS_SESSION_INFOW pSessions = NULL;
+	DWORD nSessions = 0;
+	int iStepEvent = beginStep( L"WTSEnumerateSessions" );
+	BOOL bEnumerated = pBackend->fnWTSEnumerateSessions( WTS_CURRENT_SERVER_HANDLE, 0, 1,
+		&pSessions, &nSessions );
+	endStep( iStepEvent, bEnumerated );
+	if (! bEnumerated) return FALSE;
+
+	*ppdwIds = allocHeap( 0, (nSessions + 1) * sizeof( DWORD ) );
+	*pnIds = 0;
+	for (DWORD i = 0; i < nSessions; i++) {
+		if (pSessions[ i ].SessionId && (pSessions[ i ].State == WTSActive ||
+			pSessions[ i ].State == WTSDisconnected))
+			(*ppdwIds)[ (*pnIds)++ ] = pSessions[ i ].SessionId;
+	}
+	pBackend->fnWTSFreeMemory( pSessions );
+	return TRUE;
+}
+
+
+//
+// Create the process of a session.
+//
+static void launchInSession( FanOut* pFanOut, int iLaunch )
+{
+	SessionLaunch* pLaunch = &pFanOut->pLaunches[ iLaunch ];
+
+	// The missing privileges are the same in all the sessions: report them once
+	HANDLE hToken = NULL;
+	if (duplicateChildProcessToken( pFanOut->hBaseToken, pLaunch->dwSessionId,
+		pFanOut->privileges, iLaunch ? NULL : pFanOut->fnMPCb, &hToken ))
+		return;
+
+	STARTUPINFO startupInfo = {0};
+	startupInfo.cb = sizeof( STARTUPINFO );
+	startupInfo.lpDesktop = wszDesktop;
+	startupInfo.dwFlags = STARTF_USESHOWWINDOW;
+	startupInfo.wShowWindow = pFanOut->bMinimize ? SW_SHOWMINNOACTIVE : SW_SHOWNORMAL;
+
+	// CreateProcessAsUser may modify the command line: one copy per process
+	wchar_t* pwszCommandLine = duplicateString( pFanOut->pwszCommandLine );
+	PROCESS_INFORMATION processInfo = {0};
+
+	int iEvent = beginPhase( PHASE_CREATE_PROCESS );
+	BOOL bCreateResult = CreateProcessAsUser( hToken, NULL, pwszCommandLine, NULL, NULL,
+		FALSE, CREATE_NEW_CONSOLE, NULL, NULL, &startupInfo, &processInfo );
+	DWORD dwCreateError = bCreateResult ? 0 : GetLastError();
+	endPhaseStep( iEvent, dwCreateError, 0 );
+
+	freeHeap( pwszCommandLine );
+	CloseHandle( hToken );
+
+	if (! bCreateResult) {
+		showFmtError( dwCreateError, 0, L"[session %lu] Process creation failed",
+			pLaunch->dwSessionId );
+		return;
+	}
+
+	// Show each session on its own track (the process id cannot be a thread id)
+	pLaunch->iRunEvent = beginPhase( PHASE_CHILD_RUN );
+	wchar_t* pwszTrack = printFmtString( L"session %lu", pLaunch->dwSessionId );
+	if (pwszTrack) {
+		setEventTrack( iEvent, processInfo.dwProcessId, pwszTrack );
+		setEventTrack( pLaunch->iRunEvent, processInfo.dwProcessId, pwszTrack );
+		freeHeap( pwszTrack );
+	}
+
+	showFmtVerbose( L"[session %lu] Created process ID: %lu", pLaunch->dwSessionId,
+		processInfo.dwProcessId );
+	CloseHandle( processInfo.hThread );
+	pLaunch->hProcess = processInfo.hProcess;
+	pLaunch->dwProcessId = processInfo.dwProcessId;
+	pLaunch->bCreated = TRUE;
+}
+
+
+//
+// Create the processes of the sessions not yet taken by another thread
+// (thread procedure).
+//
+static DWORD WINAPI runLaunchThread( LPVOID lpParameter )
+{
+	FanOut* pFanOut = lpParameter;
+
+	// The process creation requires the system context (per thread)
+	SetThreadToken( NULL, pFanOut->hSystemToken );
+
+	for (;;) {
+		int iLaunch = InterlockedIncrement( &pFanOut->nNext ) - 1;
+		if (iLaunch >= pFanOut->nLaunches) break;
+		launchInSession( pFanOut, iLaunch );
+	}
+	return 0;
+}
+
+
+static ULONGLONG getFileTimeValue( const FILETIME* pFileTime )
+{
+	ULARGE_INTEGER value;
+	value.LowPart = pFileTime->dwLowDateTime;
+	value.HighPart = pFileTime->dwHighDateTime;
+	return value.QuadPart;
+}
+
+
+//
+// Wait for all the processes, and get their exit codes and run times.
+// If the wait fails, the remaining processes are left running.
+//
+static void waitForSessions( SessionLaunch* pLaunches, int nLaunches )
+{
+	int* piRunning = allocHeap( 0, nLaunches * sizeof( int ) );
+	int nRunning = 0;
+	for (int i = 0; i < nLaunches; i++)
+		if (pLaunches[ i ].bCreated) piRunning[ nRunning++ ] = i;
+
+	while (nRunning) {
+		// The first running processes: a finished one is replaced by the last one
+		HANDLE ahWaited[ MAXIMUM_WAIT_OBJECTS ];
+		DWORD nWaited = nRunning < MAXIMUM_WAIT_OBJECTS ? nRunning : MAXIMUM_WAIT_OBJECTS;
+		for (DWORD i = 0; i < nWaited; i++) ahWaited[ i ] = pLaunches[ piRunning[ i ] ].hProcess;
+
+		DWORD dwWait = WaitForMultipleObjects( nWaited, ahWaited, FALSE, INFINITE );
+		if (dwWait >= WAIT_OBJECT_0 + nWaited) {
+			showError( L"Failed to wait for the processes", GetLastError(), 0 );
+			break;
+		}
+
+		int iSlot = dwWait - WAIT_OBJECT_0;
+		SessionLaunch* pLaunch = &pLaunches[ piRunning[ iSlot ] ];
+		piRunning[ iSlot ] = piRunning[ --nRunning ];
+
+		FILETIME ftCreation, ftExit, ftKernel, ftUser;
+		if (GetProcessTimes( pLaunch->hProcess, &ftCreation, &ftExit, &ftKernel, &ftUser ))
+			pLaunch->ullRunTime = (getFileTimeValue( &ftExit ) -
+				getFileTimeValue( &ftCreation )) / 10000;
+		pLaunch->bExited = GetExitCodeProcess( pLaunch->hProcess, &pLaunch->dwExitCode );
+		if (! pLaunch->bExited) pLaunch->dwExitCode = (DWORD) -1;
+		endPhaseStep( pLaunch->iRunEvent, pLaunch->dwExitCode, 0 );
+
+		showFmtInfo( L"[session %lu] exited with code %ld (%llu ms)\n",
+			pLaunch->dwSessionId, pLaunch->dwExitCode, pLaunch->ullRunTime );
+	}
+
+	freeHeap( piRunning );
+}
+
+
+int runInSessions( const SessionList* pList, const wchar_t* pwszCommandLine, BOOL bMinimize,
+	PrivilegeMask privileges, MissingPrivilegeFunc fnMPCb, int* pnExitCode )
+{
+	int errCode = 0;
+	FanOut fanOut = {
+		.pwszCommandLine = pwszCommandLine,
+		.bMinimize = bMinimize,
+		.privileges = privileges,
+		.fnMPCb = fnMPCb
+	};
+
+	// Target sessions
+	const DWORD* pdwIds = pList->pdwIds;
+	int nIds = pList->nIds;
+	DWORD* pdwLoggedOn = NULL;
+	if (pList->bAll) {
+		if (! getLoggedOnSessions( &pdwLoggedOn, &nIds )) {
+			showError( L"Failed to enumerate the sessions", GetLastError(), 0 );
+			return 5;
+		}
+		pdwIds = pdwLoggedOn;
+	}
+	if (! nIds) {
+		showError( L"No logged-on session", 0, 0 );
+		freeHeap( pdwLoggedOn );
+		return 5;
+	}
+
+	// Create the child process token once
+	HANDLE hBaseProcess = NULL;
+	errCode = getTrustedInstallerProcess( &hBaseProcess );
+	if (! errCode) {
+		errCode = createChildProcessToken( hBaseProcess, &fanOut.hBaseToken );
+		CloseHandle( hBaseProcess );
+	}
+
+	// Keep the system impersonation token for the threads creating the processes
+	if (! errCode && ! OpenThreadToken( GetCurrentThread(), TOKEN_IMPERSONATE, TRUE,
+		&fanOut.hSystemToken )) {
+		showError( L"Failed to create system context", GetLastError(), 0 );
+		errCode = 5;
+	}
+
+	if (! errCode) {
+		fanOut.pLaunches = allocHeap( HEAP_ZERO_MEMORY, nIds * sizeof( SessionLaunch ) );
+		fanOut.nLaunches = nIds;
+		for (int i = 0; i < nIds; i++) {
+			fanOut.pLaunches[ i ].dwSessionId = pdwIds[ i ];
+			fanOut.pLaunches[ i ].iRunEvent = -1;
+		}
+		showFmtVerbose( L"Running the command in %d sessions", nIds );
+
+		// Create the processes on this thread and on up to
+		// SESSIONS_LAUNCH_THREADS - 1 more
+		HANDLE ahThreads[ SESSIONS_LAUNCH_THREADS - 1 ];
+		DWORD nThreads = 0;
+		while (nThreads < SESSIONS_LAUNCH_THREADS - 1 && (int) nThreads + 1 < nIds) {
+			HANDLE hThread = CreateThread( NULL, 0, runLaunchThread, &fanOut, 0, NULL );
+			if (! hThread) break;
+			ahThreads[ nThreads++ ] = hThread;
+		}
+		runLaunchThread( &fanOut );
+		if (nThreads) WaitForMultipleObjects( nThreads, ahThreads, TRUE, INFINITE );
+		for (DWORD i = 0; i < nThreads; i++) CloseHandle( ahThreads[ i ] );
+
+		waitForSessions( fanOut.pLaunches, nIds );
+
+		// Aggregate result: the exit code of the first failed session
+		int nSucceeded = 0, nFailed = 0, nNotCreated = 0;
+		*pnExitCode = 0;
+		for (int i = 0; i < nIds; i++) {
+			SessionLaunch* pLaunch = &fanOut.pLaunches[ i ];
+			if (! pLaunch->bCreated) {
+				if (! nFailed && ! nNotCreated) errCode = 4;  // Process creation failed
+				nNotCreated++;
+				continue;
+			}
+			CloseHandle( pLaunch->hProcess );
+			if (! pLaunch->bExited) {
+				if (! nFailed && ! nNotCreated) errCode = 6;  // Exit code unavailable
+				nFailed++;
+			}
+			else if (pLaunch->dwExitCode == 0) nSucceeded++;
+			else {
+				if (! nFailed && ! nNotCreated) *pnExitCode = (int) pLaunch->dwExitCode;
+				nFailed++;
+			}
+		}
+
+		showFmtInfo( L"%d succeeded, %d failed, %d not created\n", nSucceeded, nFailed,
+			nNotCreated );
+		freeHeap( fanOut.pLaunches );
+	}
+
+	if (fanOut.hSystemToken) CloseHandle( fanOut.hSystemToken );
+	if (fanOut.hBaseToken) CloseHandle( fanOut.hBaseToken );
+	if (pdwLoggedOn) freeHeap( pdwLoggedOn );
+	return errCode;
+}
@@ -0,0 +1,38 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	sessions.h
+
+	Session fan-out: run a command in several sessions at the same time
+
+*/
+
+#include <windows.h>
+
+#include "tokens.h" // Tokens and privileges management functions
+
+// Maximum number of sessions of a list
+#define SESSIONS_MAX 4096
+
+// Target sessions (/S option)
+typedef struct {
+	BOOL bAll;      // All the logged-on sessions
+	DWORD* pdwIds;  // Session ids (if not bAll)
+	int nIds;
+} SessionList;
+
+// Parse a session list: "all", or comma-separated session ids.
+// Returns FALSE if the list is invalid.
+BOOL parseSessionList( const wchar_t* pwszValue, SessionList* pList );
+
+// Free the session ids of a list.
+void freeSessionList( SessionList* pList );
+
+// Run a command in each session of a list, and wait for all of them.
+// SeDebugPrivilege must be acquired and the system context must be created.
+// pnExitCode receives the aggregate result (0 if all the commands succeeded).
+int runInSessions( const SessionList* pList, const wchar_t* pwszCommandLine, BOOL bMinimize,
+	PrivilegeMask privileges, MissingPrivilegeFunc fnMPCb, int* pnExitCode );
@@ -13,21 +13,36 @@
 #include <wchar.h>
 #include <windows.h>
 
-#include "output.h" // Display functions
-#include "tokens.h" // Tokens and privileges management functions
-#include "utils.h"  // Utility functions
+#include "args.h"       // Command line parsing
+#include "broker.h"     // Launch broker
+#include "job.h"        // Job object management
+#include "output.h"     // Display functions
+#include "scheduling.h" // Scheduling settings
+#include "timing.h"     // Launch phase timing
+#include "tokens.h"     // Tokens and privileges management functions
+#include "utils.h"      // Utility functions
 
 #define PROJECT_NAME_WSTR L"sudo"
 
 // Program options
 static struct {
+	unsigned int bBroker : 1;      // Whether to create child process through the broker
 	unsigned int bMinimize : 1;    // Whether to minimize created window
-} options = {0};
+	unsigned int bScheduling : 1;  // Whether to set the scheduling of the child process
+	unsigned int bTiming : 1;      // Whether to print the duration of each launch phase
+	unsigned int bWaitTree : 1;    // Whether to wait for all the processes of the tree
+	PrivilegeMask privileges;      // Privileges to enable in the child process token
+	DWORD dwTimeout;               // Maximum run time of the child process (ms, 0: none)
+	wchar_t* pwszTimingJson;       // File receiving the phase timing record (or NULL)
+	wchar_t* pwszTimingTrace;      // File receiving the trace events (or NULL)
+	SchedulingSettings scheduling; // Scheduling settings of the child process
+} options = { .privileges = PRIVILEGE_MASK_ALL };
 
 /*
 	sudo.exe - Return codes
 
-	The exit code of the child process is returned.
+	The exit code of the child process is returned (with /W, once all the
+	processes of its tree have exited).
 
 	If sudo fails, it returns the code -(EXIT_CODE_BASE + errCode),
 	where errCode is one of the codes listed below.
@@ -38,9 +53,15 @@ static struct {
 		4 - Process creation failed
 		5 - Another fatal error occurred
 		6 - The child process' exit code could not be got (very unlikely)
+		7 - Failed to connect to the broker
+		8 - The child process tree was terminated: the /T run time elapsed
+		9 - The child process tree was terminated: the console was closed
 */
 
 #define EXIT_CODE_BASE 1000000
+
+// Maximum value of the /T option (seconds): one week
+#define MAX_RUN_TIME (7 * 24 * 3600)
 static int nChildExitCode = 0;
 
 
@@ -70,12 +91,14 @@ static int createChildProcess( wchar_t* pwszImageName )
 	// Get the console session id and set it in the token
 	DWORD dwSessionId = WTSGetActiveConsoleSessionId();
 	if (dwSessionId != (DWORD) -1) {
-		SetTokenInformation( hChildProcessToken, TokenSessionId, (PVOID) &dwSessionId,
-			sizeof( DWORD ) );
+		int iStepEvent = beginStep( L"SetTokenInformation" );
+		BOOL bSet = SetTokenInformation( hChildProcessToken, TokenSessionId,
+			(PVOID) &dwSessionId, sizeof( DWORD ) );
+		endStep( iStepEvent, bSet );
 	}
 
-	// Set all privileges in the child process token
-	setAllPrivileges( hChildProcessToken, NULL );
+	// Set the privileges in the child process token
+	setPrivileges( hChildProcessToken, options.privileges, NULL );
 
 	// Initialize startupInfo
 
@@ -92,6 +115,9 @@ static int createChildProcess( wchar_t* pwszImageName )
 
 	PROCESS_INFORMATION processInfo = {0};
 
+	// Start the process suspended to put it in a job (and to set its
+	// scheduling) before it runs
+	int iEvent = beginPhase( PHASE_CREATE_PROCESS );
 	BOOL bCreateResult = CreateProcessAsUser(
 		hChildProcessToken,
 		NULL,
@@ -99,7 +125,7 @@ static int createChildProcess( wchar_t* pwszImageName )
 		NULL,
 		NULL,
 		FALSE,
-		0,
+		CREATE_SUSPENDED | options.scheduling.dwPriorityClass,
 		NULL,
 		NULL,
 		&startupInfo,
@@ -107,10 +133,62 @@ static int createChildProcess( wchar_t* pwszImageName )
 	);
 
 	DWORD dwCreateError = bCreateResult ? 0 : GetLastError();
+	endPhaseStep( iEvent, dwCreateError, 0 );
 	CloseHandle( hChildProcessToken );
 
 	if (bCreateResult) {
+		// Terminate the process tree (the processes of its job) when the
+		// maximum run time elapses, or when the console is closed. The child
+		// process shares the console: Ctrl+C is its own.
+		// With /W, the job also tells when all its processes have exited.
+		HANDLE hJobPort = NULL;
+		int iStepEvent = beginStep( L"createProcessJob" );
+		HANDLE hJob = createProcessJob( processInfo.hProcess,
+			options.bWaitTree ? &hJobPort : NULL );
+		endStep( iStepEvent, hJob != NULL );
+		if (! hJob && options.bWaitTree)
+			showError( L"Failed to create the job object", GetLastError(), 0 );
+
+		JobWatch watch;
+		BOOL bWatched = startJobWatch( &watch, hJobPort ? NULL : processInfo.hProcess, hJob,
+			options.dwTimeout ? options.dwTimeout : INFINITE, TRUE );
+		if (! bWatched && options.dwTimeout)
+			showError( L"Failed to set the maximum run time", GetLastError(), 0 );
+
+		if (options.bScheduling) {
+			iStepEvent = beginStep( L"applySchedulingSettings" );
+			int iStep = applySchedulingSettings( processInfo.hProcess, &options.scheduling );
+			endStep( iStepEvent, ! iStep );
+			if (iStep)
+				showError( L"Failed to set the scheduling of the child process",
+					GetLastError(), iStep );
+		}
+
+		iEvent = beginPhase( PHASE_RESUME );
+		DWORD dwSuspendCount = ResumeThread( processInfo.hThread );
+		endPhaseStep( iEvent, dwSuspendCount == (DWORD) -1 ? GetLastError() : 0, 0 );
+
+		iEvent = beginPhase( PHASE_CHILD_RUN );
+		setEventTrack( iEvent, processInfo.dwProcessId, L"child" );
 		WaitForSingleObject( processInfo.hProcess, INFINITE );
+		if (hJobPort) {
+			iStepEvent = beginStep( L"waitForJob" );
+			BOOL bWaited = waitForJob( hJob, hJobPort );
+			endStep( iStepEvent, bWaited );
+			if (! bWaited)
+				showError( L"Failed to wait for the process tree", GetLastError(), 0 );
+		}
+		endPhase( iEvent );
+
+		int nReason = bWatched ? stopJobWatch( &watch ) : JOB_WATCH_NONE;
+		if (nReason == JOB_WATCH_TIMEOUT) {
+			showFmtError( 0, 0, L"The process did not exit within %lu seconds, "
+				L"its process tree was terminated", options.dwTimeout / 1000 );
+			errCode = 8;
+		}
+		else if (nReason == JOB_WATCH_CANCELLED) errCode = 9;
+		if (hJob) CloseHandle( hJob );
+		if (hJobPort) CloseHandle( hJobPort );
 
 		// Get exit code of child process
 		DWORD dwExitCode;
@@ -125,55 +203,75 @@ static int createChildProcess( wchar_t* pwszImageName )
 	else {
 		// Most commonly - 0x2 - The system cannot find the file specified.
 		showError( L"Process creation failed", dwCreateError, 0 );
-		return 4;
+		errCode = 4;
 	}
 
-	return 0;
+	return errCode;
 }
 
 
-static BOOL getArgument( wchar_t** ppArgument, wchar_t** ppArgumentIndex )
+static void reportTiming( const wchar_t* pwszCommandLine )
 {
-	// Current pointer to the remainder of the line to be parsed.
-	// Initialized with the full command line on the first call.
-	static wchar_t* p = NULL;
-	if (! p) {
-		p = GetCommandLine();
-
-		// Skip program name
-		BOOL bQuote = FALSE;
-		while (*p) {
-			if (*p == L'"') bQuote = ! bQuote;
-			else if (! bQuote && (*p == L' ' || *p == L'\t')) break;
-			p++;
-		}
+	showTimingReport();
+	if (options.pwszTimingJson) {
+		if (! writeTimingReport( options.pwszTimingJson, PROJECT_NAME_WSTR, pwszCommandLine ))
+			showFmtError( GetLastError(), 0, L"Failed to write timing '%ls'",
+				options.pwszTimingJson );
+		freeHeap( options.pwszTimingJson );
 	}
+	if (options.pwszTimingTrace) {
+		if (! writeTraceEvents( options.pwszTimingTrace, PROJECT_NAME_WSTR, pwszCommandLine ))
+			showFmtError( GetLastError(), 0, L"Failed to write trace '%ls'",
+				options.pwszTimingTrace );
+		freeHeap( options.pwszTimingTrace );
+	}
+}
 
-	// Free the previous argument (if it exists)
-	if (*ppArgument) freeHeap( *ppArgument );
-	*ppArgument = NULL;
-
-	// Search argument
-
-	// Skip spaces
-	while (*p == L' ' || *p == L'\t') p++;
-
-	if (*p) {
-		// Argument found
-		wchar_t* pBegin = p;
-
-		// Search the end of the argument
-		while (*p && *p != L' ' && *p != L'\t') p++;
 
-		size_t nArgSize = (p - pBegin) * sizeof( wchar_t );
-		*ppArgument = allocHeap( HEAP_ZERO_MEMORY, nArgSize + sizeof( wchar_t ) );
-		memcpy( *ppArgument, pBegin, nArgSize );
-		*ppArgumentIndex = pBegin;
-		return TRUE;
+static int parseOptionValue( wchar_t opt, const wchar_t* pwszValue )
+{
+	switch (opt) {
+	case 'n':
+		if (! parseSchedulingSettings( pwszValue, &options.scheduling )) {
+			showFmtError( 0, 0, L"Invalid scheduling settings '%ls'", pwszValue );
+			return 1;
+		}
+		options.bScheduling = 1;
+		break;
+	case 'p':
+		if (! parsePrivilegeProfile( pwszValue, &options.privileges )) {
+			showFmtError( 0, 0, L"Invalid privilege profile '%ls'", pwszValue );
+			return 1;
+		}
+		break;
+	case 'T': {
+		wchar_t* pEnd = NULL;
+		long nSeconds = wcstol( pwszValue, &pEnd, 10 );
+		if (*pEnd || nSeconds < 1 || nSeconds > MAX_RUN_TIME) {
+			showFmtError( 0, 0, L"Invalid maximum run time '%ls' (1 to %d)", pwszValue,
+				MAX_RUN_TIME );
+			return 1;
+		}
+		options.dwTimeout = (DWORD) nSeconds * 1000;
+		break;
 	}
-
-	// Argument not found
-	return FALSE;
+	case 't':
+		// Inline value of /t:json=<path> or /t:trace=<path>
+		if (! _wcsnicmp( pwszValue, L"json=", 5 ) && pwszValue[ 5 ]) {
+			if (options.pwszTimingJson) freeHeap( options.pwszTimingJson );
+			options.pwszTimingJson = duplicateString( pwszValue + 5 );
+		}
+		else if (! _wcsnicmp( pwszValue, L"trace=", 6 ) && pwszValue[ 6 ]) {
+			if (options.pwszTimingTrace) freeHeap( options.pwszTimingTrace );
+			options.pwszTimingTrace = duplicateString( pwszValue + 6 );
+		}
+		else {
+			showFmtError( 0, 0, L"Invalid timing output '%ls'", pwszValue );
+			return 1;
+		}
+		break;
+	}
+	return 0;
 }
 
 
@@ -182,13 +280,30 @@ static void showHelp( void )
 	showInfo( L"\n"
 		PROJECT_NAME_WSTR " [options] [command_to_run]\n\n\
 Options (you can use either \"-\" or \"/\"):\n\
+  /b  Create the child process through the broker (superUser /B).\n\
   /h  Display this help message.\n\
   /m  Minimize the created window.\n\
+  /n  Scheduling of the child process, set before it runs. Followed by a\n\
+      comma-separated list of: background (idle CPU, very low I/O and\n\
+      memory priority, EcoQoS), cpu=<idle|below|normal|above|high>,\n\
+      io=<verylow|low|normal>, memory=<verylow|low|medium|below|normal>, eco.\n\
+  /p  Privileges to enable (default: all). Followed by a comma-separated\n\
+      list of profiles (all, backup-restore, debug-only) or privilege names.\n\
+  /T  Maximum run time of the child process, in seconds: when it elapses,\n\
+      its process tree is terminated.\n\
+  /t  Display the duration of each launch phase. With /t:json=<path>,\n\
+      also append them to a file, as a JSON line. With /t:trace=<path>,\n\
+      append the phases and Win32 calls to a trace file (trace event format).\n\
+  /W  Wait for all the processes of the child process tree to finish, and\n\
+      return the child's exit code. The tree is terminated if sudo ends first.\n\
 " );
 }
 
 
-int wmain( void )
+//
+// Parse the options and launch the child process. Returns the exit code.
+//
+static int launch( void )
 {
 	int errCode = 0;  // sudo error code
 
@@ -196,18 +311,24 @@ int wmain( void )
 	// arguments) - basically the first non-option argument or "cmd.exe".
 	wchar_t* pwszCommandLine = NULL;
 
-	wchar_t* pwszArgument = NULL;  // Command line argument
-	wchar_t* pwszArgumentIndex = NULL;  // Pointer to argument in command line
+	ArgumentParser parser;
+	Argument arg;  // Command line argument (not copied)
 
 	// Parse command line options
 
-	while (getArgument( &pwszArgument, &pwszArgumentIndex )) {
+	initArgumentParser( &parser, NULL );
+	while (getArgument( &parser, &arg )) {
 		// Check for an at-least-two-character string beginning with '/' or '-'
-		if ((*pwszArgument == L'/' || *pwszArgument == L'-') && pwszArgument[ 1 ]) {
-			int j = 1;
+		if (arg.nLength > 1 && (*arg.pValue == L'/' || *arg.pValue == L'-')) {
+			size_t j = 1;
 			wchar_t opt;
-			while ((opt = pwszArgument[ j ])) {
+			wchar_t valueOpt = 0;  // Option whose value is the next argument
+			while (! valueOpt && j < arg.nLength) {
+				opt = arg.pValue[ j ];
 				switch (opt) {
+				case 'b':
+					options.bBroker = 1;
+					break;
 				case 'h':
 					showHelp();
 					errCode = -1;
@@ -215,6 +336,23 @@ int wmain( void )
 				case 'm':
 					options.bMinimize = 1;
 					break;
+				case 'W':
+					options.bWaitTree = 1;
+					break;
+				case 'n':
+				case 'p':
+				case 'T':
+					valueOpt = opt;
+					break;
+				case 't':
+					options.bTiming = 1;
+					if (j + 1 < arg.nLength && arg.pValue[ j + 1 ] == L':') {
+						// The option is followed by ":" and its value (last of the group)
+						errCode = parseOptionValue( opt, getArgumentString( &arg, j + 2 ) );
+						if (errCode) goto done_params;
+						j = arg.nLength - 1;
+					}
+					break;
 				default:
 					showFmtError( 0, 0, L"Invalid option '%lc'", opt );
 					errCode = 1;
@@ -222,31 +360,64 @@ int wmain( void )
 				}
 				j++;
 			}
+
+			if (valueOpt) {
+				// The option must be the last of the group, followed by its value
+				if (j < arg.nLength || ! getArgument( &parser, &arg )) {
+					showFmtError( 0, 0, L"Option '%lc' requires a value", valueOpt );
+					errCode = 1;
+					goto done_params;
+				}
+				errCode = parseOptionValue( valueOpt, getArgumentString( &arg, 0 ) );
+				if (errCode) goto done_params;
+			}
 		}
 		else {
 			// First non-option argument found
-			pwszCommandLine = pwszArgumentIndex;
+			pwszCommandLine = arg.pwszRaw;
 			break;
 		}
 	}
 done_params:
-	// Free the last argument (if it exists)
-	if (pwszArgument) freeHeap( pwszArgument );
-
 	if (errCode) return getExitCode( errCode );
 
-	if (! pwszCommandLine) pwszCommandLine = L"cmd.exe";
+	if (options.bTiming) startTiming();
 
-	// pwszCommandLine may be read-only. It must be copied to a writable area.
-	size_t nCommandLineBufSize = (wcslen( pwszCommandLine ) + 1) * sizeof( wchar_t );
-	wchar_t* pwszImageName = allocHeap( 0, nCommandLineBufSize );
-	memcpy( pwszImageName, pwszCommandLine, nCommandLineBufSize );
+	// CreateProcess may modify the command line: it must be writable, as the
+	// process command line (returned by GetCommandLine) is.
+	static wchar_t awcDefaultCommandLine[] = L"cmd.exe";
+	if (! pwszCommandLine) pwszCommandLine = awcDefaultCommandLine;
 
-	errCode = acquireSeDebugPrivilege();
-	if (! errCode) errCode = createSystemContext();
-	if (! errCode) errCode = createChildProcess( pwszImageName );
+	if (options.bBroker && (options.dwTimeout || options.bWaitTree || options.bScheduling)) {
+		showError( L"/n, /T and /W options cannot be used with /b", 0, 0 );
+		return getExitCode( 1 );
+	}
+
+	if (options.bBroker) {
+		DWORD dwFlags = BROKER_FLAG_WAIT | BROKER_FLAG_STD_HANDLES;
+		if (options.bMinimize) dwFlags |= BROKER_FLAG_MINIMIZE;
+
+		DWORD dwExitCode = 0;
+		errCode = callBroker( pwszCommandLine, dwFlags, options.privileges, &dwExitCode );
+		nChildExitCode = dwExitCode;
+	}
+	else {
+		errCode = prepareSystemLaunch();
+		if (! errCode) errCode = createChildProcess( pwszCommandLine );
+	}
 
-	freeHeap( pwszImageName );
+	if (options.bTiming) reportTiming( pwszCommandLine );
 
 	return getExitCode( errCode );
 }
+
+
+int wmain( void )
+{
+	// Launch-scoped memory is carved from an arena, released at once
+	Arena arena;
+	openArena( &arena, LAUNCH_ARENA_SIZE );
+	int nExitCode = launch();
+	closeArena( &arena );
+	return nExitCode;
+}
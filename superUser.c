@@ -15,22 +15,50 @@
 #include <wchar.h>
 #include <windows.h>
 
-#include "output.h" // Display functions
-#include "tokens.h" // Tokens and privileges management functions
-#include "utils.h"  // Utility functions
+#include "args.h"       // Command line parsing
+#include "broker.h"     // Launch broker
+#include "coprocess.h"  // Coprocess mode
+#include "job.h"        // Job object management
+#include "manifest.h"   // Manifest mode
+#include "output.h"     // Display functions
+#include "placement.h"  // Processor group and NUMA node placement
+#include "relay.h"      // Output relay
+#include "scheduling.h" // Scheduling settings
+#include "sessions.h"   // Session fan-out
+#include "timing.h"     // Launch phase timing
+#include "tokens.h"     // Tokens and privileges management functions
+#include "utils.h"      // Utility functions
 
 #define PROJECT_NAME_WSTR L"superUser"
 
 // Program options
 static struct {
+	unsigned int bBroker : 1;      // Whether to create child process through the broker
+	unsigned int bBrokerServer : 1;  // Whether to run the broker
+	unsigned int bCoprocess : 1;   // Whether to run the commands read from stdin
 	unsigned int bMinimize : 1;    // Whether to minimize created window
+	unsigned int bOutput : 1;      // Whether to capture the output of the child process
+	unsigned int bPlacement : 1;   // Whether to place the child process on processors
+	unsigned int bScheduling : 1;  // Whether to set the scheduling of the child process
 	unsigned int bSeamless : 1;    // Whether child process shares parent's console
+	unsigned int bSessions : 1;    // Whether to run the command in several sessions
+	unsigned int bTiming : 1;      // Whether to print the duration of each launch phase
 	unsigned int bVerbose : 1;     // Whether to print debug messages or not
 	unsigned int bWait : 1;        // Whether to wait for child process to finish
-} options = {0};
-
-#define showFmtVerbose(...) \
-	if (options.bVerbose) showFmtDebug(__VA_ARGS__);
+	unsigned int bWaitTree : 1;    // Whether to wait for all the processes of its tree
+	PrivilegeMask privileges;      // Privileges to enable in the child process token
+	wchar_t* pwszManifest;         // Manifest file to run (NULL if none)
+	int nMaxJobs;                  // Maximum number of concurrent manifest commands
+	DWORD dwTimeout;               // Maximum run time of the child process (ms, 0: none)
+	wchar_t* pwszReport;           // File receiving the job accounting record (or NULL)
+	wchar_t* pwszTimingJson;       // File receiving the phase timing record (or NULL)
+	wchar_t* pwszTimingTrace;      // File receiving the trace events (or NULL)
+	wchar_t* apwszOutputFiles[ RELAY_STREAM_COUNT ];  // Files receiving the captured
+	                                                  // output (NULL: standard handles)
+	SessionList sessions;          // Target sessions of the fan-out
+	SchedulingSettings scheduling; // Scheduling settings of the child process
+	PlacementSettings placement;   // Processor group, affinity and NUMA node of the child
+} options = { .privileges = PRIVILEGE_MASK_ALL };
 
 /*
 	Return codes (without /w option):
@@ -39,14 +67,30 @@ static struct {
 		3 - Failed to open/start TrustedInstaller process/service
 		4 - Process creation failed
 		5 - Another fatal error occurred
+		7 - Failed to connect to the broker
+		8 - The child process tree was terminated: the /T run time elapsed
+		9 - The child process tree was terminated: a console control event
+		    (Ctrl+C, closing of the console) was received
 
 	If the /w option is specified, the exit code of the child process is returned.
+	With the /f option (which implies /w), the exit code of the first failed
+	command of the manifest is returned, or 0 if all the commands succeeded.
+	With the /S option (which implies /w), the exit code of the first failed
+	session (in the order of the list) is returned, or 0 if all succeeded.
+	With the /c option, 0 is returned at the end of the input (the result of
+	each command is written to the standard output).
+	With the /W option (which implies /w), superUser waits for all the processes
+	of the child process tree, and returns the exit code of the child process.
+	The /o and /T options imply /w.
 	If superUser fails, it returns the code -(EXIT_CODE_BASE + errCode),
 	where errCode is one of the codes listed above.
 	If the exit code could not be got (very unlikely), it returns -(EXIT_CODE_BASE + 6).
 */
 
 #define EXIT_CODE_BASE 1000000
+
+// Maximum value of the /T option (seconds): one week
+#define MAX_RUN_TIME (7 * 24 * 3600)
 static int nChildExitCode = 0;
 
 
@@ -71,12 +115,29 @@ static void showMissingPrivilege( const wchar_t* pwszPrivilege )
 static int createChildProcess( wchar_t* pwszImageName )
 {
 	int errCode = 0;
-	HANDLE hBaseProcess = NULL, hChildProcessToken = NULL;
+	HANDLE hBaseProcess = NULL, hChildProcessToken = NULL, hJobPort = NULL;
+	OutputRelay relay;
 
 	// Start the TrustedInstaller service and get its process handle
 	errCode = getTrustedInstallerProcess( &hBaseProcess );
 	if (errCode) return errCode;
 
+	if (options.bOutput) {
+		// Create the pipes of the child process standard handles, and put them
+		// in the TrustedInstaller process, which the child process inherits
+		// its handles from.
+		int iStepEvent = beginStep( L"createOutputRelay" );
+		BOOL bCreated = createOutputRelay( &relay, (const wchar_t* const*) options.apwszOutputFiles ) &&
+			prepareRelayChildHandles( &relay, hBaseProcess );
+		endStep( iStepEvent, bCreated );
+		if (! bCreated) {
+			showError( L"Failed to capture the child process output", GetLastError(), 0 );
+			closeOutputRelay( &relay );
+			CloseHandle( hBaseProcess );
+			return 5;
+		}
+	}
+
 	if (options.bSeamless) {
 		// Create the child process token
 		errCode = createChildProcessToken( hBaseProcess, &hChildProcessToken );
@@ -88,12 +149,14 @@ static int createChildProcess( wchar_t* pwszImageName )
 		// Get the console session id and set it in the token
 		DWORD dwSessionId = WTSGetActiveConsoleSessionId();
 		if (dwSessionId != (DWORD) -1) {
-			SetTokenInformation( hChildProcessToken, TokenSessionId, (PVOID) &dwSessionId,
-				sizeof( DWORD ) );
+			int iStepEvent = beginStep( L"SetTokenInformation" );
+			BOOL bSet = SetTokenInformation( hChildProcessToken, TokenSessionId,
+				(PVOID) &dwSessionId, sizeof( DWORD ) );
+			endStep( iStepEvent, bSet );
 		}
 
-		// Set all privileges in the child process token
-		setAllPrivileges( hChildProcessToken, &showMissingPrivilege );
+		// Set the privileges in the child process token
+		setPrivileges( hChildProcessToken, options.privileges, &showMissingPrivilege );
 	}
 
 	// Initialize startupInfo
@@ -107,36 +170,71 @@ static int createChildProcess( wchar_t* pwszImageName )
 	else
 		startupInfo.StartupInfo.wShowWindow = SW_SHOWNORMAL;
 
-	if (! options.bSeamless) {
-		// Initialize attribute lists for "parent assignment"
-
+	// Initialize attribute lists for "parent assignment" (and for the
+	// inherited handles with /o, and the processor placement with /a)
+	DWORD nAttributes = (options.bSeamless ? 0 : 1) + (options.bOutput ? 1 : 0) +
+		getPlacementAttributeCount( &options.placement );
+	if (nAttributes) {
 		SIZE_T attributeListLength = 0;
-		InitializeProcThreadAttributeList( NULL, 1, 0, (PSIZE_T) &attributeListLength );
+		InitializeProcThreadAttributeList( NULL, nAttributes, 0, (PSIZE_T) &attributeListLength );
 		startupInfo.lpAttributeList = allocHeap( HEAP_ZERO_MEMORY, attributeListLength );
-		InitializeProcThreadAttributeList( startupInfo.lpAttributeList, 1, 0,
+		InitializeProcThreadAttributeList( startupInfo.lpAttributeList, nAttributes, 0,
 			(PSIZE_T) &attributeListLength );
+	}
+
+	if (options.bPlacement &&
+		! addPlacementAttributes( startupInfo.lpAttributeList, &options.placement )) {
+		showError( L"Failed to set the placement of the child process", GetLastError(), 0 );
+		DeleteProcThreadAttributeList( startupInfo.lpAttributeList );
+		freeHeap( startupInfo.lpAttributeList );
+		if (options.bSeamless) CloseHandle( hChildProcessToken );
+		if (options.bOutput) closeOutputRelay( &relay );
+		CloseHandle( hBaseProcess );
+		return 5;
+	}
 
+	if (! options.bSeamless) {
 		UpdateProcThreadAttribute( startupInfo.lpAttributeList, 0,
 			PROC_THREAD_ATTRIBUTE_PARENT_PROCESS, &hBaseProcess, sizeof( HANDLE ), NULL, NULL );
+
+		if (options.bOutput) {
+			// Only the relay handles are inherited
+			UpdateProcThreadAttribute( startupInfo.lpAttributeList, 0,
+				PROC_THREAD_ATTRIBUTE_HANDLE_LIST, relay.ahChildHandles,
+				sizeof( relay.ahChildHandles ), NULL, NULL );
+
+			startupInfo.StartupInfo.dwFlags |= STARTF_USESTDHANDLES;
+			startupInfo.StartupInfo.hStdInput = relay.ahChildHandles[ 0 ];
+			startupInfo.StartupInfo.hStdOutput = relay.ahChildHandles[ 1 ];
+			startupInfo.StartupInfo.hStdError = relay.ahChildHandles[ 2 ];
+		}
 	}
 
 	// Create process
 
 	PROCESS_INFORMATION processInfo = {0};
-	DWORD dwCreationFlags = 0;
+	DWORD dwCreationFlags = startupInfo.lpAttributeList ? EXTENDED_STARTUPINFO_PRESENT : 0;
 	if (! options.bSeamless)
-		dwCreationFlags = CREATE_SUSPENDED | EXTENDED_STARTUPINFO_PRESENT |
-		CREATE_NEW_CONSOLE;
+		dwCreationFlags |= CREATE_SUSPENDED |
+		(options.bOutput ? CREATE_NO_WINDOW : CREATE_NEW_CONSOLE);
+
+	// Start the process suspended to put it in a job before it runs
+	if (options.bWait) dwCreationFlags |= CREATE_SUSPENDED;
+
+	// Start the process suspended to set its scheduling before it runs
+	if (options.bScheduling)
+		dwCreationFlags |= CREATE_SUSPENDED | options.scheduling.dwPriorityClass;
 
 	showFmtVerbose( L"Creating specified process" );
 
+	int iEvent = beginPhase( PHASE_CREATE_PROCESS );
 	BOOL bCreateResult = CreateProcessAsUser(
 		hChildProcessToken,
 		NULL,
 		pwszImageName,
 		NULL,
 		NULL,
-		FALSE,
+		options.bOutput,
 		dwCreationFlags,
 		NULL,
 		NULL,
@@ -145,31 +243,109 @@ static int createChildProcess( wchar_t* pwszImageName )
 	);
 
 	DWORD dwCreateError = bCreateResult ? 0 : GetLastError();
+	endPhaseStep( iEvent, dwCreateError, 0 );
+
+	// The child process has its own copies of the relay handles
+	if (options.bOutput) releaseRelayChildHandles( &relay );
 
 	if (options.bSeamless) CloseHandle( hChildProcessToken );
-	else {
+	if (startupInfo.lpAttributeList) {
 		DeleteProcThreadAttributeList( startupInfo.lpAttributeList );
 		freeHeap( startupInfo.lpAttributeList );
 	}
 	CloseHandle( hBaseProcess );
 
 	if (bCreateResult) {
+		// Put the process (and the processes it will create) in a job,
+		// to report the resource usage of the whole process tree (and to wait
+		// for all its processes with /W).
+		HANDLE hJob = NULL;
+		if (options.bWait) {
+			int iStepEvent = beginStep( L"createProcessJob" );
+			hJob = createProcessJob( processInfo.hProcess,
+				options.bWaitTree ? &hJobPort : NULL );
+			endStep( iStepEvent, hJob != NULL );
+			if (! hJob) {
+				if (options.pwszReport || options.bWaitTree)
+					showError( L"Failed to create the job object", GetLastError(), 0 );
+				else showFmtVerbose( L"Could not create the job object (error 0x%lX)",
+					GetLastError() );
+			}
+		}
+
 		if (! options.bSeamless) {
 			HANDLE hProcessToken = NULL;
-			OpenProcessToken( processInfo.hProcess, TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY,
-				&hProcessToken );
-			// Set all privileges in the child process token
-			setAllPrivileges( hProcessToken, &showMissingPrivilege );
+			int iStepEvent = beginStep( L"OpenProcessToken" );
+			BOOL bOpened = OpenProcessToken( processInfo.hProcess,
+				TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hProcessToken );
+			endStep( iStepEvent, bOpened );
+			// Set the privileges in the child process token
+			setPrivileges( hProcessToken, options.privileges, &showMissingPrivilege );
 			CloseHandle( hProcessToken );
+		}
+
+		if (options.bScheduling) {
+			int iStepEvent = beginStep( L"applySchedulingSettings" );
+			int iStep = applySchedulingSettings( processInfo.hProcess, &options.scheduling );
+			endStep( iStepEvent, ! iStep );
+			if (iStep)
+				showError( L"Failed to set the scheduling of the child process",
+					GetLastError(), iStep );
+		}
+
+		// Terminate the process tree when the maximum run time elapses, or on
+		// a console control event
+		JobWatch watch;
+		BOOL bWatched = FALSE;
+		if (options.bWait) {
+			bWatched = startJobWatch( &watch, hJobPort ? NULL : processInfo.hProcess, hJob,
+				options.dwTimeout ? options.dwTimeout : INFINITE, options.bSeamless );
+			if (! bWatched) {
+				if (options.dwTimeout)
+					showError( L"Failed to set the maximum run time", GetLastError(), 0 );
+				else showFmtVerbose( L"Could not watch the process (error 0x%lX)",
+					GetLastError() );
+			}
+		}
 
-			ResumeThread( processInfo.hThread );
+		if (dwCreationFlags & CREATE_SUSPENDED) {
+			iEvent = beginPhase( PHASE_RESUME );
+			DWORD dwSuspendCount = ResumeThread( processInfo.hThread );
+			endPhaseStep( iEvent, dwSuspendCount == (DWORD) -1 ? GetLastError() : 0, 0 );
 		}
 
 		showFmtVerbose( L"Created process ID: %lu", processInfo.dwProcessId );
 
 		if (options.bWait) {
 			showFmtVerbose( L"Waiting for process to exit" );
+			iEvent = beginPhase( PHASE_CHILD_RUN );
+			setEventTrack( iEvent, processInfo.dwProcessId, L"child" );
+			// Without a job, the processes created by the child process are not
+			// terminated with it: do not wait for them to close the pipes
+			if (options.bOutput &&
+				! runOutputRelay( &relay, hJob ? NULL : processInfo.hProcess ))
+				showError( L"Failed to write the child process output", GetLastError(), 0 );
 			WaitForSingleObject( processInfo.hProcess, INFINITE );
+			if (hJobPort) {
+				showFmtVerbose( L"Waiting for the other processes of the tree to exit" );
+				int iStepEvent = beginStep( L"waitForJob" );
+				BOOL bWaited = waitForJob( hJob, hJobPort );
+				endStep( iStepEvent, bWaited );
+				if (! bWaited)
+					showError( L"Failed to wait for the process tree", GetLastError(), 0 );
+			}
+			endPhase( iEvent );
+
+			int nReason = bWatched ? stopJobWatch( &watch ) : JOB_WATCH_NONE;
+			if (nReason == JOB_WATCH_TIMEOUT) {
+				showFmtError( 0, 0, L"The process did not exit within %lu seconds, "
+					L"its process tree was terminated", options.dwTimeout / 1000 );
+				errCode = 8;
+			}
+			else if (nReason == JOB_WATCH_CANCELLED) {
+				showError( L"Cancelled, the process tree was terminated", 0, 0 );
+				errCode = 9;
+			}
 
 			// Get exit code of child process
 			DWORD dwExitCode;
@@ -178,6 +354,19 @@ static int createChildProcess( wchar_t* pwszImageName )
 
 			showFmtVerbose( L"Process exited with code %ld", dwExitCode );
 			nChildExitCode = dwExitCode;
+
+			if (hJob) {
+				JobReport report;
+				if (getJobReport( hJob, &report )) {
+					showJobReport( &report );
+					if (options.pwszReport && ! writeJobReport( options.pwszReport,
+						pwszImageName, dwExitCode, &report ))
+						showFmtError( GetLastError(), 0, L"Failed to write report '%ls'",
+							options.pwszReport );
+				}
+				CloseHandle( hJob );
+				if (hJobPort) CloseHandle( hJobPort );
+			}
 		}
 
 		CloseHandle( processInfo.hProcess );
@@ -186,55 +375,135 @@ static int createChildProcess( wchar_t* pwszImageName )
 	else {
 		// Most commonly - 0x2 - The system cannot find the file specified.
 		showError( L"Process creation failed", dwCreateError, 0 );
-		return 4;
+		errCode = 4;
 	}
 
-	return 0;
+	if (options.bOutput) closeOutputRelay( &relay );
+	return errCode;
 }
 
 
-static BOOL getArgument( wchar_t** ppArgument, wchar_t** ppArgumentIndex )
+static void reportTiming( const wchar_t* pwszCommandLine )
 {
-	// Current pointer to the remainder of the line to be parsed.
-	// Initialized with the full command line on the first call.
-	static wchar_t* p = NULL;
-	if (! p) {
-		p = GetCommandLine();
-
-		// Skip program name
-		BOOL bQuote = FALSE;
-		while (*p) {
-			if (*p == L'"') bQuote = ! bQuote;
-			else if (! bQuote && (*p == L' ' || *p == L'\t')) break;
-			p++;
-		}
+	showTimingReport();
+	if (options.pwszTimingJson) {
+		if (! writeTimingReport( options.pwszTimingJson, PROJECT_NAME_WSTR, pwszCommandLine ))
+			showFmtError( GetLastError(), 0, L"Failed to write timing '%ls'",
+				options.pwszTimingJson );
+		freeHeap( options.pwszTimingJson );
 	}
+	if (options.pwszTimingTrace) {
+		if (! writeTraceEvents( options.pwszTimingTrace, PROJECT_NAME_WSTR, pwszCommandLine ))
+			showFmtError( GetLastError(), 0, L"Failed to write trace '%ls'",
+				options.pwszTimingTrace );
+		freeHeap( options.pwszTimingTrace );
+	}
+}
 
-	// Free the previous argument (if it exists)
-	if (*ppArgument) freeHeap( *ppArgument );
-	*ppArgument = NULL;
-
-	// Search argument
-
-	// Skip spaces
-	while (*p == L' ' || *p == L'\t') p++;
-
-	if (*p) {
-		// Argument found
-		wchar_t* pBegin = p;
-
-		// Search the end of the argument
-		while (*p && *p != L' ' && *p != L'\t') p++;
 
-		size_t nArgSize = (p - pBegin) * sizeof( wchar_t );
-		*ppArgument = allocHeap( HEAP_ZERO_MEMORY, nArgSize + sizeof( wchar_t ) );
-		memcpy( *ppArgument, pBegin, nArgSize );
-		*ppArgumentIndex = pBegin;
-		return TRUE;
+static int parseOptionValue( wchar_t opt, const wchar_t* pwszValue )
+{
+	switch (opt) {
+	case 'a':
+		if (! parsePlacementSettings( pwszValue, &options.placement )) {
+			showFmtError( 0, 0, L"Invalid placement '%ls'", pwszValue );
+			return 1;
+		}
+		options.bPlacement = 1;
+		break;
+	case 'p':
+		if (! parsePrivilegeProfile( pwszValue, &options.privileges )) {
+			showFmtError( 0, 0, L"Invalid privilege profile '%ls'", pwszValue );
+			return 1;
+		}
+		break;
+	case 'n':
+		if (! parseSchedulingSettings( pwszValue, &options.scheduling )) {
+			showFmtError( 0, 0, L"Invalid scheduling settings '%ls'", pwszValue );
+			return 1;
+		}
+		options.bScheduling = 1;
+		break;
+	case 'd': {
+		wchar_t* pEnd = NULL;
+		long nSeconds = wcstol( pwszValue, &pEnd, 10 );
+		if (*pEnd || nSeconds < 1 || nSeconds > 3600) {
+			showFmtError( 0, 0, L"Invalid service start timeout '%ls' (1 to 3600)",
+				pwszValue );
+			return 1;
+		}
+		setServiceStartTimeout( (DWORD) nSeconds * 1000 );
+		break;
 	}
-
-	// Argument not found
-	return FALSE;
+	case 'T': {
+		wchar_t* pEnd = NULL;
+		long nSeconds = wcstol( pwszValue, &pEnd, 10 );
+		if (*pEnd || nSeconds < 1 || nSeconds > MAX_RUN_TIME) {
+			showFmtError( 0, 0, L"Invalid maximum run time '%ls' (1 to %d)", pwszValue,
+				MAX_RUN_TIME );
+			return 1;
+		}
+		options.dwTimeout = (DWORD) nSeconds * 1000;
+		break;
+	}
+	case 'f':
+		// The value is only valid until the next argument, keep a copy
+		if (options.pwszManifest) freeHeap( options.pwszManifest );
+		options.pwszManifest = duplicateString( pwszValue );
+		break;
+	case 'j': {
+		wchar_t* pEnd = NULL;
+		long nJobs = wcstol( pwszValue, &pEnd, 10 );
+		if (*pEnd || nJobs < 1 || nJobs > MANIFEST_MAX_JOBS) {
+			showFmtError( 0, 0, L"Invalid number of jobs '%ls' (1 to %d)", pwszValue,
+				MANIFEST_MAX_JOBS );
+			return 1;
+		}
+		options.nMaxJobs = (int) nJobs;
+		break;
+	}
+	case 'S':
+		if (! parseSessionList( pwszValue, &options.sessions )) {
+			showFmtError( 0, 0, L"Invalid session list '%ls' (all, or session ids "
+				L"separated by commas)", pwszValue );
+			return 1;
+		}
+		options.bSessions = 1;
+		break;
+	case 'r':
+		if (options.pwszReport) freeHeap( options.pwszReport );
+		options.pwszReport = duplicateString( pwszValue );
+		break;
+	case 'o': {
+		// Inline value of /o:out=<path> or /o:err=<path>
+		int iStream = -1;
+		if (! _wcsnicmp( pwszValue, L"out=", 4 ) && pwszValue[ 4 ]) iStream = RELAY_STDOUT;
+		else if (! _wcsnicmp( pwszValue, L"err=", 4 ) && pwszValue[ 4 ]) iStream = RELAY_STDERR;
+		else {
+			showFmtError( 0, 0, L"Invalid output file '%ls'", pwszValue );
+			return 1;
+		}
+		if (options.apwszOutputFiles[ iStream ]) freeHeap( options.apwszOutputFiles[ iStream ] );
+		options.apwszOutputFiles[ iStream ] = duplicateString( pwszValue + 4 );
+		break;
+	}
+	case 't':
+		// Inline value of /t:json=<path> or /t:trace=<path>
+		if (! _wcsnicmp( pwszValue, L"json=", 5 ) && pwszValue[ 5 ]) {
+			if (options.pwszTimingJson) freeHeap( options.pwszTimingJson );
+			options.pwszTimingJson = duplicateString( pwszValue + 5 );
+		}
+		else if (! _wcsnicmp( pwszValue, L"trace=", 6 ) && pwszValue[ 6 ]) {
+			if (options.pwszTimingTrace) freeHeap( options.pwszTimingTrace );
+			options.pwszTimingTrace = duplicateString( pwszValue + 6 );
+		}
+		else {
+			showFmtError( 0, 0, L"Invalid timing output '%ls'", pwszValue );
+			return 1;
+		}
+		break;
+	}
+	return 0;
 }
 
 
@@ -243,16 +512,60 @@ static void showHelp( void )
 	showInfo( L"\n"
 		PROJECT_NAME_WSTR " [options] [command_to_run]\n\n\
 Options (you can use either \"-\" or \"/\"):\n\
+  /a  Processors of the child process. Followed by a comma-separated list\n\
+      of: group=<n> (processor group), mask=<hex> (affinity mask in the\n\
+      group), node=<n> (preferred NUMA node, and its processors without a\n\
+      group). Requires Windows 7 or later.\n\
+  /b  Create the child process through the broker (see /B).\n\
+  /B  Run the broker: create child processes on behalf of /b clients.\n\
+  /c  Coprocess mode: run the commands read from the standard input, one\n\
+      per line, and write a JSON result line for each of them to the\n\
+      standard output. Their output goes to the standard error.\n\
+  /d  Maximum time to wait for the TrustedInstaller service to start,\n\
+      in seconds (default: 30).\n\
+  /f  Run the commands of a manifest file (followed by its path), with their\n\
+      dependencies. Implies /w. Each line of the file is a command:\n\
+        <id> [after:<id>,...] <command_line>\n\
   /h  Display this help message.\n\
+  /j  Maximum number of manifest commands running at the same time\n\
+      (default: number of processors).\n\
   /m  Minimize the created window.\n\
+  /n  Scheduling of the child process, set before it runs. Followed by a\n\
+      comma-separated list of: background (idle CPU, very low I/O and\n\
+      memory priority, EcoQoS), cpu=<idle|below|normal|above|high>,\n\
+      io=<verylow|low|normal>, memory=<verylow|low|medium|below|normal>, eco.\n\
+  /o  Capture the output of the child process and write it to the standard\n\
+      output and error of superUser (the exit code is the child's one).\n\
+      With /o:out=<path> or /o:err=<path>, write the standard output or the\n\
+      standard error to a file instead. Implies /w.\n\
+  /p  Privileges to enable (default: all). Followed by a comma-separated\n\
+      list of profiles (all, backup-restore, debug-only) or privilege names.\n\
+  /r  Append the resource usage of the child process tree to a file\n\
+      (followed by its path), as a JSON line. Requires /w.\n\
   /s  The child process shares the parent's console. Requires /w.\n\
-  /v  Display verbose messages.\n\
-  /w  Wait for the child process to finish before exiting.\n\
+  /S  Run the command in several sessions at the same time: all (the\n\
+      logged-on sessions) or comma-separated session ids. Implies /w.\n\
+  /T  Maximum run time of the child process, in seconds: when it elapses,\n\
+      its process tree is terminated. Implies /w.\n\
+  /t  Display the duration of each launch phase. With /t:json=<path>,\n\
+      also append them to a file, as a JSON line. With /t:trace=<path>,\n\
+      append the phases and Win32 calls to a trace file (trace event format).\n\
+  /v  Display verbose messages, and the allocations, heap peak and open\n\
+      handles of each launch phase.\n\
+  /w  Wait for the child process to finish before exiting. Ctrl+C then\n\
+      terminates its process tree (with /s, the child process receives it).\n\
+  /W  Wait for all the processes of the child process tree to finish (e.g.\n\
+      an installer started by a launcher), and return the child's exit code.\n\
+      The tree is terminated if superUser ends first. Implies /w.\n\
 " );
 }
 
 
-int wmain( void )
+//
+// Parse the options and launch the child process (or the broker, or the
+// manifest). Returns the exit code.
+//
+static int launch( void )
 {
 	int errCode = 0;  // superUser error code
 
@@ -260,19 +573,39 @@ int wmain( void )
 	// arguments) - basically the first non-option argument or "cmd.exe".
 	wchar_t* pwszCommandLine = NULL;
 
-	wchar_t* pwszArgument = NULL;  // Command line argument
-	wchar_t* pwszArgumentIndex = NULL;  // Pointer to argument in command line
+	ArgumentParser parser;
+	Argument arg;  // Command line argument (not copied)
 
 	// Parse command line options
 
-	while (getArgument( &pwszArgument, &pwszArgumentIndex )) {
+	initArgumentParser( &parser, NULL );
+	while (getArgument( &parser, &arg )) {
 		// Check for an at-least-two-character string beginning with '/' or '-'
-		if ((*pwszArgument == L'/' || *pwszArgument == L'-') && pwszArgument[ 1 ]) {
-			int j = 1;
+		if (arg.nLength > 1 && (*arg.pValue == L'/' || *arg.pValue == L'-')) {
+			size_t j = 1;
 			wchar_t opt;
-			while ((opt = pwszArgument[ j ])) {
+			wchar_t valueOpt = 0;  // Option whose value is the next argument
+			while (! valueOpt && j < arg.nLength) {
+				opt = arg.pValue[ j ];
 				// Multiple options can be grouped together (eg: /ws)
 				switch (opt) {
+				case 'b':
+					options.bBroker = 1;
+					break;
+				case 'B':
+					options.bBrokerServer = 1;
+					break;
+				case 'c':
+					options.bCoprocess = 1;
+					break;
+				case 'a':
+				case 'd':
+				case 'f':
+				case 'j':
+				case 'r':
+				case 'T':
+					valueOpt = opt;
+					break;
 				case 'h':
 					showHelp();
 					errCode = -1;
@@ -280,15 +613,41 @@ int wmain( void )
 				case 'm':
 					options.bMinimize = 1;
 					break;
+				case 'o':
+					options.bOutput = 1;
+					if (j + 1 < arg.nLength && arg.pValue[ j + 1 ] == L':') {
+						// The option is followed by ":" and its value (last of the group)
+						errCode = parseOptionValue( opt, getArgumentString( &arg, j + 2 ) );
+						if (errCode) goto done_params;
+						j = arg.nLength - 1;
+					}
+					break;
+				case 'n':
+				case 'p':
+				case 'S':
+					valueOpt = opt;
+					break;
 				case 's':
 					options.bSeamless = 1;
 					break;
+				case 't':
+					options.bTiming = 1;
+					if (j + 1 < arg.nLength && arg.pValue[ j + 1 ] == L':') {
+						// The option is followed by ":" and its value (last of the group)
+						errCode = parseOptionValue( opt, getArgumentString( &arg, j + 2 ) );
+						if (errCode) goto done_params;
+						j = arg.nLength - 1;
+					}
+					break;
 				case 'v':
 					options.bVerbose = 1;
 					break;
 				case 'w':
 					options.bWait = 1;
 					break;
+				case 'W':
+					options.bWaitTree = 1;
+					break;
 				default:
 					showFmtError( 0, 0, L"Invalid option '%lc'", opt );
 					errCode = 1;
@@ -296,39 +655,192 @@ int wmain( void )
 				}
 				j++;
 			}
+
+			if (valueOpt) {
+				// The option must be the last of the group, followed by its value
+				if (j < arg.nLength || ! getArgument( &parser, &arg )) {
+					showFmtError( 0, 0, L"Option '%lc' requires a value", valueOpt );
+					errCode = 1;
+					goto done_params;
+				}
+				errCode = parseOptionValue( valueOpt, getArgumentString( &arg, 0 ) );
+				if (errCode) goto done_params;
+			}
 		}
 		else {
 			// First non-option argument found
-			pwszCommandLine = pwszArgumentIndex;
+			pwszCommandLine = arg.pwszRaw;
 			break;
 		}
 	}
 done_params:
-	// Free the last argument (if it exists)
-	if (pwszArgument) freeHeap( pwszArgument );
-
 	if (errCode) return getExitCode( errCode );
 
+	setVerboseOutput( options.bVerbose );
+	// The verbose memory report is per phase
+	if (options.bTiming || options.bVerbose) startTiming();
+
 	// Check the consistency of the options
+	if (options.bOutput) {
+		if (options.bSeamless || options.bBroker || options.bBrokerServer ||
+			options.pwszManifest) {
+			showError( L"/o option cannot be used with /b, /B, /f or /s", 0, 0 );
+			return getExitCode( 1 );
+		}
+		options.bWait = 1;  // Relay the output until the end, return the exit code
+	}
+	if (options.dwTimeout) {
+		if (options.bBroker || options.bBrokerServer || options.pwszManifest) {
+			showError( L"/T option cannot be used with /b, /B or /f", 0, 0 );
+			return getExitCode( 1 );
+		}
+		options.bWait = 1;
+	}
+	if (options.bWaitTree) {
+		if (options.bBroker || options.bBrokerServer || options.pwszManifest ||
+			options.bCoprocess || options.bSessions) {
+			showError( L"/W option cannot be used with /b, /B, /c, /f or /S", 0, 0 );
+			return getExitCode( 1 );
+		}
+		options.bWait = 1;
+	}
+	if (options.bPlacement) {
+		if (options.bBroker || options.bBrokerServer || options.pwszManifest ||
+			options.bCoprocess || options.bSessions) {
+			showError( L"/a option cannot be used with /b, /B, /c, /f or /S", 0, 0 );
+			return getExitCode( 1 );
+		}
+		if (! resolvePlacementSettings( &options.placement )) {
+			showError( L"The placement does not match the processors of this computer",
+				GetLastError(), 0 );
+			return getExitCode( 1 );
+		}
+	}
+	if (options.bScheduling && (options.bBroker || options.bBrokerServer ||
+		options.pwszManifest || options.bCoprocess || options.bSessions)) {
+		showError( L"/n option cannot be used with /b, /B, /c, /f or /S", 0, 0 );
+		return getExitCode( 1 );
+	}
+	if (options.bSessions) {
+		if (options.bSeamless || options.bBroker || options.bBrokerServer ||
+			options.pwszManifest || options.bOutput || options.dwTimeout || options.pwszReport) {
+			showError( L"/S option cannot be used with /b, /B, /f, /o, /r, /s or /T", 0, 0 );
+			return getExitCode( 1 );
+		}
+		options.bWait = 1;  // Return the aggregate exit code
+	}
+	if (options.bCoprocess) {
+		// The standard output carries the result lines only
+		setMessageOutputToError();
+		if (pwszCommandLine || options.bSeamless || options.bBroker || options.bBrokerServer ||
+			options.pwszManifest || options.bOutput || options.dwTimeout ||
+			options.pwszReport || options.bSessions) {
+			showError( L"/c option cannot be used with a command, /b, /B, /f, /o, /r, /s, "
+				L"/S or /T", 0, 0 );
+			return getExitCode( 1 );
+		}
+		options.bWait = 1;  // Distinguish the superUser errors from 0
+
+		errCode = prepareSystemLaunch();
+		if (! errCode) errCode = runCoprocess( options.privileges, &showMissingPrivilege );
+		if (options.bTiming) reportTiming( L"/c" );
+		return getExitCode( errCode );
+	}
 	if (options.bSeamless && ! options.bWait) {
 		showError( L"/s option requires /w", 0, 0 );
 		return getExitCode( 1 );
 	}
+	if (options.pwszReport && (! options.bWait || options.bBroker || options.pwszManifest)) {
+		showError( L"/r option requires /w, and cannot be used with /b or /f", 0, 0 );
+		return getExitCode( 1 );
+	}
+
+	if (options.bBrokerServer) {
+		if (pwszCommandLine || options.bBroker || options.pwszManifest) {
+			showError( L"/B option cannot be used with a command, /b or /f", 0, 0 );
+			return getExitCode( 1 );
+		}
+
+		errCode = prepareSystemLaunch();
+		if (! errCode) errCode = runBroker();
+		return getExitCode( errCode );
+	}
+
+	if (options.pwszManifest) {
+		if (pwszCommandLine || options.bBroker || options.bSeamless) {
+			showError( L"/f option cannot be used with a command, /b or /s", 0, 0 );
+			freeHeap( options.pwszManifest );
+			return getExitCode( 1 );
+		}
+		options.bWait = 1;  // Return the aggregate exit code
+
+		if (! options.nMaxJobs) {
+			SYSTEM_INFO systemInfo;
+			GetSystemInfo( &systemInfo );
+			options.nMaxJobs = systemInfo.dwNumberOfProcessors;
+			if (options.nMaxJobs > MANIFEST_MAX_JOBS) options.nMaxJobs = MANIFEST_MAX_JOBS;
+		}
+
+		errCode = prepareSystemLaunch();
+		if (! errCode) {
+			errCode = runManifest( options.pwszManifest, options.nMaxJobs,
+				options.privileges, &showMissingPrivilege, &nChildExitCode );
+		}
+		if (options.bTiming) reportTiming( options.pwszManifest );
+		freeHeap( options.pwszManifest );
+		return getExitCode( errCode );
+	}
 
-	if (! pwszCommandLine) pwszCommandLine = L"cmd.exe";
+	// CreateProcess may modify the command line: it must be writable, as the
+	// process command line (returned by GetCommandLine) is.
+	static wchar_t awcDefaultCommandLine[] = L"cmd.exe";
+	if (! pwszCommandLine) pwszCommandLine = awcDefaultCommandLine;
 
 	showFmtVerbose( L"Your command line is '%ls'", pwszCommandLine );
 
-	// pwszCommandLine may be read-only. It must be copied to a writable area.
-	size_t nCommandLineBufSize = (wcslen( pwszCommandLine ) + 1) * sizeof( wchar_t );
-	wchar_t* pwszImageName = allocHeap( 0, nCommandLineBufSize );
-	memcpy( pwszImageName, pwszCommandLine, nCommandLineBufSize );
+	if (options.bSessions) {
+		errCode = prepareSystemLaunch();
+		if (! errCode) {
+			errCode = runInSessions( &options.sessions, pwszCommandLine, options.bMinimize,
+				options.privileges, &showMissingPrivilege, &nChildExitCode );
+		}
+		if (options.bTiming) reportTiming( pwszCommandLine );
+		freeSessionList( &options.sessions );
+		return getExitCode( errCode );
+	}
 
-	errCode = acquireSeDebugPrivilege();
-	if (! errCode && options.bSeamless) errCode = createSystemContext();
-	if (! errCode) errCode = createChildProcess( pwszImageName );
+	if (options.bBroker) {
+		DWORD dwFlags = 0;
+		if (options.bWait) dwFlags |= BROKER_FLAG_WAIT;
+		if (options.bMinimize) dwFlags |= BROKER_FLAG_MINIMIZE;
+		if (options.bSeamless) dwFlags |= BROKER_FLAG_STD_HANDLES;
 
-	freeHeap( pwszImageName );
+		DWORD dwExitCode = 0;
+		errCode = callBroker( pwszCommandLine, dwFlags, options.privileges, &dwExitCode );
+		nChildExitCode = dwExitCode;
+	}
+	else {
+		// Without /s, the child process is created from the TrustedInstaller
+		// process only (no system context)
+		errCode = options.bSeamless ? prepareSystemLaunch() : acquireSeDebugPrivilege();
+		if (! errCode) errCode = createChildProcess( pwszCommandLine );
+	}
+
+	if (options.bTiming) reportTiming( pwszCommandLine );
 
 	return getExitCode( errCode );
 }
+
+
+int wmain( void )
+{
+	// Launch-scoped memory (arguments, messages, attribute lists) is carved
+	// from an arena, released at once.
+	Arena arena;
+	openArena( &arena, LAUNCH_ARENA_SIZE );
+	int nExitCode = launch();
+	closeArena( &arena );
+
+	if (options.bVerbose) showMemoryReport();
+	return nExitCode;
+}
@@ -15,6 +15,8 @@
 #include <wchar.h>
 #include <windows.h>
 
+#include "args.h"   // Command line parsing
+#include "job.h"    // Job object management
 #include "output.h" // Display functions
 #include "tokens.h" // Tokens and privileges management functions
 #include "utils.h"  // Utility functions
@@ -25,7 +27,9 @@
 static struct {
 	unsigned int bMinimize : 1;    // Whether to minimize created window
 	unsigned int bWait : 1;        // Whether to wait for child process to finish
-} options = {0};
+	unsigned int bWaitTree : 1;    // Whether to wait for all the processes of its tree
+	PrivilegeMask privileges;      // Privileges to enable in the child process token
+} options = { .privileges = PRIVILEGE_MASK_ALL };
 
 /*
 	Return codes (without /w option):
@@ -36,6 +40,9 @@ static struct {
 		5 - Another fatal error occurred
 
 	If the /w option is specified, the exit code of the child process is returned.
+	With the /W option (which implies /w), superUserW waits for all the
+	processes of the child process tree, and returns the exit code of the child
+	process.
 	If superUser fails, it returns the code -(EXIT_CODE_BASE + errCode),
 	where errCode is one of the codes listed above.
 	If the exit code could not be got (very unlikely), it returns -(EXIT_CODE_BASE + 6).
@@ -114,14 +121,24 @@ static int createChildProcess( wchar_t* pwszImageName )
 		HANDLE hProcessToken = NULL;
 		OpenProcessToken( processInfo.hProcess, TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY,
 			&hProcessToken );
-		// Set all privileges in the child process token
-		setAllPrivileges( hProcessToken, NULL );
+		// Set the privileges in the child process token
+		setPrivileges( hProcessToken, options.privileges, NULL );
 		CloseHandle( hProcessToken );
 
+		// With /W, put the process (and the processes it will create) in a job,
+		// which tells when all its processes have exited
+		HANDLE hJob = NULL, hJobPort = NULL;
+		if (options.bWaitTree) {
+			hJob = createProcessJob( processInfo.hProcess, &hJobPort );
+			if (! hJob) showError( L"Failed to create the job object", GetLastError(), 0 );
+		}
+
 		ResumeThread( processInfo.hThread );
 
 		if (options.bWait) {
 			WaitForSingleObject( processInfo.hProcess, INFINITE );
+			if (hJob && ! waitForJob( hJob, hJobPort ))
+				showError( L"Failed to wait for the process tree", GetLastError(), 0 );
 
 			// Get exit code of child process
 			DWORD dwExitCode;
@@ -131,6 +148,11 @@ static int createChildProcess( wchar_t* pwszImageName )
 			nChildExitCode = dwExitCode;
 		}
 
+		if (hJob) {
+			CloseHandle( hJob );
+			CloseHandle( hJobPort );
+		}
+
 		CloseHandle( processInfo.hProcess );
 		CloseHandle( processInfo.hThread );
 	}
@@ -144,48 +166,17 @@ static int createChildProcess( wchar_t* pwszImageName )
 }
 
 
-static BOOL getArgument( wchar_t** ppArgument, wchar_t** ppArgumentIndex )
+static int parseOptionValue( wchar_t opt, const wchar_t* pwszValue )
 {
-	// Current pointer to the remainder of the line to be parsed.
-	// Initialized with the full command line on the first call.
-	static wchar_t* p = NULL;
-	if (! p) {
-		p = GetCommandLine();
-
-		// Skip program name
-		BOOL bQuote = FALSE;
-		while (*p) {
-			if (*p == L'"') bQuote = ! bQuote;
-			else if (! bQuote && (*p == L' ' || *p == L'\t')) break;
-			p++;
+	switch (opt) {
+	case 'p':
+		if (! parsePrivilegeProfile( pwszValue, &options.privileges )) {
+			showFmtError( 0, 0, L"Invalid privilege profile '%ls'", pwszValue );
+			return 1;
 		}
+		break;
 	}
-
-	// Free the previous argument (if it exists)
-	if (*ppArgument) freeHeap( *ppArgument );
-	*ppArgument = NULL;
-
-	// Search argument
-
-	// Skip spaces
-	while (*p == L' ' || *p == L'\t') p++;
-
-	if (*p) {
-		// Argument found
-		wchar_t* pBegin = p;
-
-		// Search the end of the argument
-		while (*p && *p != L' ' && *p != L'\t') p++;
-
-		size_t nArgSize = (p - pBegin) * sizeof( wchar_t );
-		*ppArgument = allocHeap( HEAP_ZERO_MEMORY, nArgSize + sizeof( wchar_t ) );
-		memcpy( *ppArgument, pBegin, nArgSize );
-		*ppArgumentIndex = pBegin;
-		return TRUE;
-	}
-
-	// Argument not found
-	return FALSE;
+	return 0;
 }
 
 
@@ -196,13 +187,20 @@ static void showHelp( void )
 Options (you can use either \"-\" or \"/\"):\n\
   /h  Display this help message.\n\
   /m  Minimize the created window.\n\
-  /w  Wait for the child process to finish before exiting.\
+  /p  Privileges to enable (default: all). Followed by a comma-separated\n\
+      list of profiles (all, backup-restore, debug-only) or privilege names.\n\
+  /w  Wait for the child process to finish before exiting.\n\
+  /W  Wait for all the processes of the child process tree to finish, and\n\
+      return the child's exit code. The tree is terminated if superUserW\n\
+      ends first.\
 " );
 }
 
 
-int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance,
-	PWSTR pCmdLine, int nCmdShow )
+//
+// Parse the options and launch the child process. Returns the exit code.
+//
+static int launch( void )
 {
 	int errCode = 0;  // superUser error code
 	setOutputTitle( PROJECT_NAME_WSTR );
@@ -211,17 +209,20 @@ int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance,
 	// arguments) - basically the first non-option argument or "cmd.exe".
 	wchar_t* pwszCommandLine = NULL;
 
-	wchar_t* pwszArgument = NULL;  // Command line argument
-	wchar_t* pwszArgumentIndex = NULL;  // Pointer to argument in command line
+	ArgumentParser parser;
+	Argument arg;  // Command line argument (not copied)
 
 	// Parse command line options
 
-	while (getArgument( &pwszArgument, &pwszArgumentIndex )) {
+	initArgumentParser( &parser, NULL );
+	while (getArgument( &parser, &arg )) {
 		// Check for an at-least-two-character string beginning with '/' or '-'
-		if ((*pwszArgument == L'/' || *pwszArgument == L'-') && pwszArgument[ 1 ]) {
-			int j = 1;
+		if (arg.nLength > 1 && (*arg.pValue == L'/' || *arg.pValue == L'-')) {
+			size_t j = 1;
 			wchar_t opt;
-			while ((opt = pwszArgument[ j ])) {
+			wchar_t valueOpt = 0;  // Option whose value is the next argument
+			while (! valueOpt && j < arg.nLength) {
+				opt = arg.pValue[ j ];
 				// Multiple options can be grouped together (eg: /wm)
 				switch (opt) {
 				case 'h':
@@ -231,9 +232,16 @@ int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance,
 				case 'm':
 					options.bMinimize = 1;
 					break;
+				case 'p':
+					valueOpt = opt;
+					break;
 				case 'w':
 					options.bWait = 1;
 					break;
+				case 'W':
+					options.bWaitTree = 1;
+					options.bWait = 1;
+					break;
 				default:
 					showFmtError( 0, 0, L"Invalid option '%lc'", opt );
 					errCode = 1;
@@ -241,30 +249,47 @@ int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance,
 				}
 				j++;
 			}
+
+			if (valueOpt) {
+				// The option must be the last of the group, followed by its value
+				if (j < arg.nLength || ! getArgument( &parser, &arg )) {
+					showFmtError( 0, 0, L"Option '%lc' requires a value", valueOpt );
+					errCode = 1;
+					goto done_params;
+				}
+				errCode = parseOptionValue( valueOpt, getArgumentString( &arg, 0 ) );
+				if (errCode) goto done_params;
+			}
 		}
 		else {
 			// First non-option argument found
-			pwszCommandLine = pwszArgumentIndex;
+			pwszCommandLine = arg.pwszRaw;
 			break;
 		}
 	}
 done_params:
-	// Free the last argument (if it exists)
-	if (pwszArgument) freeHeap( pwszArgument );
-
 	if (errCode) return getExitCode( errCode );
 
-	if (! pwszCommandLine) pwszCommandLine = L"cmd.exe";
-
-	// pwszCommandLine may be read-only. It must be copied to a writable area.
-	size_t nCommandLineBufSize = (wcslen( pwszCommandLine ) + 1) * sizeof( wchar_t );
-	wchar_t* pwszImageName = allocHeap( 0, nCommandLineBufSize );
-	memcpy( pwszImageName, pwszCommandLine, nCommandLineBufSize );
+	// CreateProcess may modify the command line: it must be writable, as the
+	// process command line (returned by GetCommandLine) is.
+	static wchar_t awcDefaultCommandLine[] = L"cmd.exe";
+	if (! pwszCommandLine) pwszCommandLine = awcDefaultCommandLine;
 
 	errCode = acquireSeDebugPrivilege();
-	if (! errCode) errCode = createChildProcess( pwszImageName );
+	if (! errCode) errCode = createChildProcess( pwszCommandLine );
 
-	freeHeap( pwszImageName );
 
 	return getExitCode( errCode );
 }
+
+
+int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance,
+	PWSTR pCmdLine, int nCmdShow )
+{
+	// Launch-scoped memory is carved from an arena, released at once
+	Arena arena;
+	openArena( &arena, LAUNCH_ARENA_SIZE );
+	int nExitCode = launch();
+	closeArena( &arena );
+	return nExitCode;
+}
@@ -0,0 +1,410 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	timing.c
+
+	Launch phase timing
+
+	Each phase is recorded as an event (begin and end timestamps from
+	QueryPerformanceCounter). A phase may occur several times (e.g. the
+	privileges are set twice without /s): its durations are added.
+
+	The Win32 calls made during a phase are recorded as steps. Phases and
+	steps are exported as complete events ("ph":"X") of the trace event
+	format, which trace viewers (chrome://tracing, Perfetto) nest by time
+	on each thread. Timestamps are absolute performance counter values, so
+	that the traces of several launches appended to the same file line up.
+
+	The memory and handle usage of the process is also recorded at the
+	beginning and at the end of each phase. The counters are process-wide:
+	the phases which overlap (e.g. the TrustedInstaller worker thread) share
+	their allocations.
+
+*/
+
+#include "timing.h"
+
+#include <stdarg.h>
+#include <wchar.h>
+#include <windows.h>
+
+#include "output.h" // Display functions
+#include "utils.h"  // Utility functions
+
+#define MAX_EVENTS 1024
+#define MAX_TRACK_NAME 32
+
+// Resource usage of the process at a point in time
+typedef struct {
+	LONG nAllocations;
+	LONG nHeapAllocations;
+	LONG nPeakBytes;
+	DWORD dwHandles;
+} UsageSnapshot;
+
+typedef struct {
+	int iPhase;               // TimingPhase, or -1 for a step
+	const wchar_t* pwszName;  // Step name
+	DWORD dwThreadId;
+	DWORD dwTrack;            // Track in the trace (0: the thread)
+	wchar_t wszTrackName[ MAX_TRACK_NAME ];
+	LONGLONG llBegin;
+	LONGLONG llEnd;           // 0 while the event is running
+	DWORD dwError;
+	int iStep;
+	UsageSnapshot beginUsage;  // Phases only
+	UsageSnapshot endUsage;
+} TimingEvent;
+
+static const struct {
+	const wchar_t* pwszName;      // Displayed name
+	const wchar_t* pwszJsonName;  // Name in the JSON record
+} aPhases[ PHASE_COUNT ] = {
+	{ L"SeDebugPrivilege", L"seDebug" },
+	{ L"SCM open", L"scmOpen" },
+	{ L"TI start/wait", L"tiStart" },
+	{ L"TI OpenProcess", L"tiOpen" },
+	{ L"TI join", L"tiJoin" },
+	{ L"System context", L"systemContext" },
+	{ L"Child token", L"childToken" },
+	{ L"Set privileges", L"privileges" },
+	{ L"CreateProcessAsUser", L"createProcess" },
+	{ L"Resume", L"resume" },
+	{ L"Child run", L"childRun" }
+};
+
+static struct {
+	BOOL bEnabled;
+	LONGLONG llFrequency;
+	LONGLONG llStart;
+	volatile LONG nEvents;
+	TimingEvent* pEvents;  // MAX_EVENTS events
+} timing = {0};
+
+// Phase totals, computed from the events
+typedef struct {
+	double dStart;     // First beginning (ms)
+	double dDuration;  // Total duration (ms)
+	int nCount;
+} PhaseTotal;
+
+// Phase resource usage, computed from the events
+typedef struct {
+	LONG nAllocations;
+	LONG nHeapAllocations;
+	LONG nPeakBytes;   // At the end of the last occurrence
+	DWORD dwHandles;   // At the end of the last occurrence
+	LONG nNewHandles;  // Handles opened minus handles closed
+	int nCount;
+} PhaseUsage;
+
+// Growing text buffer
+typedef struct {
+	wchar_t* pBuffer;
+	size_t nLength;
+	size_t nCapacity;
+} TextBuffer;
+
+
+static LONGLONG getCounter( void )
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter( &counter );
+	return counter.QuadPart;
+}
+
+
+static double toMilliseconds( LONGLONG llTicks )
+{
+	return (double) llTicks * 1000.0 / (double) timing.llFrequency;
+}
+
+
+static void getUsage( UsageSnapshot* pUsage )
+{
+	MemoryStats stats;
+	getMemoryStats( &stats );
+	pUsage->nAllocations = stats.nAllocations;
+	pUsage->nHeapAllocations = stats.nHeapAllocations;
+	pUsage->nPeakBytes = stats.nPeakBytes;
+	pUsage->dwHandles = 0;
+	GetProcessHandleCount( GetCurrentProcess(), &pUsage->dwHandles );
+}
+
+
+static int getEventCount( void )
+{
+	return timing.nEvents < MAX_EVENTS ? timing.nEvents : MAX_EVENTS;
+}
+
+
+static double getTotals( PhaseTotal* pTotals )
+{
+	ZeroMemory( pTotals, PHASE_COUNT * sizeof( PhaseTotal ) );
+	LONGLONG llNow = getCounter();
+
+	for (int i = 0; i < getEventCount(); i++) {
+		const TimingEvent* pEvent = &timing.pEvents[ i ];
+		if (pEvent->iPhase < 0 || ! pEvent->llEnd) continue;
+		PhaseTotal* pTotal = &pTotals[ pEvent->iPhase ];
+		if (! pTotal->nCount) pTotal->dStart = toMilliseconds( pEvent->llBegin - timing.llStart );
+		pTotal->dDuration += toMilliseconds( pEvent->llEnd - pEvent->llBegin );
+		pTotal->nCount++;
+	}
+
+	return toMilliseconds( llNow - timing.llStart );
+}
+
+
+//
+// Append a formatted string with variable arguments to a text buffer.
+//
+static void appendText( TextBuffer* pText, const wchar_t* pwszFormat, ... )
+{
+	va_list args;
+	va_start( args, pwszFormat );
+	wchar_t* pwszString = v_printFmtString( pwszFormat, args );
+	va_end( args );
+	if (! pwszString) return;
+
+	size_t nLength = wcslen( pwszString );
+	if (pText->nLength + nLength + 1 > pText->nCapacity) {
+		size_t nCapacity = (pText->nCapacity + nLength + 1) * 2;
+		wchar_t* pBuffer = allocHeap( 0, nCapacity * sizeof( wchar_t ) );
+		if (pText->pBuffer) {
+			memcpy( pBuffer, pText->pBuffer, pText->nLength * sizeof( wchar_t ) );
+			freeHeap( pText->pBuffer );
+		}
+		pText->pBuffer = pBuffer;
+		pText->nCapacity = nCapacity;
+	}
+
+	memcpy( pText->pBuffer + pText->nLength, pwszString, (nLength + 1) * sizeof( wchar_t ) );
+	pText->nLength += nLength;
+	freeHeap( pwszString );
+}
+
+
+static int addEvent( int iPhase, const wchar_t* pwszName )
+{
+	if (! timing.bEnabled) return -1;
+
+	// Events may be recorded by several threads
+	int iEvent = InterlockedIncrement( &timing.nEvents ) - 1;
+	if (iEvent >= MAX_EVENTS) return -1;
+
+	TimingEvent* pEvent = &timing.pEvents[ iEvent ];
+	pEvent->iPhase = iPhase;
+	pEvent->pwszName = pwszName;
+	pEvent->dwThreadId = GetCurrentThreadId();
+	if (iPhase >= 0) getUsage( &pEvent->beginUsage );
+	pEvent->llBegin = getCounter();
+	return iEvent;
+}
+
+
+void startTiming( void )
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency( &frequency );
+	timing.llFrequency = frequency.QuadPart;
+	timing.pEvents = allocHeap( HEAP_ZERO_MEMORY, MAX_EVENTS * sizeof( TimingEvent ) );
+	timing.llStart = getCounter();
+	timing.bEnabled = TRUE;
+}
+
+
+int beginPhase( TimingPhase phase )
+{
+	return addEvent( phase, aPhases[ phase ].pwszName );
+}
+
+
+int beginStep( const wchar_t* pwszName )
+{
+	return addEvent( -1, pwszName );
+}
+
+
+void endPhase( int iEvent )
+{
+	if (iEvent < 0) return;
+	timing.pEvents[ iEvent ].llEnd = getCounter();
+	getUsage( &timing.pEvents[ iEvent ].endUsage );
+}
+
+
+void endPhaseStep( int iEvent, DWORD dwError, int iStep )
+{
+	if (iEvent < 0) return;
+	timing.pEvents[ iEvent ].dwError = dwError;
+	timing.pEvents[ iEvent ].iStep = iStep;
+	timing.pEvents[ iEvent ].llEnd = getCounter();
+	getUsage( &timing.pEvents[ iEvent ].endUsage );
+}
+
+
+void endStep( int iEvent, BOOL bSuccess )
+{
+	if (iEvent < 0) return;
+	DWORD dwError = GetLastError();
+	if (! bSuccess) timing.pEvents[ iEvent ].dwError = dwError ? dwError : (DWORD) -1;
+	timing.pEvents[ iEvent ].llEnd = getCounter();
+	SetLastError( dwError );
+}
+
+
+void setEventTrack( int iEvent, DWORD dwTrack, const wchar_t* pwszTrackName )
+{
+	if (iEvent < 0) return;
+	TimingEvent* pEvent = &timing.pEvents[ iEvent ];
+	pEvent->dwTrack = dwTrack;
+	// Copy the name (truncated)
+	int n = 0;
+	while (n < MAX_TRACK_NAME - 1 && pwszTrackName[ n ]) {
+		pEvent->wszTrackName[ n ] = pwszTrackName[ n ];
+		n++;
+	}
+	pEvent->wszTrackName[ n ] = L'\0';
+}
+
+
+void showTimingReport( void )
+{
+	if (! timing.bEnabled) return;
+
+	PhaseTotal aTotals[ PHASE_COUNT ];
+	double dTotal = getTotals( aTotals );
+
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		if (! aTotals[ i ].nCount) continue;
+		showFmtDebug( L"%-20ls at %9.3f ms, %9.3f ms", aPhases[ i ].pwszName,
+			aTotals[ i ].dStart, aTotals[ i ].dDuration );
+	}
+	showFmtDebug( L"%-20ls %22.3f ms", L"Total", dTotal );
+}
+
+
+void showMemoryReport( void )
+{
+	if (timing.bEnabled) {
+		PhaseUsage aUsages[ PHASE_COUNT ] = {0};
+		for (int i = 0; i < getEventCount(); i++) {
+			const TimingEvent* pEvent = &timing.pEvents[ i ];
+			if (pEvent->iPhase < 0 || ! pEvent->llEnd) continue;
+			PhaseUsage* pUsage = &aUsages[ pEvent->iPhase ];
+			pUsage->nAllocations += pEvent->endUsage.nAllocations -
+				pEvent->beginUsage.nAllocations;
+			pUsage->nHeapAllocations += pEvent->endUsage.nHeapAllocations -
+				pEvent->beginUsage.nHeapAllocations;
+			pUsage->nPeakBytes = pEvent->endUsage.nPeakBytes;
+			pUsage->dwHandles = pEvent->endUsage.dwHandles;
+			pUsage->nNewHandles += (LONG) (pEvent->endUsage.dwHandles -
+				pEvent->beginUsage.dwHandles);
+			pUsage->nCount++;
+		}
+
+		for (int i = 0; i < PHASE_COUNT; i++) {
+			const PhaseUsage* pUsage = &aUsages[ i ];
+			if (! pUsage->nCount) continue;
+			showFmtDebug( L"%-20ls %5ld allocs (%ld heap), peak %7ld bytes, %4lu handles (%+ld)",
+				aPhases[ i ].pwszName, pUsage->nAllocations, pUsage->nHeapAllocations,
+				pUsage->nPeakBytes, pUsage->dwHandles, pUsage->nNewHandles );
+		}
+	}
+
+	MemoryStats stats;
+	getMemoryStats( &stats );
+	DWORD dwHandles = 0;
+	GetProcessHandleCount( GetCurrentProcess(), &dwHandles );
+	showFmtDebug( L"%-20ls %5ld allocs (%ld heap), peak %7ld bytes, %4lu handles, "
+		L"%ld bytes in use", L"Total", stats.nAllocations, stats.nHeapAllocations,
+		stats.nPeakBytes, dwHandles, stats.nLiveBytes );
+}
+
+
+BOOL writeTimingReport( const wchar_t* pwszPath, const wchar_t* pwszProgram,
+	const wchar_t* pwszCommandLine )
+{
+	if (! timing.bEnabled) return FALSE;
+
+	PhaseTotal aTotals[ PHASE_COUNT ];
+	double dTotal = getTotals( aTotals );
+
+	// Phases: "name":{"startMs":...,"durationMs":...,"count":...}
+	TextBuffer text = {0};
+	wchar_t* pwszEscaped = escapeJsonString( pwszCommandLine );
+	appendText( &text, L"{\"program\":\"%ls\",\"command\":\"%ls\",\"totalMs\":%.3f,"
+		L"\"phases\":{", pwszProgram, pwszEscaped, dTotal );
+	freeHeap( pwszEscaped );
+
+	BOOL bFirst = TRUE;
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		if (! aTotals[ i ].nCount) continue;
+		appendText( &text, L"%ls\"%ls\":{\"startMs\":%.3f,\"durationMs\":%.3f,\"count\":%d}",
+			bFirst ? L"" : L",", aPhases[ i ].pwszJsonName,
+			aTotals[ i ].dStart, aTotals[ i ].dDuration, aTotals[ i ].nCount );
+		bFirst = FALSE;
+	}
+	appendText( &text, L"}}\n" );
+
+	BOOL bSuccess = text.pBuffer && appendTextFile( pwszPath, text.pBuffer );
+	if (text.pBuffer) freeHeap( text.pBuffer );
+	return bSuccess;
+}
+
+
+BOOL writeTraceEvents( const wchar_t* pwszPath, const wchar_t* pwszProgram,
+	const wchar_t* pwszCommandLine )
+{
+	if (! timing.bEnabled) return FALSE;
+
+	TextBuffer text = {0};
+	DWORD dwProcessId = GetCurrentProcessId();
+
+	// JSON array format: the closing bracket is optional, so that the events
+	// of the next launches can be appended.
+	if (GetFileAttributes( pwszPath ) == INVALID_FILE_ATTRIBUTES) appendText( &text, L"[\n" );
+
+	// Name the process track after the command
+	wchar_t* pwszEscaped = escapeJsonString( pwszCommandLine );
+	appendText( &text, L"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,"
+		L"\"args\":{\"name\":\"%ls %ls\"}},\n", dwProcessId, pwszProgram, pwszEscaped );
+	freeHeap( pwszEscaped );
+
+	for (int i = 0; i < getEventCount(); i++) {
+		const TimingEvent* pEvent = &timing.pEvents[ i ];
+		LONGLONG llEnd = pEvent->llEnd ? pEvent->llEnd : getCounter();
+
+		// Events on their own track (e.g. the child processes of a manifest)
+		DWORD dwTid = pEvent->dwThreadId;
+		BOOL bNamed = FALSE;
+		if (pEvent->dwTrack) {
+			dwTid = pEvent->dwTrack;
+
+			// Name the track once
+			for (int j = 0; j < i && ! bNamed; j++)
+				bNamed = timing.pEvents[ j ].dwTrack == dwTid;
+		}
+		if (pEvent->dwTrack && ! bNamed) {
+			wchar_t* pwszTrack = escapeJsonString( pEvent->wszTrackName );
+			appendText( &text, L"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,"
+				L"\"tid\":%lu,\"args\":{\"name\":\"%ls\"}},\n", dwProcessId, dwTid, pwszTrack );
+			freeHeap( pwszTrack );
+		}
+
+		appendText( &text, L"{\"name\":\"%ls\",\"cat\":\"%ls\",\"ph\":\"X\",\"pid\":%lu,"
+			L"\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"error\":\"0x%08lX\"",
+			pEvent->pwszName, pEvent->iPhase < 0 ? L"step" : L"phase", dwProcessId, dwTid,
+			toMilliseconds( pEvent->llBegin ) * 1000.0,
+			toMilliseconds( llEnd - pEvent->llBegin ) * 1000.0, pEvent->dwError );
+		if (pEvent->iStep) appendText( &text, L",\"step\":%d", pEvent->iStep );
+		appendText( &text, L"}},\n" );
+	}
+
+	BOOL bSuccess = text.pBuffer && appendTextFile( pwszPath, text.pBuffer );
+	if (text.pBuffer) freeHeap( text.pBuffer );
+	return bSuccess;
+}
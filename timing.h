@@ -0,0 +1,67 @@
+#pragma once
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	timing.h
+
+	Launch phase timing
+
+*/
+
+#include <windows.h>
+
+// Launch phases
+typedef enum {
+	PHASE_SEDEBUG,         // acquireSeDebugPrivilege
+	PHASE_SCM_OPEN,        // Open the SCM and the TrustedInstaller service
+	PHASE_TI_START,        // Start the TrustedInstaller service and wait for it
+	PHASE_TI_OPEN,         // Open the TrustedInstaller process
+	PHASE_TI_JOIN,         // Wait for the TrustedInstaller worker thread
+	PHASE_SYSTEM_CONTEXT,  // createSystemContext
+	PHASE_CHILD_TOKEN,     // createChildProcessToken
+	PHASE_PRIVILEGES,      // Set the privileges of the child process token
+	PHASE_CREATE_PROCESS,  // CreateProcessAsUser
+	PHASE_RESUME,          // Resume the child process
+	PHASE_CHILD_RUN,       // Child process run time
+	PHASE_COUNT
+} TimingPhase;
+
+// Enable the timing. The times are relative to this call.
+void startTiming( void );
+
+// Record the beginning of a phase.
+// Returns the event to pass to endPhase, or -1 if the timing is disabled.
+int beginPhase( TimingPhase phase );
+
+// Record the beginning of a step (Win32 call) within the current phase.
+// Returns the event to pass to endStep, or -1 if the timing is disabled.
+int beginStep( const wchar_t* pwszName );
+
+// Record the end of a phase.
+void endPhase( int iEvent );
+
+// Record the end of a phase, with its error code and error position (iStep).
+void endPhaseStep( int iEvent, DWORD dwError, int iStep );
+
+// Record the end of a step. If it failed, the last error is recorded (and kept).
+void endStep( int iEvent, BOOL bSuccess );
+
+// Show an event on its own track (e.g. a child process) in the trace.
+void setEventTrack( int iEvent, DWORD dwTrack, const wchar_t* pwszTrackName );
+
+// Show the duration of each phase.
+void showTimingReport( void );
+
+// Show the allocations, the peak heap usage and the open handles of each
+// phase, and of the whole process (even if the timing is disabled).
+void showMemoryReport( void );
+
+// Append the duration of each phase to a file, as a JSON line.
+BOOL writeTimingReport( const wchar_t* pwszPath, const wchar_t* pwszProgram,
+	const wchar_t* pwszCommandLine );
+
+// Append all the phases and steps to a trace file (trace event format).
+BOOL writeTraceEvents( const wchar_t* pwszPath, const wchar_t* pwszProgram,
+	const wchar_t* pwszCommandLine );
@@ -8,14 +8,31 @@
 
 	Tokens and privileges management functions
 
+	- tokens.c: privileges (all programs)
+	- tokens_system.c: system context and child process tokens (sudo,
+	  superUser)
+	- tokens_ti.c: TrustedInstaller process (all programs)
+
 */
 
 #include <windows.h>
 
+#include "privileges.h" // Privilege table and privilege sets
+
+// Default maximum time to wait for the TrustedInstaller service to start (ms)
+#define SERVICE_START_TIMEOUT_DEFAULT 30000
+
 typedef void (*MissingPrivilegeFunc)(const wchar_t* pwszPrivilege);
 
 int acquireSeDebugPrivilege( void );
+void beginTrustedInstallerProcess( void );
 int createChildProcessToken( HANDLE hBaseProcess, HANDLE* phNewToken );
 int createSystemContext( void );
+int duplicateChildProcessToken( HANDLE hToken, DWORD dwSessionId,
+	PrivilegeMask privileges, MissingPrivilegeFunc fnMPCb, HANDLE* phNewToken );
+BOOL enableTokenPrivilege( HANDLE hToken, int iPrivilege );
+void endTrustedInstallerProcess( void );
 int getTrustedInstallerProcess( HANDLE* phTIProcess );
-void setAllPrivileges( HANDLE hToken, MissingPrivilegeFunc fnMPCb );
+int prepareSystemLaunch( void );
+void setPrivileges( HANDLE hToken, PrivilegeMask privileges, MissingPrivilegeFunc fnMPCb );
+void setServiceStartTimeout( DWORD dwMilliseconds );
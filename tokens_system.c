@@ -0,0 +1,187 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	tokens_system.c
+
+	Tokens and privileges management functions: system context and child
+	process tokens
+
+*/
+
+#include "tokens.h"
+
+#include <windows.h>
+
+#include "backend.h" // Win32 backend
+#include "locator.h" // System process locator
+#include "output.h"  // Display functions
+#include "timing.h"  // Launch phase timing
+
+//
+// Acquire SeDebugPrivilege and create the system context, while the
+// TrustedInstaller process is got on a worker thread (joined by
+// getTrustedInstallerProcess). If the system context cannot be created, the
+// worker is joined before returning.
+//
+int prepareSystemLaunch( void )
+{
+	int errCode = acquireSeDebugPrivilege();
+	if (errCode) return errCode;
+
+	// Start the TrustedInstaller service while the system context is created
+	beginTrustedInstallerProcess();
+	errCode = createSystemContext();
+	if (errCode) endTrustedInstallerProcess();
+	return errCode;
+}
+
+
+int createSystemContext( void )
+{
+	DWORD dwLastError = 0;
+	int iStep = 1;
+	int iEvent = beginPhase( PHASE_SYSTEM_CONTEXT );
+
+	// Get the process id
+	int iStepEvent = beginStep( L"locateServicesProcess" );
+	DWORD dwSysPid = locateServicesProcess();
+	endStep( iStepEvent, dwSysPid != 0 );
+	if (! dwSysPid) dwLastError = GetLastError();
+
+	HANDLE hToken = NULL;
+
+	if (dwSysPid) {
+		iStep++;
+		iStepEvent = beginStep( L"OpenProcess" );
+		HANDLE hSysProcess = pBackend->fnOpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE,
+			dwSysPid );
+		endStep( iStepEvent, hSysProcess != NULL );
+		if (hSysProcess) {
+			iStep++;
+			// Get the process token
+			HANDLE hSysToken = NULL;
+			iStepEvent = beginStep( L"OpenProcessToken" );
+			BOOL bOpened = pBackend->fnOpenProcessToken( hSysProcess, TOKEN_DUPLICATE, &hSysToken );
+			endStep( iStepEvent, bOpened );
+			if (bOpened) {
+				iStep++;
+				iStepEvent = beginStep( L"DuplicateTokenEx" );
+				if (! pBackend->fnDuplicateTokenEx( hSysToken,
+					TOKEN_ADJUST_PRIVILEGES | TOKEN_IMPERSONATE, NULL,
+					SecurityImpersonation, TokenImpersonation, &hToken )) {
+					dwLastError = GetLastError();
+					hToken = NULL;
+				}
+				endStep( iStepEvent, hToken != NULL );
+				pBackend->fnCloseHandle( hSysToken );
+			}
+			else dwLastError = GetLastError();
+			pBackend->fnCloseHandle( hSysProcess );
+		}
+		else dwLastError = GetLastError();
+	}
+
+	BOOL bSuccess = FALSE;
+	if (hToken) {
+		iStep++;
+		if (enableTokenPrivilege( hToken, PRIVILEGE_ASSIGNPRIMARYTOKEN )) {
+			iStep++;
+			iStepEvent = beginStep( L"SetThreadToken" );
+			bSuccess = pBackend->fnSetThreadToken( NULL, hToken );
+			endStep( iStepEvent, bSuccess );
+		}
+		if (! bSuccess) dwLastError = GetLastError();
+		pBackend->fnCloseHandle( hToken );
+	}
+	endPhaseStep( iEvent, dwLastError, iStep );
+
+	if (! bSuccess) {
+		showError( L"Failed to create system context", dwLastError, iStep );
+		return 5;
+	}
+
+	return 0;
+}
+
+
+int createChildProcessToken( HANDLE hBaseProcess, HANDLE* phNewToken )
+{
+	DWORD dwLastError = 0;
+	int iStep = 1;
+	int iEvent = beginPhase( PHASE_CHILD_TOKEN );
+	*phNewToken = NULL;
+
+	// Get the base process token
+	HANDLE hBaseToken = NULL;
+	int iStepEvent = beginStep( L"OpenProcessToken" );
+	BOOL bOpened = pBackend->fnOpenProcessToken( hBaseProcess, TOKEN_DUPLICATE, &hBaseToken );
+	endStep( iStepEvent, bOpened );
+	if (bOpened) {
+		iStep++;
+		iStepEvent = beginStep( L"DuplicateTokenEx" );
+		if (! pBackend->fnDuplicateTokenEx( hBaseToken,
+			TOKEN_ADJUST_DEFAULT | TOKEN_ADJUST_PRIVILEGES | TOKEN_ADJUST_SESSIONID |
+			TOKEN_ASSIGN_PRIMARY | TOKEN_DUPLICATE | TOKEN_QUERY,
+			NULL,
+			SecurityIdentification, TokenPrimary, phNewToken )) {
+			dwLastError = GetLastError();
+			*phNewToken = NULL;
+		}
+		endStep( iStepEvent, *phNewToken != NULL );
+		pBackend->fnCloseHandle( hBaseToken );
+	}
+	else dwLastError = GetLastError();
+	endPhaseStep( iEvent, dwLastError, iStep );
+
+	if (! *phNewToken) {
+		showError( L"Failed to create child process token", dwLastError, iStep );
+		return 5;
+	}
+
+	return 0;
+}
+
+
+int duplicateChildProcessToken( HANDLE hToken, DWORD dwSessionId,
+	PrivilegeMask privileges, MissingPrivilegeFunc fnMPCb, HANDLE* phNewToken )
+{
+	DWORD dwLastError = 0;
+	int iStep = 1;
+
+	// Duplicate the token created by createChildProcessToken, so that it can be
+	// reused for several child processes.
+	int iEvent = beginPhase( PHASE_CHILD_TOKEN );
+	int iStepEvent = beginStep( L"DuplicateTokenEx" );
+	BOOL bDuplicated = pBackend->fnDuplicateTokenEx( hToken,
+		TOKEN_ADJUST_DEFAULT | TOKEN_ADJUST_PRIVILEGES | TOKEN_ADJUST_SESSIONID |
+		TOKEN_ASSIGN_PRIMARY | TOKEN_QUERY,
+		NULL,
+		SecurityIdentification, TokenPrimary, phNewToken );
+	endStep( iStepEvent, bDuplicated );
+	if (! bDuplicated) {
+		dwLastError = GetLastError();
+		*phNewToken = NULL;
+		endPhaseStep( iEvent, dwLastError, iStep );
+		showError( L"Failed to create child process token", dwLastError, iStep );
+		// Writing the message may have changed the last error: the broker
+		// returns it to its client
+		SetLastError( dwLastError );
+		return 5;
+	}
+
+	// Set the session id in the token
+	if (dwSessionId != (DWORD) -1) {
+		iStepEvent = beginStep( L"SetTokenInformation" );
+		BOOL bSet = pBackend->fnSetTokenInformation( *phNewToken, TokenSessionId,
+			(PVOID) &dwSessionId, sizeof( DWORD ) );
+		endStep( iStepEvent, bSet );
+	}
+	endPhase( iEvent );
+
+	// Set the privileges in the token
+	setPrivileges( *phNewToken, privileges, fnMPCb );
+
+	return 0;
+}
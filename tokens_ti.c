@@ -0,0 +1,417 @@
+/*
+	superUser 6.2
+
+	Copyright 2019-2026 https://github.com/mspaintmsi/superUser
+
+	tokens_ti.c
+
+	Tokens and privileges management functions: TrustedInstaller process
+
+	Starting the TrustedInstaller service is the slowest step of a launch on
+	a cold system, and it does not depend on the system context: the
+	TrustedInstaller process can be got on a worker thread
+	(beginTrustedInstallerProcess) while the calling thread goes on with the
+	setup, and joined by getTrustedInstallerProcess.
+
+*/
+
+#include "tokens.h"
+
+#define CUSTOM_ERROR_SERVICE_START_FAILED 0xA0001001
+
+#include <wchar.h>
+#include <windows.h>
+
+#include "backend.h" // Win32 backend
+#include "output.h"  // Display functions
+#include "timing.h"  // Launch phase timing
+
+// Maximum time to wait for the TrustedInstaller service to start (ms)
+static DWORD dwServiceStartTimeout = SERVICE_START_TIMEOUT_DEFAULT;
+
+// Maximum number of StartService calls (the service may stop right after starting)
+#define SERVICE_START_MAX_ATTEMPTS 3
+
+// Worker getting the TrustedInstaller process (see beginTrustedInstallerProcess)
+static struct {
+	HANDLE hThread;   // NULL if no worker is running
+	HANDLE hProcess;  // Result of the worker
+	int errCode;
+} tiWorker = {0};
+
+// Notification context, set by the service status change callback
+typedef struct {
+	SERVICE_NOTIFY notify;
+	BOOL bTriggered;
+} ServiceNotifyContext;
+
+
+static void CALLBACK onServiceStatusChange( PVOID pParameter )
+{
+	// The parameter is the SERVICE_NOTIFY structure, first member of the context
+	((ServiceNotifyContext*) pParameter)->bTriggered = TRUE;
+}
+
+
+//
+// Wait for the service state to change, until the deadline.
+//
+// The status notification is used if available. Otherwise (or if it fails),
+// the status is polled at intervals based on the wait hint of the service.
+// pStatus is updated with the new status.
+//
+static BOOL waitServiceStatusChange( SC_HANDLE hService, ServiceNotifyContext* pContext,
+	BOOL* pbUseNotify, SERVICE_STATUS_PROCESS* pStatus, DWORD* pdwPollDelay,
+	ULONGLONG ullDeadline )
+{
+	ULONGLONG ullNow = pBackend->fnGetTickCount64();
+	if (ullNow >= ullDeadline) return FALSE;
+	DWORD dwRemaining = (DWORD) (ullDeadline - ullNow);
+
+	if (*pbUseNotify) {
+		// Be notified of any state other than the current one
+		DWORD dwCurrentMask = 1 << (pStatus->dwCurrentState - 1);
+		DWORD dwMask = (SERVICE_NOTIFY_STOPPED | SERVICE_NOTIFY_START_PENDING |
+			SERVICE_NOTIFY_STOP_PENDING | SERVICE_NOTIFY_RUNNING |
+			SERVICE_NOTIFY_CONTINUE_PENDING | SERVICE_NOTIFY_PAUSE_PENDING |
+			SERVICE_NOTIFY_PAUSED) & ~dwCurrentMask;
+
+		ZeroMemory( pContext, sizeof( ServiceNotifyContext ) );
+		pContext->notify.dwVersion = SERVICE_NOTIFY_STATUS_CHANGE;
+		pContext->notify.pfnNotifyCallback = onServiceStatusChange;
+		pContext->notify.pContext = pContext;
+
+		DWORD dwError = pBackend->fnNotifyServiceStatusChange( hService, dwMask,
+			&pContext->notify );
+		if (dwError == ERROR_SUCCESS) {
+			// The callback is called by an alertable wait
+			while (! pContext->bTriggered && dwRemaining) {
+				pBackend->fnSleepEx( dwRemaining, TRUE );
+				ullNow = pBackend->fnGetTickCount64();
+				dwRemaining = ullNow < ullDeadline ? (DWORD) (ullDeadline - ullNow) : 0;
+			}
+			if (! pContext->bTriggered) return FALSE;
+
+			if (pContext->notify.dwNotificationStatus == ERROR_SUCCESS) {
+				*pStatus = pContext->notify.ServiceStatus;
+				return TRUE;
+			}
+			dwError = pContext->notify.dwNotificationStatus;
+		}
+
+		showFmtVerbose( L"Service notification unavailable (error 0x%lX), polling",
+			dwError );
+		*pbUseNotify = FALSE;
+	}
+
+	// Poll the status. Use a tenth of the wait hint (between 100 ms and 1 s),
+	// or an increasing delay if the service gives no hint.
+	DWORD dwDelay;
+	if (pStatus->dwWaitHint) {
+		dwDelay = pStatus->dwWaitHint / 10;
+		if (dwDelay < 100) dwDelay = 100;
+		else if (dwDelay > 1000) dwDelay = 1000;
+	}
+	else {
+		dwDelay = *pdwPollDelay;
+		if (*pdwPollDelay < 1000) *pdwPollDelay *= 2;
+	}
+	pBackend->fnSleep( dwDelay < dwRemaining ? dwDelay : dwRemaining );
+
+	DWORD dwBytesNeeded;
+	return pBackend->fnQueryServiceStatusEx( hService, SC_STATUS_PROCESS_INFO,
+		(LPBYTE) pStatus, sizeof( SERVICE_STATUS_PROCESS ), &dwBytesNeeded );
+}
+
+
+//
+// Start a service and wait until it is running, or until the timeout expires.
+//
+// If the service is stopping, it is started again once stopped.
+// Returns the process id of the service, or 0 if an error occurs (the last
+// error is set).
+//
+static DWORD startService( SC_HANDLE hService, ServiceNotifyContext* pContext )
+{
+	ULONGLONG ullDeadline = pBackend->fnGetTickCount64() + dwServiceStartTimeout;
+	BOOL bUseNotify = TRUE;
+	DWORD dwPollDelay = 25;
+	int nStartAttempts = 0;
+	SERVICE_STATUS_PROCESS status = {0};
+	DWORD dwBytesNeeded;
+
+	if (! pBackend->fnQueryServiceStatusEx( hService, SC_STATUS_PROCESS_INFO, (LPBYTE) &status,
+		sizeof( SERVICE_STATUS_PROCESS ), &dwBytesNeeded ))
+		return 0;
+
+	for (;;) {
+		showFmtVerbose( L"TrustedInstaller service state: %lu (checkpoint %lu, hint %lu ms)",
+			status.dwCurrentState, status.dwCheckPoint, status.dwWaitHint );
+
+		switch (status.dwCurrentState) {
+		case SERVICE_RUNNING:
+			if (status.dwProcessId) return status.dwProcessId;
+			// The process id is not set yet: poll the status (see below)
+			break;
+
+		case SERVICE_STOPPED:
+			if (nStartAttempts == SERVICE_START_MAX_ATTEMPTS) {
+				DWORD dwError = status.dwWin32ExitCode;
+				SetLastError( dwError ? dwError : CUSTOM_ERROR_SERVICE_START_FAILED );
+				return 0;
+			}
+			nStartAttempts++;
+			int iStepEvent = beginStep( L"StartService" );
+			BOOL bStarted = pBackend->fnStartService( hService, 0, NULL ) ||
+				GetLastError() == ERROR_SERVICE_ALREADY_RUNNING;
+			endStep( iStepEvent, bStarted );
+			if (! bStarted) return 0;
+			dwPollDelay = 25;
+			if (! pBackend->fnQueryServiceStatusEx( hService, SC_STATUS_PROCESS_INFO,
+				(LPBYTE) &status, sizeof( SERVICE_STATUS_PROCESS ), &dwBytesNeeded ))
+				return 0;
+			continue;
+
+		case SERVICE_PAUSE_PENDING:
+		case SERVICE_PAUSED:
+			// Cannot be started
+			SetLastError( CUSTOM_ERROR_SERVICE_START_FAILED );
+			return 0;
+
+		default:
+			// START_PENDING, CONTINUE_PENDING, STOP_PENDING: wait for the next state
+			break;
+		}
+
+		// A running service has no other state to be notified of (the current
+		// one is excluded): its process id is polled.
+		BOOL bPoll = status.dwCurrentState == SERVICE_RUNNING;
+		BOOL bNotify = bUseNotify && ! bPoll;
+
+		int iStepEvent = beginStep( L"Wait for service state" );
+		BOOL bChanged = waitServiceStatusChange( hService, pContext, &bNotify, &status,
+			&dwPollDelay, ullDeadline );
+		endStep( iStepEvent, bChanged );
+		if (! bPoll) bUseNotify = bNotify;
+		if (! bChanged) {
+			if (pBackend->fnGetTickCount64() >= ullDeadline)
+				SetLastError( ERROR_SERVICE_REQUEST_TIMEOUT );
+			return 0;
+		}
+	}
+}
+
+
+// Access to the TrustedInstaller process: create child processes, and
+// duplicate the handles they inherit
+#define TI_PROCESS_ACCESS \
+	(PROCESS_CREATE_PROCESS | PROCESS_DUP_HANDLE | PROCESS_QUERY_INFORMATION)
+
+// Cache of the TrustedInstaller process: a volatile registry key (deleted at
+// reboot), writable by the administrators only.
+#define TI_CACHE_KEY L"SOFTWARE\\superUser.cache"
+#define TI_CACHE_VALUE L"TrustedInstaller"
+
+typedef struct {
+	DWORD dwProcessId;
+	FILETIME ftCreationTime;
+} TIProcessCache;
+
+
+//
+// Open the TrustedInstaller process recorded in the cache, after checking that
+// it is still the same process (creation time and image name).
+//
+// Returns NULL if the cache is empty or outdated.
+//
+static HANDLE openCachedTIProcess( void )
+{
+	TIProcessCache cache = {0};
+	DWORD dwSize = sizeof( cache );
+	HKEY hKey = NULL;
+
+	if (pBackend->fnRegOpenKeyEx( HKEY_LOCAL_MACHINE, TI_CACHE_KEY, 0,
+		KEY_QUERY_VALUE | KEY_WOW64_64KEY, &hKey ) != ERROR_SUCCESS)
+		return NULL;
+	LSTATUS status = pBackend->fnRegQueryValueEx( hKey, TI_CACHE_VALUE, NULL, NULL,
+		(LPBYTE) &cache, &dwSize );
+	pBackend->fnRegCloseKey( hKey );
+	if (status != ERROR_SUCCESS || dwSize != sizeof( cache )) return NULL;
+
+	HANDLE hProcess = pBackend->fnOpenProcess( TI_PROCESS_ACCESS, FALSE, cache.dwProcessId );
+	if (! hProcess) return NULL;
+
+	// The process id may have been reused: compare the creation time
+	FILETIME ftCreation, ftExit, ftKernel, ftUser;
+	DWORD dwExitCode = 0;
+	BOOL bValid = pBackend->fnGetProcessTimes( hProcess, &ftCreation, &ftExit, &ftKernel,
+		&ftUser ) &&
+		! CompareFileTime( &ftCreation, &cache.ftCreationTime ) &&
+		pBackend->fnGetExitCodeProcess( hProcess, &dwExitCode ) && dwExitCode == STILL_ACTIVE;
+
+	// Check the image name
+	if (bValid) {
+		wchar_t wszImageName[ MAX_PATH ];
+		DWORD cchImageName = MAX_PATH;
+		const size_t cchSuffix = sizeof( L"\\TrustedInstaller.exe" ) / sizeof( wchar_t ) - 1;
+		bValid = pBackend->fnQueryFullProcessImageName( hProcess, 0, wszImageName,
+			&cchImageName ) &&
+			cchImageName >= cchSuffix &&
+			! _wcsicmp( wszImageName + cchImageName - cchSuffix, L"\\TrustedInstaller.exe" );
+	}
+
+	if (! bValid) {
+		pBackend->fnCloseHandle( hProcess );
+		return NULL;
+	}
+	return hProcess;
+}
+
+
+//
+// Record the TrustedInstaller process in the cache.
+//
+static void cacheTIProcess( HANDLE hProcess, DWORD dwProcessId )
+{
+	TIProcessCache cache = { .dwProcessId = dwProcessId };
+	FILETIME ftExit, ftKernel, ftUser;
+	if (! pBackend->fnGetProcessTimes( hProcess, &cache.ftCreationTime, &ftExit, &ftKernel,
+		&ftUser ))
+		return;
+
+	HKEY hKey = NULL;
+	if (pBackend->fnRegCreateKeyEx( HKEY_LOCAL_MACHINE, TI_CACHE_KEY, 0, NULL,
+		REG_OPTION_VOLATILE, KEY_SET_VALUE | KEY_WOW64_64KEY, NULL, &hKey,
+		NULL ) == ERROR_SUCCESS) {
+		pBackend->fnRegSetValueEx( hKey, TI_CACHE_VALUE, 0, REG_BINARY, (const BYTE*) &cache,
+			sizeof( cache ) );
+		pBackend->fnRegCloseKey( hKey );
+	}
+}
+
+
+void setServiceStartTimeout( DWORD dwMilliseconds )
+{
+	dwServiceStartTimeout = dwMilliseconds;
+}
+
+
+//
+// Get the TrustedInstaller process: from the cache, or by starting the service.
+//
+static int openTrustedInstallerProcess( HANDLE* phTIProcess )
+{
+	DWORD dwLastError = 0;
+	int iStep = 1;
+	HANDLE hSCManager, hTIService;
+	DWORD dwProcessId = 0;
+
+	// Must remain valid while a status notification may be pending
+	ServiceNotifyContext notifyContext;
+
+	// Fast path: the TrustedInstaller process is still running
+	int iEvent = beginPhase( PHASE_TI_OPEN );
+	*phTIProcess = openCachedTIProcess();
+	endPhase( iEvent );
+	if (*phTIProcess) {
+		showFmtVerbose( L"TrustedInstaller process cache hit (PID %lu)",
+			pBackend->fnGetProcessId( *phTIProcess ) );
+		return 0;
+	}
+	showFmtVerbose( L"TrustedInstaller process cache miss" );
+
+	SetLastError( 0 );
+
+	iEvent = beginPhase( PHASE_SCM_OPEN );
+	int iStepEvent = beginStep( L"OpenSCManager" );
+	hSCManager = pBackend->fnOpenSCManager( NULL, NULL, SC_MANAGER_CONNECT );
+	endStep( iStepEvent, hSCManager != NULL );
+	iStepEvent = beginStep( L"OpenService" );
+	hTIService = pBackend->fnOpenService( hSCManager, L"TrustedInstaller",
+		SERVICE_QUERY_STATUS | SERVICE_START );
+	endStep( iStepEvent, hTIService != NULL );
+	endPhaseStep( iEvent, hTIService ? 0 : GetLastError(), iStep );
+
+	// Start the TrustedInstaller service
+	if (hTIService) {
+		iStep++;
+		iEvent = beginPhase( PHASE_TI_START );
+		dwProcessId = startService( hTIService, &notifyContext );
+		endPhaseStep( iEvent, dwProcessId ? 0 : GetLastError(), iStep );
+	}
+
+	if (! dwProcessId) {
+		dwLastError = GetLastError();
+		if (dwLastError == 0) dwLastError = CUSTOM_ERROR_SERVICE_START_FAILED;
+	}
+
+	// Closing the service handle cancels a pending notification
+	pBackend->fnCloseServiceHandle( hSCManager );
+	pBackend->fnCloseServiceHandle( hTIService );
+	pBackend->fnSleepEx( 0, TRUE );
+
+	*phTIProcess = NULL;
+
+	if (dwProcessId) {
+		iStep++;
+		// Get the TrustedInstaller process handle
+		iEvent = beginPhase( PHASE_TI_OPEN );
+		*phTIProcess = pBackend->fnOpenProcess( TI_PROCESS_ACCESS, FALSE, dwProcessId );
+		endPhaseStep( iEvent, *phTIProcess ? 0 : GetLastError(), iStep );
+		if (*phTIProcess) cacheTIProcess( *phTIProcess, dwProcessId );
+		else dwLastError = GetLastError();
+	}
+
+	if (! *phTIProcess) {
+		showError( L"Failed to open TrustedInstaller process", dwLastError, iStep );
+		return 3;
+	}
+
+	return 0;
+}
+
+
+static DWORD WINAPI runTIWorker( LPVOID pParameter )
+{
+	tiWorker.errCode = openTrustedInstallerProcess( &tiWorker.hProcess );
+	return 0;
+}
+
+
+//
+// Start getting the TrustedInstaller process on a worker thread.
+// SeDebugPrivilege must be enabled first (to open the process).
+//
+void beginTrustedInstallerProcess( void )
+{
+	// If the thread cannot be created, getTrustedInstallerProcess does the work
+	tiWorker.hThread = CreateThread( NULL, 0, &runTIWorker, NULL, 0, NULL );
+}
+
+
+int getTrustedInstallerProcess( HANDLE* phTIProcess )
+{
+	if (! tiWorker.hThread) return openTrustedInstallerProcess( phTIProcess );
+
+	// Join the worker
+	int iEvent = beginPhase( PHASE_TI_JOIN );
+	WaitForSingleObject( tiWorker.hThread, INFINITE );
+	endPhase( iEvent );
+	CloseHandle( tiWorker.hThread );
+	tiWorker.hThread = NULL;
+
+	*phTIProcess = tiWorker.hProcess;
+	return tiWorker.errCode;
+}
+
+
+//
+// Join the worker started by beginTrustedInstallerProcess when the launch is
+// abandoned, and close the TrustedInstaller process handle it got.
+//
+void endTrustedInstallerProcess( void )
+{
+	HANDLE hTIProcess = NULL;
+	if (tiWorker.hThread && ! getTrustedInstallerProcess( &hTIProcess ))
+		pBackend->fnCloseHandle( hTIProcess );
+}
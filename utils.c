@@ -7,35 +7,209 @@
 
 	Utility functions
 
-	- Memory allocation
+	- Memory allocation (process heap, arenas) and accounting
 	- String formatting
+	- Text file reading and writing
+	- JSON string escaping
+
+	Each block starts with a header which tells freeHeap whether it belongs to
+	an arena. The blocks of an arena are carved from chunks, allocated from
+	the heap when the current one is full; the blocks larger than a quarter of
+	a chunk are still allocated from the heap, so that a chunk is never wasted.
+	The current arena of each thread is kept in a TLS slot: the threads which
+	never open one (workers, thread pool callbacks) use the heap.
 
 */
 
+#include "utils.h"
+
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <wchar.h>
 #include <windows.h>
 
+// Round a size up to the heap alignment
+#define ALIGN_SIZE( n ) \
+	(((n) + MEMORY_ALLOCATION_ALIGNMENT - 1) & ~((SIZE_T) MEMORY_ALLOCATION_ALIGNMENT - 1))
+
+// Header of a block (two pointers: the heap alignment is kept)
+typedef struct {
+	SIZE_T nSize;   // Size of the block, header included
+	SIZE_T bArena;  // The block belongs to an arena
+} BlockHeader;
+
+// Header of an arena chunk, followed by the blocks
+typedef struct ArenaChunk {
+	struct ArenaChunk* pPrevious;
+	SIZE_T nSize;  // Size of the chunk, header included
+	SIZE_T nUsed;  // Size of the header and of the blocks
+	SIZE_T nReserved;
+} ArenaChunk;
+
+static volatile MemoryStats memoryStats = {0};
+
+// TLS slot of the current arena of the threads
+static volatile LONG nArenaSlot = (LONG) TLS_OUT_OF_INDEXES;
+
+
+static void addLiveBytes( LONG nBytes )
+{
+	LONG nLive = InterlockedExchangeAdd( &memoryStats.nLiveBytes, nBytes ) + nBytes;
+	LONG nPeak = memoryStats.nPeakBytes;
+	while (nLive > nPeak) {
+		LONG nInitial = InterlockedCompareExchange( &memoryStats.nPeakBytes, nLive, nPeak );
+		if (nInitial == nPeak) break;
+		nPeak = nInitial;
+	}
+}
+
+
+static LPVOID allocHeapBlock( DWORD dwFlags, SIZE_T nSize )
+{
+	LPVOID p = HeapAlloc( GetProcessHeap(), dwFlags, nSize );
+	if (! p) abort();
+	InterlockedIncrement( &memoryStats.nHeapAllocations );
+	addLiveBytes( (LONG) nSize );
+	return p;
+}
+
+
+static Arena* getCurrentArena( void )
+{
+	if (nArenaSlot == (LONG) TLS_OUT_OF_INDEXES) return NULL;
+
+	// TlsGetValue clears the last error, which the caller may not have read yet
+	DWORD dwError = GetLastError();
+	Arena* pArena = TlsGetValue( (DWORD) nArenaSlot );
+	SetLastError( dwError );
+	return pArena;
+}
+
+
+//
+// Allocate a block from an arena (nSize: aligned, header included).
+//
+static BlockHeader* allocArenaBlock( Arena* pArena, SIZE_T nSize )
+{
+	ArenaChunk* pChunk = pArena->pChunk;
+	if (! pChunk || pChunk->nSize - pChunk->nUsed < nSize) {
+		// Chain a new chunk
+		pChunk = allocHeapBlock( 0, pArena->nChunkSize );
+		pChunk->pPrevious = pArena->pChunk;
+		pChunk->nSize = pArena->nChunkSize;
+		pChunk->nUsed = sizeof( ArenaChunk );
+		pArena->pChunk = pChunk;
+		pArena->nChunks++;
+	}
+
+	BlockHeader* pHeader = (BlockHeader*) ((BYTE*) pChunk + pChunk->nUsed);
+	pChunk->nUsed += nSize;
+	pArena->nBlocks++;
+	pArena->nUsedBytes += nSize;
+	return pHeader;
+}
+
+
 //
-// Allocate a block of memory from the process heap.
+// Allocate a block of memory from the arena of the thread, or from the
+// process heap.
 //
 // dwFlags: 0 or HEAP_ZERO_MEMORY
 //
 __declspec(noinline) LPVOID allocHeap( DWORD dwFlags, SIZE_T dwBytes )
 {
-	LPVOID p = HeapAlloc( GetProcessHeap(), dwFlags, dwBytes );
-	if (! p) abort();
-	return p;
+	InterlockedIncrement( &memoryStats.nAllocations );
+
+	SIZE_T nSize = sizeof( BlockHeader ) + ALIGN_SIZE( dwBytes );
+	if (nSize < dwBytes) abort();
+	BlockHeader* pHeader;
+	Arena* pArena = getCurrentArena();
+	if (pArena && nSize <= pArena->nChunkSize / 4) {
+		pHeader = allocArenaBlock( pArena, nSize );
+		if (dwFlags & HEAP_ZERO_MEMORY) ZeroMemory( pHeader + 1, dwBytes );
+		pHeader->bArena = TRUE;
+	}
+	else {
+		pHeader = allocHeapBlock( dwFlags, nSize );
+		pHeader->bArena = FALSE;
+	}
+	pHeader->nSize = nSize;
+	return pHeader + 1;
 }
 
 
 //
-// Free a block of memory allocated from the process heap.
+// Free a block of memory allocated by allocHeap.
+//
+// The blocks of an arena are only released with the arena.
 //
 __declspec(noinline) void freeHeap( LPVOID lpMem )
 {
-	HeapFree( GetProcessHeap(), 0, lpMem );
+	if (! lpMem) return;
+	InterlockedIncrement( &memoryStats.nFrees );
+
+	BlockHeader* pHeader = (BlockHeader*) lpMem - 1;
+	if (pHeader->bArena) return;
+	addLiveBytes( -(LONG) pHeader->nSize );
+	HeapFree( GetProcessHeap(), 0, pHeader );
+}
+
+
+//
+// Open an arena, which becomes the arena of the calling thread.
+//
+// nChunkSize: size of the chunks, allocated when needed
+// If no TLS slot is available, the blocks are allocated from the heap.
+//
+void openArena( Arena* pArena, SIZE_T nChunkSize )
+{
+	ZeroMemory( pArena, sizeof( Arena ) );
+	pArena->nChunkSize = ALIGN_SIZE( nChunkSize );
+
+	if (nArenaSlot == (LONG) TLS_OUT_OF_INDEXES) {
+		DWORD dwSlot = TlsAlloc();
+		if (dwSlot == TLS_OUT_OF_INDEXES) return;
+		// Another thread may have allocated the slot meanwhile
+		if (InterlockedCompareExchange( &nArenaSlot, (LONG) dwSlot,
+			(LONG) TLS_OUT_OF_INDEXES ) != (LONG) TLS_OUT_OF_INDEXES) TlsFree( dwSlot );
+	}
+
+	pArena->pPrevious = getCurrentArena();
+	TlsSetValue( (DWORD) nArenaSlot, pArena );
+}
+
+
+//
+// Release all the blocks of an arena, and restore the previous arena of the
+// thread.
+//
+void closeArena( Arena* pArena )
+{
+	ArenaChunk* pChunk = pArena->pChunk;
+	while (pChunk) {
+		ArenaChunk* pPrevious = pChunk->pPrevious;
+		addLiveBytes( -(LONG) pChunk->nSize );
+		HeapFree( GetProcessHeap(), 0, pChunk );
+		pChunk = pPrevious;
+	}
+	pArena->pChunk = NULL;
+
+	if (nArenaSlot != (LONG) TLS_OUT_OF_INDEXES)
+		TlsSetValue( (DWORD) nArenaSlot, pArena->pPrevious );
+}
+
+
+//
+// Get the memory usage of the process.
+//
+void getMemoryStats( MemoryStats* pStats )
+{
+	pStats->nAllocations = memoryStats.nAllocations;
+	pStats->nFrees = memoryStats.nFrees;
+	pStats->nHeapAllocations = memoryStats.nHeapAllocations;
+	pStats->nLiveBytes = memoryStats.nLiveBytes;
+	pStats->nPeakBytes = memoryStats.nPeakBytes;
 }
 
 
@@ -61,3 +235,163 @@ wchar_t* v_printFmtString( const wchar_t* pwszFormat, va_list arg_list )
 
 	return pBuffer;
 }
+
+
+//
+// Copy a string to a new string.
+//
+// The caller must use freeHeap to free the returned string.
+//
+wchar_t* duplicateString( const wchar_t* pwszString )
+{
+	size_t nSize = (wcslen( pwszString ) + 1) * sizeof( wchar_t );
+	wchar_t* pBuffer = allocHeap( 0, nSize );
+	memcpy( pBuffer, pwszString, nSize );
+	return pBuffer;
+}
+
+
+//
+// Print a formatted string with variable arguments to a new string.
+//
+// The caller must use freeHeap to free the returned string.
+// Returns NULL if an error occurs.
+//
+wchar_t* printFmtString( const wchar_t* pwszFormat, ... )
+{
+	va_list args;
+	va_start( args, pwszFormat );
+	wchar_t* pBuffer = v_printFmtString( pwszFormat, args );
+	va_end( args );
+	return pBuffer;
+}
+
+
+//
+// Read a whole text file (UTF-8 or UTF-16LE with BOM) to a new string.
+//
+// The caller must use freeHeap to free the returned string.
+// Returns NULL if an error occurs (the last error is set).
+//
+wchar_t* readTextFile( const wchar_t* pwszPath )
+{
+	HANDLE hFile = CreateFile( pwszPath, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if (hFile == INVALID_HANDLE_VALUE) return NULL;
+
+	wchar_t* pwszText = NULL;
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx( hFile, &fileSize )) {
+		if (fileSize.QuadPart >= 0x10000000) SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+		else {
+			DWORD dwSize = (DWORD) fileSize.QuadPart;
+			BYTE* pData = allocHeap( 0, dwSize + sizeof( wchar_t ) );
+			DWORD dwRead = 0;
+			if (ReadFile( hFile, pData, dwSize, &dwRead, NULL )) {
+				if (dwRead >= 2 && pData[ 0 ] == 0xFF && pData[ 1 ] == 0xFE) {
+					// UTF-16LE: remove the BOM
+					DWORD cchText = (dwRead - 2) / sizeof( wchar_t );
+					pwszText = allocHeap( 0, (cchText + 1) * sizeof( wchar_t ) );
+					memcpy( pwszText, pData + 2, cchText * sizeof( wchar_t ) );
+					pwszText[ cchText ] = L'\0';
+				}
+				else {
+					// UTF-8: remove the BOM (if it exists) and convert
+					char* pBegin = (char*) pData;
+					if (dwRead >= 3 && pData[ 0 ] == 0xEF && pData[ 1 ] == 0xBB &&
+						pData[ 2 ] == 0xBF) {
+						pBegin += 3;
+						dwRead -= 3;
+					}
+					int cchText = dwRead ? MultiByteToWideChar( CP_UTF8, 0, pBegin, dwRead,
+						NULL, 0 ) : 0;
+					if (cchText || ! dwRead) {
+						pwszText = allocHeap( 0, (cchText + 1) * sizeof( wchar_t ) );
+						if (cchText) MultiByteToWideChar( CP_UTF8, 0, pBegin, dwRead,
+							pwszText, cchText );
+						pwszText[ cchText ] = L'\0';
+					}
+				}
+			}
+			freeHeap( pData );
+		}
+	}
+
+	CloseHandle( hFile );
+	return pwszText;
+}
+
+
+//
+// Append a string to a text file (UTF-8). The file is created if it does not exist.
+//
+// Returns FALSE if an error occurs (the last error is set).
+//
+BOOL appendTextFile( const wchar_t* pwszPath, const wchar_t* pwszText )
+{
+	int nSize = WideCharToMultiByte( CP_UTF8, 0, pwszText, -1, NULL, 0, NULL, NULL );
+	if (nSize <= 0) return FALSE;
+	char* pBuffer = allocHeap( 0, nSize );
+	WideCharToMultiByte( CP_UTF8, 0, pwszText, -1, pBuffer, nSize, NULL, NULL );
+
+	BOOL bSuccess = FALSE;
+	HANDLE hFile = CreateFile( pwszPath, FILE_APPEND_DATA, FILE_SHARE_READ, NULL,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if (hFile != INVALID_HANDLE_VALUE) {
+		DWORD dwWritten = 0;
+		bSuccess = WriteFile( hFile, pBuffer, nSize - 1, &dwWritten, NULL );
+		CloseHandle( hFile );
+	}
+
+	freeHeap( pBuffer );
+	return bSuccess;
+}
+
+
+//
+// Escape a string to be inserted between quotes in a JSON document.
+//
+// The caller must use freeHeap to free the returned string.
+//
+wchar_t* escapeJsonString( const wchar_t* pwszString )
+{
+	// The worst case is a control character, escaped as \uXXXX (6 chars)
+	wchar_t* pBuffer = allocHeap( 0, (wcslen( pwszString ) * 6 + 1) * sizeof( wchar_t ) );
+	wchar_t* q = pBuffer;
+
+	for (const wchar_t* p = pwszString; *p; p++) {
+		switch (*p) {
+		case L'"':
+		case L'\\':
+			*q++ = L'\\';
+			*q++ = *p;
+			break;
+		case L'\n':
+			*q++ = L'\\';
+			*q++ = L'n';
+			break;
+		case L'\r':
+			*q++ = L'\\';
+			*q++ = L'r';
+			break;
+		case L'\t':
+			*q++ = L'\\';
+			*q++ = L't';
+			break;
+		default:
+			if (*p < 0x20) {
+				// Other control characters: \u00XX
+				static const wchar_t awcHex[] = L"0123456789abcdef";
+				memcpy( q, L"\\u00", 4 * sizeof( wchar_t ) );
+				q[ 4 ] = awcHex[ *p >> 4 ];
+				q[ 5 ] = awcHex[ *p & 0xF ];
+				q += 6;
+			}
+			else *q++ = *p;
+			break;
+		}
+	}
+	*q = L'\0';
+
+	return pBuffer;
+}
@@ -8,23 +8,93 @@
 
 	Utility functions
 
-	- Memory allocation
+	- Memory allocation (process heap, arenas) and accounting
 	- String formatting
+	- Text file reading and writing
+	- JSON string escaping
 
 */
 
 #include <stdarg.h>
 #include <windows.h>
 
-// Allocate a block of memory from the process heap.
+// Size of the chunks of the arena of a launch
+#define LAUNCH_ARENA_SIZE (16 * 1024)
+
+// Memory arena: the small blocks allocated by a thread while its arena is
+// open are carved from large chunks, all released when the arena is closed.
+typedef struct Arena {
+	struct ArenaChunk* pChunk;  // Current chunk (the previous ones are chained)
+	SIZE_T nChunkSize;
+	struct Arena* pPrevious;    // Arena of the thread when this one was opened
+	LONG nBlocks;               // Number of blocks allocated from the arena
+	LONG nChunks;               // Number of chunks allocated from the heap
+	SIZE_T nUsedBytes;          // Size of the blocks (headers included)
+} Arena;
+
+// Memory usage of the process (allocHeap and freeHeap only)
+typedef struct {
+	LONG nAllocations;      // Number of allocHeap calls
+	LONG nFrees;            // Number of freeHeap calls
+	LONG nHeapAllocations;  // Number of heap blocks (arena chunks included)
+	LONG nLiveBytes;        // Size of the heap blocks in use
+	LONG nPeakBytes;        // Maximum of nLiveBytes
+} MemoryStats;
+
+// Allocate a block of memory from the arena of the thread, or from the
+// process heap.
 LPVOID allocHeap( DWORD dwFlags, SIZE_T dwBytes );
 
-// Free a block of memory allocated from the process heap.
+// Free a block of memory allocated by allocHeap (the blocks of an arena are
+// only released with the arena).
 void freeHeap( LPVOID lpMem );
 
+// Open an arena, which becomes the arena of the calling thread.
+// The arenas of a thread are closed in the reverse order.
+void openArena( Arena* pArena, SIZE_T nChunkSize );
+
+// Release all the blocks of an arena, and restore the previous arena of the
+// thread. The blocks must not be used any longer.
+void closeArena( Arena* pArena );
+
+// Get the memory usage of the process.
+void getMemoryStats( MemoryStats* pStats );
+
 //
 // Print a formatted string with a list of variable arguments to a new string.
 //
 // The caller must use freeHeap to free the returned string.
 // Returns NULL if an error occurs.
 wchar_t* v_printFmtString( const wchar_t* pwszFormat, va_list arg_list );
+
+//
+// Copy a string to a new string.
+//
+// The caller must use freeHeap to free the returned string.
+wchar_t* duplicateString( const wchar_t* pwszString );
+
+//
+// Print a formatted string with variable arguments to a new string.
+//
+// The caller must use freeHeap to free the returned string.
+// Returns NULL if an error occurs.
+wchar_t* printFmtString( const wchar_t* pwszFormat, ... );
+
+//
+// Read a whole text file (UTF-8 or UTF-16LE with BOM) to a new string.
+//
+// The caller must use freeHeap to free the returned string.
+// Returns NULL if an error occurs (the last error is set).
+wchar_t* readTextFile( const wchar_t* pwszPath );
+
+//
+// Append a string to a text file (UTF-8). The file is created if it does not exist.
+//
+// Returns FALSE if an error occurs (the last error is set).
+BOOL appendTextFile( const wchar_t* pwszPath, const wchar_t* pwszText );
+
+//
+// Escape a string to be inserted between quotes in a JSON document.
+//
+// The caller must use freeHeap to free the returned string.
+wchar_t* escapeJsonString( const wchar_t* pwszString );
@@ -13,3 +13,7 @@
 #ifndef SE_DELEGATE_SESSION_USER_IMPERSONATE_NAME
 #define SE_DELEGATE_SESSION_USER_IMPERSONATE_NAME TEXT("SeDelegateSessionUserImpersonatePrivilege")
 #endif
+
+#ifndef SE_DELEGATE_SESSION_USER_IMPERSONATE_PRIVILEGE
+#define SE_DELEGATE_SESSION_USER_IMPERSONATE_PRIVILEGE (36L)
+#endif